@@ -0,0 +1,22 @@
+#pragma once
+
+// Host-native stand-in for rweather/Crypto's AES128 block cipher (same public API)
+
+#include <stddef.h>
+#include <stdint.h>
+
+class AES128 {
+  uint8_t schedule[176];   // expanded round keys (11 x 16 bytes)
+
+public:
+  AES128();
+  ~AES128();
+
+  size_t blockSize() const { return 16; }
+  size_t keySize() const { return 16; }
+
+  bool setKey(const uint8_t* key, size_t len);
+  void encryptBlock(uint8_t* output, const uint8_t* input);
+  void decryptBlock(uint8_t* output, const uint8_t* input);
+  void clear();
+};
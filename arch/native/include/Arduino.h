@@ -0,0 +1,40 @@
+#pragma once
+
+// Host-native stand-in for the Arduino core, so that the platform-neutral parts of
+// MeshCore (src/*.cpp, and the non-hardware helpers) can be built and run on a workstation.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <Stream.h>
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+char* ltoa(long value, char* dest, int base);
+
+/**
+ * \brief  Serial port stand-in, writes to stdout (and never has any input)
+*/
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long baud) { }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override;
+  operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,12 @@
+#pragma once
+
+// Host-native stand-in for rweather/Crypto's Ed25519 (only verify() is used by MeshCore),
+// implemented on top of the bundled lib/ed25519.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Ed25519 {
+public:
+  static bool verify(const uint8_t signature[64], const uint8_t publicKey[32], const void* message, size_t len);
+};
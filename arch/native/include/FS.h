@@ -0,0 +1,77 @@
+#pragma once
+
+// Host-native stand-in for the Arduino FS API (as on RP2040/ESP32), with files kept in memory, so the
+// companion DataStore can be run on a workstation. Can simulate power loss mid-write (see setWriteBudget()).
+
+#include <Stream.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+};
+
+namespace fs {
+
+typedef std::vector<uint8_t> FileData;
+
+class File : public Stream {
+  std::shared_ptr<FileData> _data;
+  size_t _pos;
+  int* _write_budget;
+
+public:
+  File() : _pos(0), _write_budget(NULL) { }
+  File(std::shared_ptr<FileData> data, size_t pos, int* write_budget) : _data(data), _pos(pos), _write_budget(write_budget) { }
+
+  operator bool() const { return (bool) _data; }
+
+  size_t read(uint8_t* buf, size_t len);
+  int read() override;
+  int peek() override;
+  int available() override;
+  using Print::write;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override;
+
+  bool seek(uint32_t pos);
+  size_t position() const { return _pos; }
+  size_t size() const { return _data ? _data->size() : 0; }
+  void close() { _data.reset(); }
+};
+
+class FS {
+  std::map<std::string, std::shared_ptr<FileData> > _files;
+  int _write_budget;
+
+public:
+  FS() : _write_budget(-1) { }
+
+  /**
+   * \param  mode  "r", "w" (truncates), or "a" (creates if needed, positioned at end)
+  */
+  File open(const char* path, const char* mode);
+  bool exists(const char* path) const { return _files.count(path) > 0; }
+  bool remove(const char* path) { return _files.erase(path) > 0; }
+  bool rename(const char* from, const char* to);   // replaces 'to', if it exists (as LittleFS does)
+  bool mkdir(const char* path) { return true; }
+  bool info(FSInfo& info) const;
+  bool format() { _files.clear(); return true; }
+
+  /**
+   * \brief  for simulating power loss: after 'bytes' more are written, all writes fail (-1 = no limit)
+  */
+  void setWriteBudget(int bytes) { _write_budget = bytes; }
+
+  /**
+   * \returns  contents of file at 'path' (to inspect, or damage), or NULL if none
+  */
+  FileData* getData(const char* path);
+};
+
+}
+
+using fs::File;
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host-native stand-in for the RP2040 LittleFS global (see FS.h)
+
+#include <FS.h>
+
+extern fs::FS LittleFS;
@@ -0,0 +1,31 @@
+#pragma once
+
+// Host-native stand-in for rweather/Crypto's SHA256 (same public API, incl. the HMAC helpers)
+
+#include <stddef.h>
+#include <stdint.h>
+
+class SHA256 {
+  uint32_t h[8];
+  uint8_t  w[64];
+  uint64_t length;   // total bytes hashed
+  uint8_t  chunkSize;
+
+  void processChunk();
+  void formatHMACKey(const void* key, size_t len, uint8_t pad);
+
+public:
+  SHA256();
+  ~SHA256();
+
+  size_t hashSize() const { return 32; }
+  size_t blockSize() const { return 64; }
+
+  void reset();
+  void update(const void* data, size_t len);
+  void finalize(void* hash, size_t len);
+  void clear();
+
+  void resetHMAC(const void* key, size_t keyLen);
+  void finalizeHMAC(const void* key, size_t keyLen, void* hash, size_t hashLen);
+};
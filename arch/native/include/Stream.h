@@ -0,0 +1,59 @@
+#pragma once
+
+// Host-native stand-in for the Arduino Print/Stream classes (just what MeshCore uses)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define DEC  10
+#define HEX  16
+
+class Print {
+public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (len-- > 0) n += write(*buf++);
+    return n;
+  }
+  size_t write(const char* str) { return write((const uint8_t *) str, strlen(str)); }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t print(long n, int base=DEC);
+  size_t print(unsigned long n, int base=DEC);
+  size_t print(int n, int base=DEC) { return print((long) n, base); }
+  size_t print(unsigned int n, int base=DEC) { return print((unsigned long) n, base); }
+  size_t print(double d, int digits=2);
+
+  size_t println() { return write("\r\n"); }
+  template<typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template<typename T> size_t println(T v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+  virtual void flush() { }
+};
+
+class Stream : public Print {
+  unsigned long _timeout = 1000;
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+  size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len) {
+      int c = read();
+      if (c < 0) break;
+      buf[n++] = (uint8_t) c;
+    }
+    return n;
+  }
+  size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t *) buf, len); }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+// Host-native stand-in for densaugeo/base64 (header-only, same function signatures)
+
+static inline unsigned int encode_base64_length(unsigned int input_length) {
+  return (input_length + 2) / 3 * 4;
+}
+
+static inline unsigned int encode_base64(const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  unsigned int o = 0;
+  for (unsigned int i = 0; i < input_length; i += 3) {
+    unsigned int v = input[i] << 16;
+    if (i + 1 < input_length) v |= input[i + 1] << 8;
+    if (i + 2 < input_length) v |= input[i + 2];
+    output[o++] = table[(v >> 18) & 0x3F];
+    output[o++] = table[(v >> 12) & 0x3F];
+    output[o++] = i + 1 < input_length ? table[(v >> 6) & 0x3F] : '=';
+    output[o++] = i + 2 < input_length ? table[v & 0x3F] : '=';
+  }
+  output[o] = 0;
+  return o;
+}
+
+static inline int base64_char_value(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+' || c == '-') return 62;
+  if (c == '/' || c == '_') return 63;
+  return -1;
+}
+
+static inline unsigned int decode_base64(const unsigned char input[], unsigned int input_length, unsigned char output[]) {
+  unsigned int o = 0, bits = 0;
+  unsigned int acc = 0;
+  for (unsigned int i = 0; i < input_length; i++) {
+    int v = base64_char_value(input[i]);
+    if (v < 0) break;   // '=' padding, or end of input
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      output[o++] = (acc >> bits) & 0xFF;
+    }
+  }
+  return o;
+}
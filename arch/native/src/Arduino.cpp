@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto _boot_time = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _boot_time).count();
+}
+
+unsigned long micros() {
+  return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _boot_time).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static uint32_t _rand_state = 1;
+
+static uint32_t nextRand() {   // xorshift32, deterministic for a given randomSeed()
+  uint32_t x = _rand_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return _rand_state = x;
+}
+
+void randomSeed(unsigned long seed) {
+  _rand_state = seed ? (uint32_t) seed : 1;
+}
+
+long random(long max) {
+  if (max <= 0) return 0;
+  return nextRand() % max;
+}
+
+long random(long min, long max) {
+  if (min >= max) return min;
+  return min + random(max - min);
+}
+
+char* ltoa(long value, char* dest, int base) {
+  char tmp[34];
+  char* tp = tmp;
+  unsigned long v = (value < 0 && base == 10) ? -value : value;
+  do {
+    int d = v % base;
+    *tp++ = d < 10 ? '0' + d : 'a' + d - 10;
+    v /= base;
+  } while (v);
+
+  char* dp = dest;
+  if (value < 0 && base == 10) *dp++ = '-';
+  while (tp > tmp) *dp++ = *--tp;
+  *dp = 0;
+  return dest;
+}
+
+size_t Print::print(long n, int base) {
+  char tmp[34];
+  return write(ltoa(n, tmp, base));
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char tmp[34];
+  char* tp = &tmp[sizeof(tmp) - 1];
+  *tp = 0;
+  do {
+    int d = n % base;
+    *--tp = d < 10 ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n);
+  return write(tp);
+}
+
+size_t Print::print(double d, int digits) {
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", digits, d);
+  return write(tmp);
+}
+
+size_t Print::printf(const char* fmt, ...) {
+  char tmp[256];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if (len >= (int) sizeof(tmp)) len = sizeof(tmp) - 1;
+  return write((const uint8_t *) tmp, len);
+}
+
+size_t HostSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HostSerial::write(const uint8_t* buf, size_t len) {
+  return fwrite(buf, 1, len, stdout);
+}
+
+void HostSerial::flush() {
+  fflush(stdout);
+}
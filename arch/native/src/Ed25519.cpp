@@ -0,0 +1,7 @@
+#include <Ed25519.h>
+#define ED25519_NO_SEED  1
+#include <ed_25519.h>
+
+bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32], const void* message, size_t len) {
+  return ed25519_verify(signature, (const unsigned char *) message, len, publicKey) != 0;
+}
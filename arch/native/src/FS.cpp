@@ -0,0 +1,85 @@
+#include <FS.h>
+#include <LittleFS.h>
+
+fs::FS LittleFS;
+
+namespace fs {
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (!_data || _pos >= _data->size()) return 0;
+  size_t avail = _data->size() - _pos;
+  if (len > avail) len = avail;
+  memcpy(buf, _data->data() + _pos, len);
+  _pos += len;
+  return len;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!_data || _pos >= _data->size()) return -1;
+  return (*_data)[_pos];
+}
+
+int File::available() {
+  if (!_data || _pos >= _data->size()) return 0;
+  return _data->size() - _pos;
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!_data) return 0;
+  if (_write_budget && *_write_budget >= 0) {   // simulated power loss, only part gets written
+    if ((int) len > *_write_budget) len = *_write_budget;
+    *_write_budget -= len;
+  }
+  if (_pos + len > _data->size()) _data->resize(_pos + len);
+  memcpy(_data->data() + _pos, buf, len);
+  _pos += len;
+  return len;
+}
+
+bool File::seek(uint32_t pos) {
+  if (!_data || pos > _data->size()) return false;
+  _pos = pos;
+  return true;
+}
+
+File FS::open(const char* path, const char* mode) {
+  auto it = _files.find(path);
+  if (mode[0] == 'r') {
+    if (it == _files.end()) return File();
+    return File(it->second, 0, &_write_budget);
+  }
+  if (mode[0] == 'w' || it == _files.end()) {
+    auto data = std::make_shared<FileData>();
+    _files[path] = data;
+    return File(data, 0, &_write_budget);
+  }
+  return File(it->second, it->second->size(), &_write_budget);   // append
+}
+
+bool FS::rename(const char* from, const char* to) {
+  auto it = _files.find(from);
+  if (it == _files.end()) return false;
+  auto data = it->second;
+  _files.erase(it);
+  _files[to] = data;
+  return true;
+}
+
+bool FS::info(FSInfo& info) const {
+  info.usedBytes = 0;
+  for (auto& f : _files) info.usedBytes += f.second->size();
+  info.totalBytes = 1024*1024;
+  return true;
+}
+
+FileData* FS::getData(const char* path) {
+  auto it = _files.find(path);
+  return it == _files.end() ? NULL : it->second.get();
+}
+
+}
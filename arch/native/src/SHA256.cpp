@@ -0,0 +1,130 @@
+#include <SHA256.h>
+#include <string.h>
+
+static const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+SHA256::SHA256() {
+  reset();
+}
+
+SHA256::~SHA256() {
+  clear();
+}
+
+void SHA256::reset() {
+  h[0] = 0x6a09e667; h[1] = 0xbb67ae85; h[2] = 0x3c6ef372; h[3] = 0xa54ff53a;
+  h[4] = 0x510e527f; h[5] = 0x9b05688c; h[6] = 0x1f83d9ab; h[7] = 0x5be0cd19;
+  length = 0;
+  chunkSize = 0;
+}
+
+void SHA256::processChunk() {
+  uint32_t W[64];
+  for (int i = 0; i < 16; i++) {
+    W[i] = ((uint32_t)w[i*4] << 24) | ((uint32_t)w[i*4 + 1] << 16) | ((uint32_t)w[i*4 + 2] << 8) | w[i*4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = ror(W[i-15], 7) ^ ror(W[i-15], 18) ^ (W[i-15] >> 3);
+    uint32_t s1 = ror(W[i-2], 17) ^ ror(W[i-2], 19) ^ (W[i-2] >> 10);
+    W[i] = W[i-16] + s0 + W[i-7] + s1;
+  }
+
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = hh + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + W[i];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    hh = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+void SHA256::update(const void* data, size_t len) {
+  const uint8_t* dp = (const uint8_t *) data;
+  length += len;
+  while (len > 0) {
+    size_t n = 64 - chunkSize;
+    if (n > len) n = len;
+    memcpy(&w[chunkSize], dp, n);
+    chunkSize += n;
+    dp += n;
+    len -= n;
+    if (chunkSize == 64) {
+      processChunk();
+      chunkSize = 0;
+    }
+  }
+}
+
+void SHA256::finalize(void* hash, size_t len) {
+  uint64_t bits = length * 8;
+
+  w[chunkSize++] = 0x80;
+  if (chunkSize > 56) {
+    memset(&w[chunkSize], 0, 64 - chunkSize);
+    processChunk();
+    chunkSize = 0;
+  }
+  memset(&w[chunkSize], 0, 56 - chunkSize);
+  for (int i = 0; i < 8; i++) {
+    w[63 - i] = (uint8_t)(bits >> (i * 8));
+  }
+  processChunk();
+
+  uint8_t digest[32];
+  for (int i = 0; i < 8; i++) {
+    digest[i*4]     = (uint8_t)(h[i] >> 24);
+    digest[i*4 + 1] = (uint8_t)(h[i] >> 16);
+    digest[i*4 + 2] = (uint8_t)(h[i] >> 8);
+    digest[i*4 + 3] = (uint8_t) h[i];
+  }
+  if (len > 32) len = 32;
+  memcpy(hash, digest, len);
+}
+
+void SHA256::clear() {
+  memset(h, 0, sizeof(h));
+  memset(w, 0, sizeof(w));
+  reset();
+}
+
+void SHA256::formatHMACKey(const void* key, size_t len, uint8_t pad) {
+  uint8_t block[64];
+  if (len > 64) {
+    reset();
+    update(key, len);
+    finalize(block, 32);
+    memset(&block[32], 0, 32);
+  } else {
+    memcpy(block, key, len);
+    memset(&block[len], 0, 64 - len);
+  }
+  for (int i = 0; i < 64; i++) block[i] ^= pad;
+
+  reset();
+  update(block, 64);
+}
+
+void SHA256::resetHMAC(const void* key, size_t keyLen) {
+  formatHMACKey(key, keyLen, 0x36);
+}
+
+void SHA256::finalizeHMAC(const void* key, size_t keyLen, void* hash, size_t hashLen) {
+  uint8_t inner[32];
+  finalize(inner, 32);
+  formatHMACKey(key, keyLen, 0x5C);
+  update(inner, 32);
+  finalize(hash, hashLen);
+}
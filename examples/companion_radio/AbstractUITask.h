@@ -43,5 +43,8 @@ public:
   virtual void newMsg(uint8_t path_len, const char* from_name, const char* text, int msgcount) = 0;
   virtual void notify(UIEventType t = UIEventType::none) = 0;
   virtual void loop() = 0;
-  virtual void syncChatHistoryToBLE(int max_messages = 10) {} // Default empty implementation
+  /**
+   * \returns  seq of last message synced, to pass as 'since_seq' next time
+  */
+  virtual uint32_t syncChatHistoryToBLE(uint32_t since_seq, int max_messages = 10) { return since_seq; } // Default empty implementation
 };
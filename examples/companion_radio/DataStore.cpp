@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include "DataStore.h"
+#include <helpers/ContactStore.h>
+#include <LoopProfiler.h>
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
   #define MAX_BLOBRECS 100
@@ -163,6 +165,8 @@ bool DataStore::removeFile(FILESYSTEM* fs, const char* filename) {
 }
 
 bool DataStore::formatFileSystem() {
+  _contacts_synced = false;   // next saveContacts() needs to write all
+  _secrets_key_valid = false;
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   if (_fsExtra == nullptr) {
     return _fs->format();
@@ -231,6 +235,7 @@ void DataStore::loadPrefsInt(const char *filename, NodePrefs& _prefs, double& no
 }
 
 void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_lon) {
+  LOOP_PROFILE_SCOPE(PROF_STORE_SAVE);
   File file = openWrite(_fs, "/new_prefs");
   if (file) {
     uint8_t pad[8];
@@ -265,64 +270,458 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
+/*
+  /contacts3 holds a CONTACT_REC_SIZE record per contact. Changes since it was last written are appended to
+  a journal, as CRC protected records, which are replayed over it on load:
+    JREC_UPSERT:  type, contact record (first CONTACT_JOURNAL_KEY_LEN bytes are the key), CRC
+    JREC_PATCH:   type, key, offset, len, bytes of contact record, CRC
+    JREC_DELETE:  type, key, CRC
+  Once the journal exceeds CONTACTS_JOURNAL_MAX_SIZE, /contacts3 is rewritten and the journal removed. The
+  rewrite goes to a temp file which is then renamed over /contacts3, so a power loss at any point leaves either
+  the old /contacts3 plus journal, or the new /contacts3 (plus a journal whose replay is then a no-op).
+*/
+#define CONTACTS_JOURNAL_FILE  "/contacts3_jnl"
+#define CONTACTS_TMP_FILE      "/contacts3_tmp"
+
+#define JREC_UPSERT   1
+#define JREC_PATCH    2
+#define JREC_DELETE   3
+
+#define JREC_HDR_SIZE  (1 + CONTACT_JOURNAL_KEY_LEN)
+
+// parts of the contact record which are tracked for changes (must be contiguous)
+static const struct { uint8_t start, len; } contact_segs[CONTACT_REC_NUM_SEGMENTS] = {
+  { 32, 39 },    // name, type, flags, (unused), sync_since
+  { 71, 69 },    // out_path_len, last_advert_timestamp, out_path
+  { 140, 4 },    // lastmod
+  { 144, 8 },    // gps_lat, gps_lon
+};
+
+static uint32_t calcCRC32(const uint8_t* data, int len) {
+  uint32_t crc = 0xFFFFFFFF;
+  while (len-- > 0) {
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static void packContact(uint8_t* rec, const ContactInfo& c) {
+  memcpy(&rec[0], c.id.pub_key, 32);
+  memcpy(&rec[32], c.name, 32);
+  rec[64] = c.type;
+  rec[65] = c.flags;
+  rec[66] = 0;  // unused
+  memcpy(&rec[67], &c.sync_since, 4);   // was 'reserved'
+  rec[71] = (uint8_t) c.out_path_len;
+  memcpy(&rec[72], &c.last_advert_timestamp, 4);
+  memcpy(&rec[76], c.out_path, 64);
+  memcpy(&rec[140], &c.lastmod, 4);
+  memcpy(&rec[144], &c.gps_lat, 4);
+  memcpy(&rec[148], &c.gps_lon, 4);
+}
+
+static void unpackContact(ContactInfo& c, const uint8_t* rec) {   // NOTE: c.id is not touched
+  memcpy(c.name, &rec[32], 32);
+  c.type = rec[64];
+  c.flags = rec[65];
+  memcpy(&c.sync_since, &rec[67], 4);
+  c.out_path_len = (int8_t) rec[71];
+  memcpy(&c.last_advert_timestamp, &rec[72], 4);
+  memcpy(c.out_path, &rec[76], 64);
+  memcpy(&c.lastmod, &rec[140], 4);
+  memcpy(&c.gps_lat, &rec[144], 4);
+  memcpy(&c.gps_lon, &rec[148], 4);
+}
+
+static void calcShadow(ContactShadow& dest, const uint8_t* rec) {
+  memcpy(dest.key, rec, CONTACT_JOURNAL_KEY_LEN);
+  for (int i = 0; i < CONTACT_REC_NUM_SEGMENTS; i++) {
+    dest.seg_crc[i] = calcCRC32(&rec[contact_segs[i].start], contact_segs[i].len);
+  }
+}
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);   // NOTE: positioned at end of file
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
+static bool replaceFile(FILESYSTEM* fs, const char* src, const char* dest) {
+  if (fs->rename(src, dest)) return true;
+  // some FS (eg. SPIFFS) won't rename over an existing file
+  return fs->exists(dest) && fs->remove(dest) && fs->rename(src, dest);
+}
+
 void DataStore::loadContacts(DataStoreHost* host) {
-File file = openRead(_getContactsChannelsFS(), "/contacts3");
-    if (file) {
-      bool full = false;
-      while (!full) {
-        ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  if (fs->exists(CONTACTS_TMP_FILE)) {   // interrupted rewriteContacts()
+    if (fs->exists("/contacts3")) {
+      fs->remove(CONTACTS_TMP_FILE);     // may be incomplete, old /contacts3 + journal still valid
+    } else {
+      fs->rename(CONTACTS_TMP_FILE, "/contacts3");   // was complete, lost power between remove and rename
+    }
+  }
 
-        if (!success) break; // EOF
+  bool complete = true;
+  File file = openRead(fs, "/contacts3");
+  if (file) {
+    uint8_t rec[CONTACT_REC_SIZE];
+    while (file.read(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE) {
+      ContactInfo c;
+      c.id = mesh::Identity(rec);
+      unpackContact(c, rec);
+      if (!host->onContactLoaded(c)) {   // table full
+        complete = false;
+        break;
+      }
+    }
+    file.close();
+  }
+  complete = replayContactsJournal(host) && complete;
+
+  // if anything couldn't be loaded, next save needs to rewrite all
+  _contacts_synced = rebuildShadow(host) && complete;
+}
+
+bool DataStore::replayContactsJournal(DataStoreHost* host) {
+  _journal_len = 0;
+  File file = openRead(_getContactsChannelsFS(), CONTACTS_JOURNAL_FILE);
+  if (!file) return true;   // no journal
+
+  bool success = true;
+  uint8_t rec[1 + CONTACT_REC_SIZE + 4];
+  while (file.read(rec, JREC_HDR_SIZE) == JREC_HDR_SIZE) {
+    int len = JREC_HDR_SIZE;
+    int body_len;
+    if (rec[0] == JREC_UPSERT) {
+      body_len = CONTACT_REC_SIZE - CONTACT_JOURNAL_KEY_LEN;
+    } else if (rec[0] == JREC_PATCH) {
+      if (file.read(&rec[len], 2) != 2) { success = false; break; }
+      len += 2;
+      body_len = rec[len - 1];
+      if (rec[len - 2] < contact_segs[0].start || rec[len - 2] + body_len > CONTACT_REC_SIZE) { success = false; break; }
+    } else if (rec[0] == JREC_DELETE) {
+      body_len = 0;
+    } else {
+      success = false;  // unknown record type
+      break;
+    }
+    if (file.read(&rec[len], body_len + 4) != body_len + 4) { success = false; break; }  // truncated
+    len += body_len;
+
+    uint32_t crc;
+    memcpy(&crc, &rec[len], 4);
+    if (crc != calcCRC32(rec, len)) { success = false; break; }
+    _journal_len += len + 4;
+
+    ContactInfo* c = host->lookupContactForLoad(&rec[1], CONTACT_JOURNAL_KEY_LEN);
+    if (rec[0] == JREC_UPSERT) {
+      if (c) {
+        unpackContact(*c, &rec[1]);
+      } else {
+        ContactInfo nc;
+        nc.id = mesh::Identity(&rec[1]);
+        unpackContact(nc, &rec[1]);
+        if (!host->onContactLoaded(nc)) success = false;   // table full
+      }
+    } else if (rec[0] == JREC_PATCH) {
+      if (c) {
+        uint8_t tmp[CONTACT_REC_SIZE];
+        packContact(tmp, *c);
+        memcpy(&tmp[rec[JREC_HDR_SIZE]], &rec[JREC_HDR_SIZE + 2], body_len);
+        unpackContact(*c, tmp);
+      }
+    } else {
+      if (c) host->onContactDeleted(*c);
+    }
+  }
+  file.close();
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("loadContacts: journal replay stopped at offset %d", _journal_len);
+  }
+  return success;
+}
+
+bool DataStore::growShadow(int min_capacity) {
+  int new_capacity = _shadow_capacity + 32;
+  if (new_capacity < min_capacity) new_capacity = min_capacity;
+
+  ContactShadow* s = (ContactShadow *) ContactStore::allocLarge(sizeof(ContactShadow) * new_capacity);
+  if (s == NULL) return false;
+  if (_shadow) {
+    memcpy(s, _shadow, sizeof(ContactShadow) * _num_shadow);
+    free(_shadow);
+  }
+  _shadow = s;
+  _shadow_capacity = new_capacity;
+  return true;
+}
+
+bool DataStore::rebuildShadow(DataStoreHost* host) {
+  _num_shadow = 0;
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  while (host->getContactForSave(_num_shadow, c)) {
+    if (_num_shadow >= _shadow_capacity && !growShadow(_num_shadow + 1)) return false;
+
+    packContact(rec, c);
+    calcShadow(_shadow[_num_shadow++], rec);
+  }
+  return true;
+}
 
-        c.id = mesh::Identity(pub_key);
-        if (!host->onContactLoaded(c)) full = true;
+void DataStore::rewriteContacts(DataStoreHost* host) {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  File file = openWrite(fs, CONTACTS_TMP_FILE);
+  if (!file) {
+    _contacts_synced = false;
+    return;
+  }
+
+  uint32_t idx = 0;
+  ContactInfo c;
+  bool success = true, shadow_ok = true;
+  _rec_buf_len = 0;
+  while (host->getContactForSave(idx, c)) {
+    if (_rec_buf_len + CONTACT_REC_SIZE > (int) sizeof(_rec_buf)) {  // buffer full?
+      success = (file.write(_rec_buf, _rec_buf_len) == _rec_buf_len);
+      _rec_buf_len = 0;
+      if (!success) break; // write failed
+    }
+    uint8_t* rec = &_rec_buf[_rec_buf_len];
+    packContact(rec, c);
+    _rec_buf_len += CONTACT_REC_SIZE;
+
+    if (shadow_ok && ((int)idx < _shadow_capacity || growShadow(idx + 1))) {
+      calcShadow(_shadow[idx], rec);
+    } else {
+      shadow_ok = false;
+    }
+    idx++;  // advance to next contact
+  }
+  if (success && _rec_buf_len > 0) {
+    success = (file.write(_rec_buf, _rec_buf_len) == _rec_buf_len);
+  }
+  _rec_buf_len = 0;
+  file.close();
+
+  success = success && replaceFile(fs, CONTACTS_TMP_FILE, "/contacts3");
+  if (success) {
+    if (fs->exists(CONTACTS_JOURNAL_FILE)) fs->remove(CONTACTS_JOURNAL_FILE);  // now merged into /contacts3
+  } else {
+    fs->remove(CONTACTS_TMP_FILE);   // old /contacts3 + journal still intact
+  }
+  _journal_len = 0;
+  _num_shadow = shadow_ok ? idx : 0;
+  _contacts_synced = success && shadow_ok;
+}
+
+void DataStore::appendJournal(uint8_t* rec, int len) {   // NOTE: rec[] needs 4 spare bytes, for the CRC
+  uint32_t crc = calcCRC32(rec, len);
+  memcpy(&rec[len], &crc, 4);
+  len += 4;
+
+  if (_rec_buf_len + len > (int) sizeof(_rec_buf)) flushJournal();
+  memcpy(&_rec_buf[_rec_buf_len], rec, len);
+  _rec_buf_len += len;
+}
+
+void DataStore::flushJournal() {
+  if (_rec_buf_len > 0 && !_write_failed) {
+    File file = openAppend(_getContactsChannelsFS(), CONTACTS_JOURNAL_FILE);
+    if (file) {
+      if (file.write(_rec_buf, _rec_buf_len) == _rec_buf_len) {
+        _journal_len += _rec_buf_len;
+      } else {
+        _write_failed = true;
       }
       file.close();
+    } else {
+      _write_failed = true;
     }
+  }
+  _rec_buf_len = 0;
+}
+
+void DataStore::writeContactPatch(const uint8_t* contact_rec, int from_seg, int to_seg) {
+  uint8_t rec[JREC_HDR_SIZE + 2 + CONTACT_REC_SIZE + 4];
+  int offset = contact_segs[from_seg].start;
+  int len = contact_segs[to_seg - 1].start + contact_segs[to_seg - 1].len - offset;
+
+  rec[0] = JREC_PATCH;
+  memcpy(&rec[1], contact_rec, CONTACT_JOURNAL_KEY_LEN);
+  rec[JREC_HDR_SIZE] = offset;
+  rec[JREC_HDR_SIZE + 1] = len;
+  memcpy(&rec[JREC_HDR_SIZE + 2], &contact_rec[offset], len);
+  appendJournal(rec, JREC_HDR_SIZE + 2 + len);
+}
+
+void DataStore::writeContactDelete(const uint8_t* key) {
+  uint8_t rec[JREC_HDR_SIZE + 4];
+  rec[0] = JREC_DELETE;
+  memcpy(&rec[1], key, CONTACT_JOURNAL_KEY_LEN);
+  appendJournal(rec, JREC_HDR_SIZE);
 }
 
 void DataStore::saveContacts(DataStoreHost* host) {
-  File file = openWrite(_getContactsChannelsFS(), "/contacts3");
-  if (file) {
-    uint32_t idx = 0;
-    ContactInfo c;
-    uint8_t unused = 0;
-
-    while (host->getContactForSave(idx, c)) {
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
+  LOOP_PROFILE_SCOPE(PROF_STORE_SAVE);
+  if (!_contacts_synced || _journal_len >= CONTACTS_JOURNAL_MAX_SIZE) {
+    rewriteContacts(host);
+    return;
+  }
 
-      if (!success) break; // write failed
+  // diff the contacts against _shadow[], journaling just the changes
+  uint32_t idx = 0;
+  int j = 0;   // position in _shadow[]
+  ContactInfo c;
+  uint8_t rec[1 + CONTACT_REC_SIZE + 4];
+  uint8_t* contact_rec = &rec[1];
+  _rec_buf_len = 0;
+  _write_failed = false;
+
+  while (host->getContactForSave(idx, c)) {
+    packContact(contact_rec, c);
+
+    int k = j;
+    while (k < _num_shadow && memcmp(_shadow[k].key, contact_rec, CONTACT_JOURNAL_KEY_LEN) != 0) k++;
+
+    if (k < _num_shadow) {
+      if (k > j) {   // _shadow[j..k-1] have been removed
+        for (int i = j; i < k; i++) writeContactDelete(_shadow[i].key);
+        memmove(&_shadow[j], &_shadow[k], (_num_shadow - k) * sizeof(ContactShadow));
+        _num_shadow -= k - j;
+      }
+      ContactShadow s;
+      calcShadow(s, contact_rec);
+      int seg = 0;
+      while (seg < CONTACT_REC_NUM_SEGMENTS) {
+        if (s.seg_crc[seg] == _shadow[j].seg_crc[seg]) {
+          seg++;
+          continue;
+        }
+        int end = seg + 1;   // patch the run of changed segments in one record
+        while (end < CONTACT_REC_NUM_SEGMENTS && s.seg_crc[end] != _shadow[j].seg_crc[end]) end++;
+        writeContactPatch(contact_rec, seg, end);
+        seg = end;
+      }
+      _shadow[j] = s;
+    } else {   // new contact
+      if (_num_shadow >= _shadow_capacity && !growShadow(_num_shadow + 1)) {
+        _write_failed = true;
+        break;
+      }
+      memmove(&_shadow[j + 1], &_shadow[j], (_num_shadow - j) * sizeof(ContactShadow));
+      _num_shadow++;
+      calcShadow(_shadow[j], contact_rec);
 
-      idx++;  // advance to next contact
+      rec[0] = JREC_UPSERT;
+      appendJournal(rec, 1 + CONTACT_REC_SIZE);
     }
-    file.close();
+    j++;
+    idx++;  // advance to next contact
+  }
+  while (!_write_failed && _num_shadow > j) {   // the rest have been removed
+    writeContactDelete(_shadow[--_num_shadow].key);
+  }
+  flushJournal();
+
+  if (_write_failed || _journal_len >= CONTACTS_JOURNAL_MAX_SIZE) {
+    MESH_DEBUG_PRINTLN("saveContacts: %s, rewriting /contacts3", _write_failed ? "journal write failed" : "compacting journal");
+    rewriteContacts(host);
+  }
+}
+
+/*
+  /contacts3_sec holds the ECDH shared secrets calculated so far, as SECRET_REC_SIZE records of
+  encryptThenMAC(pub_key + secret), appended as they are calculated. The key is the ECDH of our own
+  identity with itself, so records from a previous identity just fail their MAC and are ignored.
+  NOTE: this only keeps the secrets from casual inspection of a flash dump, as the private key is on the same flash.
+*/
+#define SECRETS_FILE     "/contacts3_sec"
+#define SECRET_REC_SIZE  (CIPHER_MAC_SIZE + 2*PUB_KEY_SIZE)
+
+void DataStore::calcSecretsKey(const mesh::LocalIdentity& self) {
+  if (!_secrets_key_valid) {
+    self.calcSharedSecret(_secrets_key, self);
+    _secrets_key_valid = true;
+  }
+}
+
+void DataStore::packSecret(uint8_t* rec, const ContactInfo& c) {
+  uint8_t plain[2*PUB_KEY_SIZE];
+  memcpy(plain, c.id.pub_key, PUB_KEY_SIZE);
+  memcpy(&plain[PUB_KEY_SIZE], c.shared_secret, PUB_KEY_SIZE);
+  mesh::Utils::encryptThenMAC(_secrets_key, rec, plain, sizeof(plain));
+}
+
+void DataStore::loadSharedSecrets(DataStoreHost* host, const mesh::LocalIdentity& self) {
+#if PERSIST_SHARED_SECRETS
+  _secrets_key_valid = false;   // identity could have changed
+  File file = openRead(_getContactsChannelsFS(), SECRETS_FILE);
+  if (!file) return;
+
+  calcSecretsKey(self);
+  int num_recs = 0, num_restored = 0;
+  uint8_t rec[SECRET_REC_SIZE], plain[SECRET_REC_SIZE];
+  while (file.read(rec, SECRET_REC_SIZE) == SECRET_REC_SIZE) {
+    num_recs++;
+    if (mesh::Utils::MACThenDecrypt(_secrets_key, plain, rec, SECRET_REC_SIZE) == 2*PUB_KEY_SIZE
+        && host->onSharedSecretLoaded(plain, &plain[PUB_KEY_SIZE])) {
+      num_restored++;
+    }
+  }
+  file.close();
+  MESH_DEBUG_PRINTLN("loadSharedSecrets: %d of %d restored", num_restored, num_recs);
+
+  if (num_recs - num_restored > num_restored + 16) {   // mostly removed contacts (or old identity)
+    saveSharedSecrets(host, self);
+  }
+#endif
+}
+
+void DataStore::saveSharedSecrets(DataStoreHost* host, const mesh::LocalIdentity& self) {
+  LOOP_PROFILE_SCOPE(PROF_STORE_SAVE);
+#if PERSIST_SHARED_SECRETS
+  File file = openWrite(_getContactsChannelsFS(), SECRETS_FILE);
+  if (!file) return;
+
+  calcSecretsKey(self);
+  uint32_t idx = 0;
+  ContactInfo c;
+  uint8_t rec[SECRET_REC_SIZE];
+  while (host->getContactForSave(idx, c)) {
+    if (c.shared_secret_valid) {
+      packSecret(rec, c);
+      if (file.write(rec, SECRET_REC_SIZE) != SECRET_REC_SIZE) break;
+    }
+    idx++;
   }
+  file.close();
+#endif
+}
+
+void DataStore::appendSharedSecrets(const mesh::LocalIdentity& self, const ContactInfo* contacts[], int count) {
+#if PERSIST_SHARED_SECRETS
+  if (count <= 0) return;
+  File file = openAppend(_getContactsChannelsFS(), SECRETS_FILE);
+  if (!file) return;
+
+  calcSecretsKey(self);
+  uint8_t rec[SECRET_REC_SIZE];
+  for (int i = 0; i < count; i++) {
+    packSecret(rec, *contacts[i]);
+    if (file.write(rec, SECRET_REC_SIZE) != SECRET_REC_SIZE) break;
+  }
+  file.close();
+#endif
 }
 
 void DataStore::loadChannels(DataStoreHost* host) {
@@ -351,6 +750,7 @@ void DataStore::loadChannels(DataStoreHost* host) {
 }
 
 void DataStore::saveChannels(DataStoreHost* host) {
+  LOOP_PROFILE_SCOPE(PROF_STORE_SAVE);
   File file = openWrite(_getContactsChannelsFS(), "/channels2");
   if (file) {
     uint8_t channel_idx = 0;
@@ -370,6 +770,321 @@ void DataStore::saveChannels(DataStoreHost* host) {
   }
 }
 
+/*
+  The chat log is a single append-only log of all conversations, split into segment files (/chat_log0 ..) of
+  about CHAT_LOG_SEGMENT_SIZE. Each segment starts with a header (magic, segment number), followed by records:
+    flags, key, seq, timestamp, prev_pos, name_len, text_len, from_name, text, CRC
+  prev_pos links each record to the previous one of its conversation, so a conversation can be paged back
+  without scanning the whole log, while seq order (for syncing) is just log order.
+  A position is (segment number & 0xFFF) << 20 | offset. Once CHAT_LOG_MAX_SEGMENTS exist, starting a new
+  segment overwrites the oldest, and links into it just end the conversation's history.
+*/
+#define CHAT_LOG_MAGIC          0x31474C43   // "CLG1"
+#define CHAT_LOG_SEG_HDR_SIZE   8
+#define CHAT_REC_HDR_SIZE       (1 + CHAT_LOG_KEY_LEN + 4 + 4 + 4 + 2)
+#define CHAT_REC_MAX_SIZE       (CHAT_REC_HDR_SIZE + 31 + 127 + 4)
+
+#define CHAT_LOG_POS(seg, ofs)  ((((seg) & 0xFFF) << 20) | (ofs))
+#define CHAT_LOG_OFS(pos)       ((pos) & 0xFFFFF)
+
+static_assert(CHAT_LOG_SEGMENT_SIZE + CHAT_REC_MAX_SIZE < (1 << 20), "CHAT_LOG_SEGMENT_SIZE too big");
+
+static void chatLogFilename(char* dest, uint32_t seg) {
+  sprintf(dest, "/chat_log%d", (int)(seg % CHAT_LOG_MAX_SEGMENTS));
+}
+
+bool DataStore::chatLogSegment(uint32_t pos, uint32_t& seg) const {
+  if (_chat_log_empty || pos == CHAT_LOG_POS_NONE) return false;
+  for (uint32_t s = _chat_seg_first; s <= _chat_seg_last; s++) {
+    if ((s & 0xFFF) == (pos >> 20)) {
+      seg = s;
+      return true;
+    }
+  }
+  return false;   // segment has been dropped
+}
+
+bool DataStore::readChatRecord(File& file, uint32_t offset, ChatLogRecord& rec, int& rec_len) {
+  uint8_t buf[CHAT_REC_MAX_SIZE];
+  if (!file.seek(offset) || file.read(buf, CHAT_REC_HDR_SIZE) != CHAT_REC_HDR_SIZE) return false;
+
+  int name_len = buf[CHAT_REC_HDR_SIZE - 2];
+  int text_len = buf[CHAT_REC_HDR_SIZE - 1];
+  if (name_len >= (int)sizeof(rec.from_name) || text_len >= (int)sizeof(rec.text)) return false;
+
+  int len = CHAT_REC_HDR_SIZE + name_len + text_len;
+  if (file.read(&buf[CHAT_REC_HDR_SIZE], name_len + text_len + 4) != name_len + text_len + 4) return false;  // truncated
+  uint32_t crc;
+  memcpy(&crc, &buf[len], 4);
+  if (crc != calcCRC32(buf, len)) return false;
+
+  int i = 0;
+  rec.flags = buf[i++];
+  memcpy(rec.key, &buf[i], CHAT_LOG_KEY_LEN); i += CHAT_LOG_KEY_LEN;
+  memcpy(&rec.seq, &buf[i], 4); i += 4;
+  memcpy(&rec.timestamp, &buf[i], 4); i += 4;
+  memcpy(&rec.prev_pos, &buf[i], 4); i += 4;
+  i += 2;
+  memcpy(rec.from_name, &buf[i], name_len); rec.from_name[name_len] = 0; i += name_len;
+  memcpy(rec.text, &buf[i], text_len); rec.text[text_len] = 0;
+
+  rec_len = len + 4;
+  return true;
+}
+
+ChatLogHead* DataStore::findChatHead(const uint8_t* key) {
+  for (int i = 0; i < _num_chat_heads; i++) {
+    if (memcmp(_chat_heads[i].key, key, CHAT_LOG_KEY_LEN) == 0) return &_chat_heads[i];
+  }
+  return NULL;
+}
+
+bool DataStore::setChatHead(const uint8_t* key, uint32_t pos) {
+  ChatLogHead* h = findChatHead(key);
+  if (h == NULL) {
+    if (_num_chat_heads >= _chat_heads_capacity) {
+      int new_capacity = _chat_heads_capacity + 32;
+      ChatLogHead* heads = (ChatLogHead *) ContactStore::allocLarge(sizeof(ChatLogHead) * new_capacity);
+      if (heads == NULL) return false;
+      if (_chat_heads) {
+        memcpy(heads, _chat_heads, sizeof(ChatLogHead) * _num_chat_heads);
+        free(_chat_heads);
+      }
+      _chat_heads = heads;
+      _chat_heads_capacity = new_capacity;
+    }
+    h = &_chat_heads[_num_chat_heads++];
+    memcpy(h->key, key, CHAT_LOG_KEY_LEN);
+  }
+  h->pos = pos;
+  return true;
+}
+
+void DataStore::loadChatLog() {
+  if (_chat_log_loaded) return;
+  _chat_log_loaded = true;
+
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  char filename[16];
+  uint32_t slot_seg[CHAT_LOG_MAX_SEGMENTS];
+  bool slot_valid[CHAT_LOG_MAX_SEGMENTS];
+  for (int slot = 0; slot < CHAT_LOG_MAX_SEGMENTS; slot++) {
+    slot_valid[slot] = false;
+    chatLogFilename(filename, slot);
+    if (!fs->exists(filename)) continue;
+
+    File file = openRead(fs, filename);
+    if (file) {
+      uint32_t hdr[2];
+      if (file.read((uint8_t *)hdr, CHAT_LOG_SEG_HDR_SIZE) == CHAT_LOG_SEG_HDR_SIZE && hdr[0] == CHAT_LOG_MAGIC
+          && hdr[1] % CHAT_LOG_MAX_SEGMENTS == (uint32_t)slot) {
+        slot_seg[slot] = hdr[1];
+        slot_valid[slot] = true;
+        if (_chat_log_empty || hdr[1] > _chat_seg_last) _chat_seg_last = hdr[1];
+        _chat_log_empty = false;
+      }
+      file.close();
+    }
+  }
+  if (_chat_log_empty) return;
+
+  // the run of consecutive segments ending at the newest
+  _chat_seg_first = _chat_seg_last;
+  while (_chat_seg_first > 0 && _chat_seg_last - _chat_seg_first + 1 < CHAT_LOG_MAX_SEGMENTS) {
+    int slot = (_chat_seg_first - 1) % CHAT_LOG_MAX_SEGMENTS;
+    if (!slot_valid[slot] || slot_seg[slot] != _chat_seg_first - 1) break;
+    _chat_seg_first--;
+  }
+
+  int num_records = 0;
+  for (uint32_t seg = _chat_seg_first; seg <= _chat_seg_last; seg++) {
+    int slot = seg % CHAT_LOG_MAX_SEGMENTS;
+    _chat_seg_first_seq[slot] = _chat_next_seq;
+    chatLogFilename(filename, seg);
+    File file = openRead(fs, filename);
+    if (!file) continue;
+
+    uint32_t offset = CHAT_LOG_SEG_HDR_SIZE;
+    ChatLogRecord rec;
+    int len;
+    bool first = true;
+    while (readChatRecord(file, offset, rec, len)) {
+      if (first) _chat_seg_first_seq[slot] = rec.seq;
+      first = false;
+      setChatHead(rec.key, CHAT_LOG_POS(seg, offset));
+      if (rec.seq >= _chat_next_seq) _chat_next_seq = rec.seq + 1;
+      offset += len;
+      num_records++;
+    }
+    if (seg == _chat_seg_last) {
+      _chat_log_end = offset;
+      _chat_tail_bad = offset < file.size();   // eg. power lost while appending
+    }
+    file.close();
+  }
+  MESH_DEBUG_PRINTLN("loadChatLog: %d records, %d conversations, segments %d..%d", num_records, _num_chat_heads,
+                     _chat_seg_first, _chat_seg_last);
+}
+
+bool DataStore::startChatSegment() {
+  uint32_t seg = _chat_log_empty ? 0 : _chat_seg_last + 1;
+  char filename[16];
+  chatLogFilename(filename, seg);
+
+  File file = openWrite(_getContactsChannelsFS(), filename);   // replaces oldest segment, if there are already max
+  if (!file) return false;
+  uint32_t hdr[2] = { CHAT_LOG_MAGIC, seg };
+  bool success = file.write((uint8_t *)hdr, CHAT_LOG_SEG_HDR_SIZE) == CHAT_LOG_SEG_HDR_SIZE;
+  file.close();
+  if (!success) return false;
+
+  if (_chat_log_empty) {
+    _chat_seg_first = seg;
+    _chat_log_empty = false;
+  } else if (seg - _chat_seg_first >= CHAT_LOG_MAX_SEGMENTS) {
+    _chat_seg_first = seg - CHAT_LOG_MAX_SEGMENTS + 1;
+  }
+  _chat_seg_last = seg;
+
+  // forget conversations whose newest record was in the dropped segment, before its number wraps round to a live one
+  for (int i = 0; i < _num_chat_heads; ) {
+    uint32_t s;
+    if (chatLogSegment(_chat_heads[i].pos, s)) {
+      i++;
+    } else {
+      _chat_heads[i] = _chat_heads[--_num_chat_heads];
+    }
+  }
+  _chat_seg_first_seq[seg % CHAT_LOG_MAX_SEGMENTS] = _chat_next_seq;
+  _chat_log_end = CHAT_LOG_SEG_HDR_SIZE;
+  _chat_tail_bad = false;
+  return true;
+}
+
+bool DataStore::appendChatMessage(ChatLogRecord& rec) {
+  LOOP_PROFILE_SCOPE(PROF_STORE_SAVE);
+  loadChatLog();
+
+  int name_len = strlen(rec.from_name);
+  if (name_len >= (int)sizeof(rec.from_name)) name_len = sizeof(rec.from_name) - 1;
+  int text_len = strlen(rec.text);
+  if (text_len >= (int)sizeof(rec.text)) text_len = sizeof(rec.text) - 1;
+  int len = CHAT_REC_HDR_SIZE + name_len + text_len;
+
+  if (_chat_log_empty || _chat_tail_bad || _chat_log_end + len + 4 > CHAT_LOG_SEGMENT_SIZE) {
+    if (!startChatSegment()) return false;
+  }
+  ChatLogHead* head = findChatHead(rec.key);
+  rec.seq = _chat_next_seq;
+  rec.pos = CHAT_LOG_POS(_chat_seg_last, _chat_log_end);
+  rec.prev_pos = head ? head->pos : CHAT_LOG_POS_NONE;
+
+  uint8_t buf[CHAT_REC_MAX_SIZE];
+  int i = 0;
+  buf[i++] = rec.flags;
+  memcpy(&buf[i], rec.key, CHAT_LOG_KEY_LEN); i += CHAT_LOG_KEY_LEN;
+  memcpy(&buf[i], &rec.seq, 4); i += 4;
+  memcpy(&buf[i], &rec.timestamp, 4); i += 4;
+  memcpy(&buf[i], &rec.prev_pos, 4); i += 4;
+  buf[i++] = name_len;
+  buf[i++] = text_len;
+  memcpy(&buf[i], rec.from_name, name_len); i += name_len;
+  memcpy(&buf[i], rec.text, text_len); i += text_len;
+  uint32_t crc = calcCRC32(buf, i);
+  memcpy(&buf[i], &crc, 4); i += 4;
+
+  char filename[16];
+  chatLogFilename(filename, _chat_seg_last);
+  File file = openAppend(_getContactsChannelsFS(), filename);
+  if (!file) return false;
+  bool success = (int)file.write(buf, i) == i;
+  file.close();
+  if (!success) {
+    _chat_tail_bad = true;   // start a new segment next time
+    return false;
+  }
+
+  _chat_next_seq++;
+  _chat_log_end += i;
+  setChatHead(rec.key, rec.pos);
+  return true;
+}
+
+int DataStore::readChatHistory(uint32_t pos, ChatLogRecord dest[], int max) {
+  loadChatLog();
+  int n = 0;
+  uint32_t seg;
+  while (n < max && chatLogSegment(pos, seg)) {
+    char filename[16];
+    chatLogFilename(filename, seg);
+    File file = openRead(_getContactsChannelsFS(), filename);
+    if (!file) break;
+
+    // follow links while they stay in this segment
+    uint32_t next_seg = seg;
+    bool success = true;
+    while (n < max && next_seg == seg) {
+      int len;
+      if (!readChatRecord(file, CHAT_LOG_OFS(pos), dest[n], len)) { success = false; break; }
+      dest[n].pos = pos;
+      pos = dest[n++].prev_pos;
+      if (!chatLogSegment(pos, next_seg)) break;
+    }
+    file.close();
+    if (!success) break;
+  }
+  return n;
+}
+
+int DataStore::readChatLog(uint32_t& pos, uint32_t after_seq, ChatLogRecord dest[], int max) {
+  loadChatLog();
+  int n = 0;
+  uint32_t seg;
+  if (!_chat_log_empty && pos != CHAT_LOG_POS_NONE && !chatLogSegment(pos, seg)) {
+    pos = CHAT_LOG_POS(_chat_seg_first, CHAT_LOG_SEG_HDR_SIZE);   // segment was dropped under cursor, skip to oldest
+  }
+  while (n < max && chatLogSegment(pos, seg)) {
+    char filename[16];
+    chatLogFilename(filename, seg);
+    File file = openRead(_getContactsChannelsFS(), filename);
+    if (!file) break;
+
+    bool end_of_log = false;
+    while (n < max) {
+      int len;
+      if (!readChatRecord(file, CHAT_LOG_OFS(pos), dest[n], len)) {   // end of segment
+        if (seg == _chat_seg_last) {
+          end_of_log = true;   // leave 'pos' here, for records appended later
+        } else {
+          pos = CHAT_LOG_POS(seg + 1, CHAT_LOG_SEG_HDR_SIZE);
+        }
+        break;
+      }
+      dest[n].pos = pos;
+      pos += len;
+      if (dest[n].seq > after_seq) n++;
+    }
+    file.close();
+    if (end_of_log) break;
+  }
+  return n;
+}
+
+uint32_t DataStore::getChatLogNewest(const uint8_t* key) {
+  loadChatLog();
+  ChatLogHead* head = findChatHead(key);
+  return head ? head->pos : CHAT_LOG_POS_NONE;
+}
+
+uint32_t DataStore::findChatLogStart(uint32_t after_seq) {
+  loadChatLog();
+  if (_chat_log_empty) return CHAT_LOG_POS(0, CHAT_LOG_SEG_HDR_SIZE);   // where the first segment will be
+
+  uint32_t seg = _chat_seg_last;
+  while (seg > _chat_seg_first && _chat_seg_first_seq[seg % CHAT_LOG_MAX_SEGMENTS] > after_seq + 1) seg--;
+  return CHAT_LOG_POS(seg, CHAT_LOG_SEG_HDR_SIZE);
+}
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
 
 #define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
@@ -435,6 +1150,23 @@ void DataStore::migrateToSecondaryFS() {
       _fs->remove("/contacts3");
     }
   }
+  if (!_fsExtra->exists(CONTACTS_JOURNAL_FILE)) {
+    if (_fs->exists(CONTACTS_JOURNAL_FILE)) {
+      File oldFile = openRead(_fs, CONTACTS_JOURNAL_FILE);
+      File newFile = openWrite(_fsExtra, CONTACTS_JOURNAL_FILE);
+
+      if (oldFile && newFile) {
+        uint8_t buf[64];
+        int n;
+        while ((n = oldFile.read(buf, sizeof(buf))) > 0) {
+          newFile.write(buf, n);
+        }
+      }
+      if (oldFile) oldFile.close();
+      if (newFile) newFile.close();
+      _fs->remove(CONTACTS_JOURNAL_FILE);
+    }
+  }
   if (!_fsExtra->exists("/channels2")) {
     if (_fs->exists("/channels2")) {
       File oldFile = openRead(_fs, "/channels2");
@@ -492,6 +1224,15 @@ void DataStore::migrateToSecondaryFS() {
   if (_fs->exists("/contacts3")) {
     _fs->remove("/contacts3");
   }
+  if (_fs->exists(CONTACTS_JOURNAL_FILE)) {
+    _fs->remove(CONTACTS_JOURNAL_FILE);
+  }
+  if (_fs->exists(CONTACTS_TMP_FILE)) {
+    _fs->remove(CONTACTS_TMP_FILE);
+  }
+  if (_fs->exists(SECRETS_FILE)) {
+    _fs->remove(SECRETS_FILE);   // not worth migrating, will just be recalculated
+  }
   if (_fs->exists("/channels2")) {
     _fs->remove("/channels2");
   }
@@ -5,20 +5,112 @@
 #include <helpers/ChannelDetails.h>
 #include "NodePrefs.h"
 
+#ifndef CONTACTS_JOURNAL_MAX_SIZE
+  #define CONTACTS_JOURNAL_MAX_SIZE   8192   // compact the journal into /contacts3 once it grows past this
+#endif
+
+#ifndef PERSIST_SHARED_SECRETS
+  #define PERSIST_SHARED_SECRETS      1   // keep calculated ECDH secrets in /contacts3_sec, so they aren't recalculated each boot
+#endif
+
+#ifndef CHAT_LOG_SEGMENT_SIZE
+  #define CHAT_LOG_SEGMENT_SIZE   32768   // start a new chat log segment once current one grows past this
+#endif
+#ifndef CHAT_LOG_MAX_SEGMENTS
+  #define CHAT_LOG_MAX_SEGMENTS       8   // oldest segment is dropped when a new one is needed
+#endif
+
+#define CONTACT_REC_SIZE          152   // size of each contact record in /contacts3
+#define CONTACT_JOURNAL_KEY_LEN     8   // pub_key prefix which identifies contact in journal records
+#define CONTACT_REC_NUM_SEGMENTS    4
+
+#define CHAT_LOG_KEY_LEN            7   // identifies a conversation (opaque to DataStore)
+#define CHAT_LOG_POS_NONE           0xFFFFFFFF
+#define CHAT_LOG_FLAG_OUTGOING      0x01
+
+/**
+ * \brief  a chat message, as stored in the chat log
+*/
+struct ChatLogRecord {
+  uint8_t key[CHAT_LOG_KEY_LEN];
+  uint8_t flags;       // CHAT_LOG_FLAG_*
+  uint32_t seq;        // assigned by appendChatMessage(), increases across all conversations
+  uint32_t timestamp;
+  uint32_t pos;        // where this record is in the log
+  uint32_t prev_pos;   // previous record of same conversation, or CHAT_LOG_POS_NONE
+  char from_name[32];
+  char text[128];
+};
+
+struct ChatLogHead {
+  uint8_t key[CHAT_LOG_KEY_LEN];
+  uint32_t pos;        // newest record of conversation
+};
+
 class DataStoreHost {
 public:
   virtual bool onContactLoaded(const ContactInfo& contact) =0;
   virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
+  virtual ContactInfo* lookupContactForLoad(const uint8_t* key_prefix, int prefix_len) =0;
+  virtual bool onContactDeleted(ContactInfo& contact) =0;
+  virtual bool onSharedSecretLoaded(const uint8_t* pub_key, const uint8_t* secret) =0;
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
 
+/**
+ * \brief  what was last persisted for a contact, so saveContacts() only needs to journal the segments which changed
+*/
+struct ContactShadow {
+  uint8_t key[CONTACT_JOURNAL_KEY_LEN];
+  uint32_t seg_crc[CONTACT_REC_NUM_SEGMENTS];
+};
+
 class DataStore {
   FILESYSTEM* _fs;
   FILESYSTEM* _fsExtra;
   mesh::RTCClock* _clock;
   IdentityStore identity_store;
 
+  // contacts journal state
+  ContactShadow* _shadow = NULL;
+  int _num_shadow = 0, _shadow_capacity = 0;
+  bool _contacts_synced = false;     // true if _shadow[] matches /contacts3 + journal
+  uint32_t _journal_len = 0;
+  uint8_t _rec_buf[4*CONTACT_REC_SIZE];   // for batching file writes
+  int _rec_buf_len = 0;
+  bool _write_failed = false;
+
+  uint8_t _secrets_key[PUB_KEY_SIZE];   // for /contacts3_sec records
+  bool _secrets_key_valid = false;
+
+  // chat log state
+  bool _chat_log_loaded = false;
+  bool _chat_log_empty = true;
+  bool _chat_tail_bad = false;        // last segment ends in a broken record, so don't append to it
+  uint32_t _chat_seg_first = 0, _chat_seg_last = 0;
+  uint32_t _chat_seg_first_seq[CHAT_LOG_MAX_SEGMENTS];   // by slot
+  uint32_t _chat_log_end = 0;         // offset of end of last segment
+  uint32_t _chat_next_seq = 1;
+  ChatLogHead* _chat_heads = NULL;
+  int _num_chat_heads = 0, _chat_heads_capacity = 0;
+
+  bool growShadow(int min_capacity);
+  bool replayContactsJournal(DataStoreHost* host);
+  bool rebuildShadow(DataStoreHost* host);
+  void rewriteContacts(DataStoreHost* host);
+  void appendJournal(uint8_t* rec, int len);
+  void flushJournal();
+  void writeContactPatch(const uint8_t* contact_rec, int from_seg, int to_seg);
+  void writeContactDelete(const uint8_t* key);
+  void calcSecretsKey(const mesh::LocalIdentity& self);
+  void packSecret(uint8_t* rec, const ContactInfo& c);
+  ChatLogHead* findChatHead(const uint8_t* key);
+  bool setChatHead(const uint8_t* key, uint32_t pos);
+  bool chatLogSegment(uint32_t pos, uint32_t& seg) const;
+  bool readChatRecord(File& file, uint32_t offset, ChatLogRecord& rec, int& rec_len);
+  bool startChatSegment();
+
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   void checkAdvBlobFile();
@@ -37,8 +129,47 @@ public:
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
   void saveContacts(DataStoreHost* host);
+  void loadSharedSecrets(DataStoreHost* host, const mesh::LocalIdentity& self);
+  void saveSharedSecrets(DataStoreHost* host, const mesh::LocalIdentity& self);
+  void appendSharedSecrets(const mesh::LocalIdentity& self, const ContactInfo* contacts[], int count);
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
+
+  /**
+   * \brief  scans the chat log, to find the newest record of each conversation. Called by the other chat log
+   *          methods if needed.
+  */
+  void loadChatLog();
+
+  /**
+   * \brief  appends 'rec' (key, flags, timestamp, from_name, text) to chat log, filling in seq, pos, and prev_pos
+  */
+  bool appendChatMessage(ChatLogRecord& rec);
+
+  /**
+   * \brief  reads (and CRC checks) up to 'max' records of a conversation, from 'pos' back to older ones
+   * \returns  number of records read
+  */
+  int readChatHistory(uint32_t pos, ChatLogRecord dest[], int max);
+
+  /**
+   * \brief  reads up to 'max' records with seq > 'after_seq', in seq order, starting at 'pos' (see findChatLogStart()).
+   *          'pos' is advanced past what was read, so can be used to continue later.
+   * \returns  number of records read
+  */
+  int readChatLog(uint32_t& pos, uint32_t after_seq, ChatLogRecord dest[], int max);
+
+  /**
+   * \returns  position of newest record of conversation 'key', or CHAT_LOG_POS_NONE
+  */
+  uint32_t getChatLogNewest(const uint8_t* key);
+
+  /**
+   * \returns  a position at or before the first record with seq > 'after_seq', for readChatLog()
+  */
+  uint32_t findChatLogStart(uint32_t after_seq);
+
+  uint32_t getChatLogNextSeq() { loadChatLog(); return _chat_next_seq; }
   void migrateToSecondaryFS();
   uint8_t getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]);
   bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
@@ -2,6 +2,7 @@
 
 #include <Arduino.h> // needed for PlatformIO
 #include <Mesh.h>
+#include <LoopProfiler.h>
 
 #define CMD_APP_START                 1
 #define CMD_SEND_TXT_MSG              2
@@ -58,6 +59,11 @@
 #define STATS_TYPE_CORE               0
 #define STATS_TYPE_RADIO              1
 #define STATS_TYPE_PACKETS             2
+#define STATS_TYPE_PACKET_POOL         3
+#define STATS_TYPE_CRYPTO              4
+#define STATS_TYPE_LOOP                5   // third byte (optional) is section, for its histogram
+#define STATS_TYPE_DROPS               6
+#define STATS_TYPE_PAYLOAD_TYPES       7
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -90,6 +96,7 @@
 #define DIRECT_SEND_PERHOP_FACTOR       6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
 #define LAZY_CONTACTS_WRITE_DELAY       5000
+#define LAZY_SECRETS_WRITE_DELAY        2000
 
 #define PUBLIC_GROUP_PSK                "izOH6cXN6mrJ5e26oRXNcg=="
 
@@ -391,6 +398,26 @@ void MyMesh::onContactPathUpdated(const ContactInfo &contact) {
   dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
 }
 
+void MyMesh::onSharedSecretCalculated(const ContactInfo &contact) {
+  // called from packet handling, so just note it here, and append to the secrets file later in loop()
+  if (num_pending_secrets < PENDING_SECRETS_MAX) {
+    memcpy(pending_secrets[num_pending_secrets++], contact.id.pub_key, PUB_KEY_SIZE);
+  }  // else dropped, will just need calculating again after reboot
+  if (dirty_secrets_expiry == 0) dirty_secrets_expiry = futureMillis(LAZY_SECRETS_WRITE_DELAY);
+}
+
+void MyMesh::savePendingSecrets() {
+  const ContactInfo* list[PENDING_SECRETS_MAX];
+  int n = 0;
+  for (int i = 0; i < num_pending_secrets; i++) {
+    ContactInfo* c = lookupContactByPubKey(pending_secrets[i], PUB_KEY_SIZE);
+    if (c && c->shared_secret_valid) list[n++] = c;   // (contact may since have been removed)
+  }
+  _store->appendSharedSecrets(self_id, list, n);   // so won't need calculating again after reboot
+  num_pending_secrets = 0;
+  dirty_secrets_expiry = 0;
+}
+
 ContactInfo*  MyMesh::processAck(const uint8_t *data) {
   // see if matches any in a table
   for (int i = 0; i < EXPECTED_ACK_TABLE_SIZE; i++) {
@@ -795,6 +822,8 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
   next_ack_idx = 0;
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  dirty_secrets_expiry = 0;
+  num_pending_secrets = 0;
   memset(advert_paths, 0, sizeof(advert_paths));
   memset(send_scope.key, 0, sizeof(send_scope.key));
 
@@ -868,6 +897,7 @@ void MyMesh::begin(bool has_display) {
 
   resetContacts();
   _store->loadContacts(this);
+  _store->loadSharedSecrets(this, self_id);
   addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
   _store->loadChannels(this);
 
@@ -1281,6 +1311,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (dirty_contacts_expiry) { // is there are pending dirty contacts write needed?
       saveContacts();
     }
+    if (dirty_secrets_expiry) savePendingSecrets();
     board.reboot();
   } else if (cmd_frame[0] == CMD_GET_BATT_AND_STORAGE) {
     uint8_t reply[11];
@@ -1310,8 +1341,11 @@ void MyMesh::handleCmdFrame(size_t len) {
       self_id = identity;
       writeOKFrame();
       // re-load contacts, to recalc shared secrets
+      num_pending_secrets = 0;
+      dirty_secrets_expiry = 0;
       resetContacts();
       _store->loadContacts(this);
+      _store->loadSharedSecrets(this, self_id);   // (will discard the old identity's)
     } else {
       writeErrFrame(ERR_CODE_FILE_IO_ERROR);
     }
@@ -1631,7 +1665,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       out_frame[i++] = STATS_TYPE_CORE;
       uint16_t battery_mv = board.getBattMilliVolts();
       uint32_t uptime_secs = _ms->getMillis() / 1000;
-      uint8_t queue_len = (uint8_t)_mgr->getOutboundCount(0xFFFFFFFF);
+      uint8_t queue_len = (uint8_t)_mgr->getOutboundTotal();
       memcpy(&out_frame[i], &battery_mv, 2); i += 2;
       memcpy(&out_frame[i], &uptime_secs, 4); i += 4;
       memcpy(&out_frame[i], &_err_flags, 2); i += 2;
@@ -1651,6 +1685,10 @@ void MyMesh::handleCmdFrame(size_t len) {
       out_frame[i++] = last_snr;
       memcpy(&out_frame[i], &tx_air_secs, 4); i += 4;
       memcpy(&out_frame[i], &rx_air_secs, 4); i += 4;
+      uint32_t duty_used = getDutyCycleUsed();             // millis, in last hour
+      uint32_t duty_remaining = getDutyCycleRemaining();   // 0xFFFFFFFF if no limit
+      memcpy(&out_frame[i], &duty_used, 4); i += 4;
+      memcpy(&out_frame[i], &duty_remaining, 4); i += 4;
       _serial->writeFrame(out_frame, i);
     } else if (stats_type == STATS_TYPE_PACKETS) {
       int i = 0;
@@ -1669,6 +1707,107 @@ void MyMesh::handleCmdFrame(size_t len) {
       memcpy(&out_frame[i], &n_recv_flood, 4); i += 4;
       memcpy(&out_frame[i], &n_recv_direct, 4); i += 4;
       _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_PACKET_POOL) {
+      mesh::PacketPoolStats pool;
+      if (!_mgr->getPoolStats(pool)) {
+        writeErrFrame(ERR_CODE_UNSUPPORTED_CMD);
+      } else {
+        int i = 0;
+        out_frame[i++] = RESP_CODE_STATS;
+        out_frame[i++] = STATS_TYPE_PACKET_POOL;
+        memcpy(&out_frame[i], &pool.size, 2); i += 2;
+        memcpy(&out_frame[i], &pool.in_use, 2); i += 2;
+        memcpy(&out_frame[i], &pool.high_water, 2); i += 2;
+        memcpy(&out_frame[i], &pool.alloc_failures, 4); i += 4;
+        memcpy(&out_frame[i], &pool.bad_frees, 4); i += 4;
+        memcpy(&out_frame[i], &pool.by_owner[PACKET_OWNER_OUTBOUND], 2); i += 2;
+        memcpy(&out_frame[i], &pool.by_owner[PACKET_OWNER_INBOUND], 2); i += 2;
+        memcpy(&out_frame[i], &pool.by_owner[PACKET_OWNER_HELD], 2); i += 2;
+        memcpy(&out_frame[i], &pool.poison_faults, 4); i += 4;   // always 0 unless PACKET_POOL_POISON
+        _serial->writeFrame(out_frame, i);
+      }
+    } else if (stats_type == STATS_TYPE_CRYPTO) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_CRYPTO;
+      const mesh::TrialMatchStats& trial = getTrialMatchStats();
+      uint32_t key_hits, key_misses;
+      mesh::Utils::getKeyCacheStats(key_hits, key_misses);
+      memcpy(&out_frame[i], &trial.packets, 4); i += 4;
+      memcpy(&out_frame[i], &trial.mac_checks, 4); i += 4;
+      memcpy(&out_frame[i], &trial.unmatched, 4); i += 4;
+      memcpy(&out_frame[i], &trial.max_per_packet, 2); i += 2;
+      memcpy(&out_frame[i], &key_hits, 4); i += 4;
+      memcpy(&out_frame[i], &key_misses, 4); i += 4;
+      uint32_t advert_hits = getAdvertVerifyHits();
+      uint32_t advert_misses = getAdvertVerifyMisses();
+      memcpy(&out_frame[i], &advert_hits, 4); i += 4;
+      memcpy(&out_frame[i], &advert_misses, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_DROPS) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_DROPS;
+      out_frame[i++] = DROP_NUM_REASONS;
+      for (int r = 0; r < DROP_NUM_REASONS; r++) {
+        uint32_t count = getNumDropped(r);
+        memcpy(&out_frame[i], &count, 4); i += 4;
+      }
+      const mesh::QueueStats& q = getQueueStats();
+      uint16_t q_len = (uint16_t)_mgr->getOutboundTotal();
+      uint32_t avg_wait = q.num_waits ? q.total_wait / q.num_waits : 0;
+      memcpy(&out_frame[i], &q_len, 2); i += 2;
+      memcpy(&out_frame[i], &q.max_depth, 2); i += 2;
+      memcpy(&out_frame[i], &avg_wait, 4); i += 4;
+      memcpy(&out_frame[i], &q.max_wait, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_PAYLOAD_TYPES) {   // {rx, tx} for each of the 16 payload types
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_PAYLOAD_TYPES;
+      for (int t = 0; t < 16; t++) {
+        uint32_t rx = getNumRecvByType(t);
+        uint32_t tx = getNumSentByType(t);
+        memcpy(&out_frame[i], &rx, 4); i += 4;
+        memcpy(&out_frame[i], &tx, 4); i += 4;
+      }
+      _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_LOOP) {
+      if (!mesh::LoopProfiler::isEnabled()) {
+        writeErrFrame(ERR_CODE_UNSUPPORTED_CMD);
+      } else if (len >= 3) {   // one section: count, avg_us, max_us, then histogram
+        const mesh::LoopSectionStats* st = mesh::LoopProfiler::getStats(cmd_frame[2]);
+        if (st == NULL) {
+          writeErrFrame(ERR_CODE_ILLEGAL_ARG);
+        } else {
+          int i = 0;
+          out_frame[i++] = RESP_CODE_STATS;
+          out_frame[i++] = STATS_TYPE_LOOP;
+          out_frame[i++] = cmd_frame[2];
+          uint32_t avg_us = st->count ? (uint32_t)(st->total_us / st->count) : 0;
+          memcpy(&out_frame[i], &st->count, 4); i += 4;
+          memcpy(&out_frame[i], &avg_us, 4); i += 4;
+          memcpy(&out_frame[i], &st->max_us, 4); i += 4;
+          out_frame[i++] = PROF_NUM_BUCKETS;
+          memcpy(&out_frame[i], st->buckets, 2*PROF_NUM_BUCKETS); i += 2*PROF_NUM_BUCKETS;
+          _serial->writeFrame(out_frame, i);
+        }
+      } else {   // summary: {section, count, avg_us, max_us} for each non-empty section
+        int i = 0;
+        out_frame[i++] = RESP_CODE_STATS;
+        out_frame[i++] = STATS_TYPE_LOOP;
+        for (int s = 0; s < PROF_NUM_SECTIONS && i + 13 <= MAX_FRAME_SIZE; s++) {
+          const mesh::LoopSectionStats* st = mesh::LoopProfiler::getStats(s);
+          if (st->count == 0) continue;
+
+          uint32_t avg_us = (uint32_t)(st->total_us / st->count);
+          out_frame[i++] = s;
+          memcpy(&out_frame[i], &st->count, 4); i += 4;
+          memcpy(&out_frame[i], &avg_us, 4); i += 4;
+          memcpy(&out_frame[i], &st->max_us, 4); i += 4;
+        }
+        _serial->writeFrame(out_frame, i);
+      }
     } else {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG); // invalid stats sub-type
     }
@@ -1921,6 +2060,9 @@ void MyMesh::loop() {
     saveContacts();
     dirty_contacts_expiry = 0;
   }
+  if (dirty_secrets_expiry && millisHasNowPassed(dirty_secrets_expiry)) {
+    savePendingSecrets();
+  }
 
 #ifdef DISPLAY_CLASS
   if (_ui) _ui->setHasConnection(_serial->isConnected());
@@ -63,6 +63,10 @@
 #define OFFLINE_QUEUE_SIZE 16
 #endif
 
+#ifndef DUTY_CYCLE_LIMIT_PERCENT
+#define DUTY_CYCLE_LIMIT_PERCENT 0    // hourly TX duty cycle limit, eg. 10 for EU 869.4-869.65 MHz. 0 = no limit
+#endif
+
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -107,6 +111,7 @@ public:
 
 protected:
   float getAirtimeBudgetFactor() const override;
+  float getDutyCycleLimit() const override { return DUTY_CYCLE_LIMIT_PERCENT / 100.0f; }
   int getInterferenceThreshold() const override;
   int calcRxDelay(float score, uint32_t air_time) const override;
   uint8_t getExtraAckTransmitCount() const override;
@@ -120,6 +125,7 @@ protected:
   bool onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_t in_path_len, uint8_t* out_path, uint8_t out_path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
   void onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path_len, const uint8_t* path) override;
   void onContactPathUpdated(const ContactInfo &contact) override;
+  void onSharedSecretCalculated(const ContactInfo &contact) override;
   ContactInfo* processAck(const uint8_t *data) override;
   void queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packet *pkt, uint32_t sender_timestamp,
                     const uint8_t *extra, int extra_len, const char *text);
@@ -148,6 +154,9 @@ protected:
   // DataStoreHost methods
   bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
   bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+  ContactInfo* lookupContactForLoad(const uint8_t* key_prefix, int prefix_len) override { return lookupContactByPubKey(key_prefix, prefix_len); }
+  bool onContactDeleted(ContactInfo& contact) override { return removeContact(contact); }
+  bool onSharedSecretLoaded(const uint8_t* pub_key, const uint8_t* secret) override { return restoreSharedSecret(pub_key, secret); }
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
 
@@ -159,6 +168,7 @@ public:
   void savePrefs() { _store->savePrefs(_prefs, sensors.node_lat, sensors.node_lon); }
   void factoryReset() { _store->formatFileSystem(); }
   void saveContacts() { _store->saveContacts(this); }
+  void savePendingSecrets();
   void saveChannels() { _store->saveChannels(this); }
 
 private:
@@ -199,6 +209,10 @@ private:
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  unsigned long dirty_secrets_expiry;
+  #define PENDING_SECRETS_MAX   8
+  uint8_t pending_secrets[PENDING_SECRETS_MAX][PUB_KEY_SIZE];   // contacts whose new shared secret isn't persisted yet
+  int num_pending_secrets;
 
   TransportKey send_scope;
 
@@ -1,5 +1,6 @@
 #include <Arduino.h>   // needed for PlatformIO
 #include <Mesh.h>
+#include <LoopProfiler.h>
 #include "MyMesh.h"
 
 // Believe it or not, this std C function is busted on some platforms!
@@ -35,6 +36,9 @@ static uint32_t _atoi(const char* sp) {
 #endif
 
 #ifdef ESP32
+  #if ENABLE_CRYPTO_WORKER
+    #include <helpers/esp32/ESP32CryptoWorker.h>
+  #endif
   #ifdef WIFI_SSID
     #include <helpers/esp32/SerialWifiInterface.h>
     SerialWifiInterface serial_interface;
@@ -93,6 +97,9 @@ static uint32_t _atoi(const char* sp) {
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+#if defined(ESP32) && ENABLE_CRYPTO_WORKER
+  ESP32CryptoWorker crypto_worker;
+#endif
 MyMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables, store
    #ifdef DISPLAY_CLASS
       , &ui_task
@@ -204,6 +211,11 @@ void setup() {
 #elif defined(ESP32)
   SPIFFS.begin(true);
   store.begin();
+  #if ENABLE_CRYPTO_WORKER
+  if (crypto_worker.begin()) {   // Ed25519 advert verify on core 0
+    the_mesh.setCryptoWorker(&crypto_worker);
+  }
+  #endif
   the_mesh.begin(
     #ifdef DISPLAY_CLASS
         disp != NULL
@@ -211,6 +223,11 @@ void setup() {
         false
     #endif
   );
+  #if RADIO_TASK_ENABLED
+  if (!radio_driver.startRadioTask()) {   // RX read out on DIO1 interrupt, not loop() polling
+    MESH_DEBUG_PRINTLN("setup: radio task failed to start, polling instead");
+  }
+  #endif
 
 #ifdef WIFI_SSID
   WiFi.begin(WIFI_SSID, WIFI_PWD);
@@ -237,8 +254,15 @@ void setup() {
 }
 
 void loop() {
-  the_mesh.loop();
-  sensors.loop();
+  LOOP_PROFILE_SCOPE(PROF_LOOP_TOTAL);
+  {
+    LOOP_PROFILE_SCOPE(PROF_MESH_LOOP);
+    the_mesh.loop();
+  }
+  {
+    LOOP_PROFILE_SCOPE(PROF_SENSORS);
+    sensors.loop();
+  }
 #ifdef DISPLAY_CLASS
   
   // G0 button press - send advertisement
@@ -271,7 +295,10 @@ void loop() {
     ui_task.requestRefresh();
   }
   
-  ui_task.loop();  // UI refresh after button handling
+  {
+    LOOP_PROFILE_SCOPE(PROF_UI_LOOP);
+    ui_task.loop();  // UI refresh after button handling
+  }
 #endif
   rtc_clock.tick();
 }
@@ -0,0 +1,341 @@
+#include <Arduino.h>
+#include "ChatHistory.h"
+#include <stdlib.h>
+
+static void copyText(char* dest, const char* src, int dest_size) {
+  strncpy(dest, src, dest_size - 1);
+  dest[dest_size - 1] = '\0';
+}
+
+static void fromLogRecord(ChatMessage& msg, const ChatLogRecord& rec) {
+  copyText(msg.from_name, rec.from_name, sizeof(msg.from_name));
+  copyText(msg.text, rec.text, sizeof(msg.text));
+  memcpy(&msg.key, rec.key, sizeof(msg.key));
+  msg.is_outgoing = (rec.flags & CHAT_LOG_FLAG_OUTGOING) != 0;
+  msg.timestamp = rec.timestamp;
+  msg.seq = 0;
+  msg.prev_in_conv = -1;
+  msg.log_seq = rec.seq;
+  msg.log_pos = rec.pos;
+  msg.prev_log_pos = rec.prev_pos;
+}
+
+static void toLogRecord(ChatLogRecord& rec, const ChatMessage& msg) {
+  memcpy(rec.key, &msg.key, CHAT_LOG_KEY_LEN);
+  rec.flags = msg.is_outgoing ? CHAT_LOG_FLAG_OUTGOING : 0;
+  rec.seq = msg.log_seq;
+  rec.timestamp = msg.timestamp;
+  rec.pos = msg.log_pos;
+  rec.prev_pos = msg.prev_log_pos;
+  copyText(rec.from_name, msg.from_name, sizeof(rec.from_name));
+  copyText(rec.text, msg.text, sizeof(rec.text));
+}
+
+ChatHistory::ChatHistory() {
+  _msgs = NULL;
+  _capacity = _count = _next = 0;
+  _next_seq = 0;
+  _in_psram = false;
+  _num_convs = 0;
+  _store = NULL;
+  _scrollback = NULL;
+  _scrollback_capacity = _scrollback_first = _scrollback_count = 0;
+  memset(&_scrollback_key, 0, sizeof(_scrollback_key));
+  _scrollback_start = _scrollback_next = CHAT_LOG_POS_NONE;
+  _page_pos = NULL;
+  _num_page_pos = _page_pos_capacity = 0;
+}
+
+bool ChatHistory::begin(DataStore* store) {
+  if (_msgs) return true;
+
+  int scrollback = CHAT_SCROLLBACK_MESSAGES;
+#if defined(ESP32) && defined(BOARD_HAS_PSRAM)
+  if (psramFound()) {
+    _msgs = (ChatMessage *) ps_calloc(MAX_CHAT_MESSAGES_PSRAM, sizeof(ChatMessage));
+    if (_msgs) {
+      _capacity = MAX_CHAT_MESSAGES_PSRAM;
+      _in_psram = true;
+      scrollback *= 10;
+    }
+  }
+#endif
+  if (_msgs == NULL) {
+    _msgs = (ChatMessage *) calloc(MAX_CHAT_MESSAGES, sizeof(ChatMessage));
+    if (_msgs == NULL) return false;
+    _capacity = MAX_CHAT_MESSAGES;
+  }
+  Serial.printf("[Chat] History: %d messages, %d bytes in %s\n", _capacity, _capacity * (int)sizeof(ChatMessage),
+                _in_psram ? "PSRAM" : "RAM");
+
+  _store = store;
+  if (_store) {
+#if defined(ESP32) && defined(BOARD_HAS_PSRAM)
+    if (_in_psram) _scrollback = (ChatMessage *) ps_calloc(scrollback, sizeof(ChatMessage));
+#endif
+    if (_scrollback == NULL) {
+      scrollback = CHAT_SCROLLBACK_MESSAGES;
+      _scrollback = (ChatMessage *) calloc(scrollback, sizeof(ChatMessage));
+    }
+    _scrollback_capacity = _scrollback ? scrollback : 0;
+    loadTail();
+  }
+  return true;
+}
+
+void ChatHistory::loadTail() {
+  // newest messages in log, oldest first
+  uint32_t next_seq = _store->getChatLogNextSeq();
+  uint32_t after_seq = next_seq > (uint32_t)_capacity ? next_seq - 1 - _capacity : 0;
+
+  ChatLogRecord recs[CHAT_SCROLLBACK_PAGE];
+  uint32_t cursor = CHAT_LOG_POS_NONE;
+  int n;
+  int total = 0;
+  while ((n = getMessagesSince(after_seq, cursor, recs, CHAT_SCROLLBACK_PAGE)) > 0) {
+    for (int i = 0; i < n; i++) {
+      ChatConvKey key;
+      memcpy(&key, recs[i].key, sizeof(key));
+      append(key, recs[i].from_name, recs[i].text, (recs[i].flags & CHAT_LOG_FLAG_OUTGOING) != 0, recs[i].timestamp, &recs[i]);
+    }
+    total += n;
+  }
+  Serial.printf("[Chat] Loaded %d messages from log\n", total);
+}
+
+ChatHistory::Conversation* ChatHistory::findConversation(const ChatConvKey& key) const {
+  for (int i = 0; i < _num_convs; i++) {
+    if (_convs[i].key == key) return (Conversation *) &_convs[i];
+  }
+  return NULL;
+}
+
+ChatHistory::Conversation* ChatHistory::addConversation(const ChatConvKey& key) {
+  Conversation* c;
+  if (_num_convs < MAX_CHAT_CONVERSATIONS) {
+    c = &_convs[_num_convs++];
+  } else {
+    // table full, recycle conversation with oldest newest-message (its messages become unreachable)
+    c = &_convs[0];
+    for (int i = 1; i < _num_convs; i++) {
+      Conversation* t = &_convs[i];
+      if (t->newest < 0 || (c->newest >= 0 && _msgs[t->newest].seq < _msgs[c->newest].seq)) c = t;
+    }
+    if (c->newest >= 0) {
+      for (int s = c->newest; s >= 0; ) {    // orphan its messages, so evict() doesn't count them against new owner
+        int prev = _msgs[s].prev_in_conv;
+        if (prev >= 0 && _msgs[prev].seq >= _msgs[s].seq) prev = -1;
+        _msgs[s].key.is_channel = 0xFF;
+        s = prev;
+      }
+    }
+  }
+  c->key = key;
+  c->newest = -1;
+  c->count = 0;
+  return c;
+}
+
+void ChatHistory::evict(int slot) {
+  ChatMessage& old = _msgs[slot];
+  Conversation* c = findConversation(old.key);
+  if (c) {
+    if (c->count > 0) c->count--;
+    if (c->newest == slot) c->newest = -1;   // was its only message
+  }
+  _count--;
+}
+
+const ChatMessage* ChatHistory::append(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing,
+                                       uint32_t timestamp, const ChatLogRecord* logged) {
+  int slot = _next;
+  if (_count == _capacity) evict(slot);   // overwrite oldest
+
+  Conversation* c = findConversation(key);
+  if (c == NULL) c = addConversation(key);
+
+  ChatMessage& msg = _msgs[slot];
+  copyText(msg.from_name, from_name, sizeof(msg.from_name));
+  copyText(msg.text, text, sizeof(msg.text));
+  msg.key = key;
+  msg.is_outgoing = is_outgoing;
+  msg.timestamp = timestamp;
+  msg.seq = _next_seq++;
+  msg.prev_in_conv = c->newest;
+  if (logged) {
+    msg.log_seq = logged->seq;
+    msg.log_pos = logged->pos;
+    msg.prev_log_pos = logged->prev_pos;
+  } else {
+    msg.log_seq = msg.seq;
+    msg.log_pos = msg.prev_log_pos = CHAT_LOG_POS_NONE;
+  }
+
+  c->newest = slot;
+  c->count++;
+  _count++;
+  _next = (_next + 1) % _capacity;
+  return &msg;
+}
+
+const ChatMessage* ChatHistory::add(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing, uint32_t timestamp) {
+  if (_msgs == NULL && !begin()) return NULL;
+
+  if (_store) {
+    ChatLogRecord rec;
+    memcpy(rec.key, &key, CHAT_LOG_KEY_LEN);
+    rec.flags = is_outgoing ? CHAT_LOG_FLAG_OUTGOING : 0;
+    rec.timestamp = timestamp;
+    copyText(rec.from_name, from_name, sizeof(rec.from_name));
+    copyText(rec.text, text, sizeof(rec.text));
+    if (_store->appendChatMessage(rec)) {
+      return append(key, from_name, text, is_outgoing, timestamp, &rec);
+    }
+    Serial.println("[Chat] Failed to write chat log");
+  }
+  return append(key, from_name, text, is_outgoing, timestamp, NULL);
+}
+
+int ChatHistory::getCount(const ChatConvKey& key) const {
+  Conversation* c = findConversation(key);
+  return c ? c->count : 0;
+}
+
+bool ChatHistory::isScrollback(const ChatMessage* msg) const {
+  return _scrollback && msg >= _scrollback && msg < &_scrollback[_scrollback_capacity];
+}
+
+int ChatHistory::scrollbackDepth(const ChatMessage* msg) const {
+  int slot = msg - _scrollback;
+  return _scrollback_first + (slot - _scrollback_first % _scrollback_capacity + _scrollback_capacity) % _scrollback_capacity;
+}
+
+void ChatHistory::addPagePos(int page, uint32_t pos) {
+  if (page != _num_page_pos) return;   // already known
+  if (_num_page_pos >= _page_pos_capacity) {
+    int new_capacity = _page_pos_capacity + 32;
+    uint32_t* p = (uint32_t *) malloc(sizeof(uint32_t) * new_capacity);
+    if (p == NULL) return;   // can still get there, from an earlier page
+    if (_page_pos) {
+      memcpy(p, _page_pos, sizeof(uint32_t) * _num_page_pos);
+      free(_page_pos);
+    }
+    _page_pos = p;
+    _page_pos_capacity = new_capacity;
+  }
+  _page_pos[_num_page_pos++] = pos;
+}
+
+bool ChatHistory::loadOlderPage() {
+  if (_scrollback_next == CHAT_LOG_POS_NONE) return false;   // at start of log
+
+  if (_scrollback_count + CHAT_SCROLLBACK_PAGE > _scrollback_capacity) {   // window full, drop newest page
+    _scrollback_first += CHAT_SCROLLBACK_PAGE;
+    _scrollback_count -= CHAT_SCROLLBACK_PAGE;
+  }
+  ChatLogRecord recs[CHAT_SCROLLBACK_PAGE];
+  int n = _store->readChatHistory(_scrollback_next, recs, CHAT_SCROLLBACK_PAGE);
+  int depth = _scrollback_first + _scrollback_count;
+  for (int i = 0; i < n; i++) {
+    fromLogRecord(_scrollback[(depth + i) % _scrollback_capacity], recs[i]);
+  }
+  _scrollback_count += n;
+
+  // a short page means start of log (or an unreadable record), either way no further back
+  _scrollback_next = n == CHAT_SCROLLBACK_PAGE ? recs[n - 1].prev_pos : CHAT_LOG_POS_NONE;
+  if (_scrollback_next != CHAT_LOG_POS_NONE) addPagePos((depth + n) / CHAT_SCROLLBACK_PAGE, _scrollback_next);
+  return n > 0;
+}
+
+const ChatMessage* ChatHistory::getScrollback(const ChatConvKey& key, uint32_t start, int depth) {
+  if (_scrollback == NULL || start == CHAT_LOG_POS_NONE) return NULL;
+
+  if (!(_scrollback_key == key) || _scrollback_start != start) {   // different conversation, or ring has moved on
+    _scrollback_key = key;
+    _scrollback_start = start;
+    _scrollback_first = _scrollback_count = 0;
+    _scrollback_next = start;
+    _num_page_pos = 0;
+    addPagePos(0, start);
+  }
+  if (depth < _scrollback_first) {   // newer than window, restart it from that page
+    int page = depth / CHAT_SCROLLBACK_PAGE;
+    if (page >= _num_page_pos) page = _num_page_pos - 1;   // (page pos wasn't stored, walk from an earlier one)
+    if (page < 0) {
+      page = 0;
+      _scrollback_next = start;
+    } else {
+      _scrollback_next = _page_pos[page];
+    }
+    _scrollback_first = page * CHAT_SCROLLBACK_PAGE;
+    _scrollback_count = 0;
+  }
+  while (depth >= _scrollback_first + _scrollback_count) {
+    if (!loadOlderPage()) return NULL;
+  }
+  return &_scrollback[depth % _scrollback_capacity];
+}
+
+const ChatMessage* ChatHistory::ringOlder(const ChatMessage* msg) const {
+  int prev = msg->prev_in_conv;
+  if (prev >= 0) {
+    // slot may since have been overwritten (by a newer message)
+    const ChatMessage* p = &_msgs[prev];
+    if (p->seq < msg->seq && p->key == msg->key) return p;
+  }
+  return NULL;
+}
+
+const ChatMessage* ChatHistory::getNewest(const ChatConvKey& key) {
+  Conversation* c = findConversation(key);
+  if (c && c->newest >= 0) return &_msgs[c->newest];
+
+  // none in ring, maybe in log
+  if (_store) return getScrollback(key, _store->getChatLogNewest((const uint8_t *) &key), 0);
+  return NULL;
+}
+
+const ChatMessage* ChatHistory::getOlder(const ChatMessage* msg) {
+  if (isScrollback(msg)) return getScrollback(_scrollback_key, _scrollback_start, scrollbackDepth(msg) + 1);
+
+  const ChatMessage* p = ringOlder(msg);
+  if (p) return p;
+
+  // older than ring, maybe in log
+  if (_store) return getScrollback(msg->key, msg->prev_log_pos, 0);
+  return NULL;
+}
+
+const ChatMessage* ChatHistory::getByDepth(const ChatConvKey& key, int depth) {
+  const ChatMessage* m = getNewest(key);
+  for (int d = 0; m && d < depth; d++) {
+    if (isScrollback(m)) return getScrollback(_scrollback_key, _scrollback_start, scrollbackDepth(m) + depth - d);
+
+    const ChatMessage* p = ringOlder(m);
+    if (p == NULL) {   // rest is in log
+      return _store ? getScrollback(m->key, m->prev_log_pos, depth - d - 1) : NULL;
+    }
+    m = p;
+  }
+  return m;
+}
+
+const ChatMessage* ChatHistory::getByAge(int age) const {
+  if (age < 0 || age >= _count) return NULL;
+  return &_msgs[(_next - 1 - age + _capacity) % _capacity];
+}
+
+int ChatHistory::getMessagesSince(uint32_t after_seq, uint32_t& cursor, ChatLogRecord dest[], int max) {
+  if (_store) {
+    if (cursor == CHAT_LOG_POS_NONE) cursor = _store->findChatLogStart(after_seq);
+    return _store->readChatLog(cursor, after_seq, dest, max);
+  }
+
+  // no log, just what's in ring
+  int n = 0;
+  for (int age = _count - 1; age >= 0 && n < max; age--) {
+    const ChatMessage* msg = getByAge(age);
+    if (msg->log_seq > after_seq) toLogRecord(dest[n++], *msg);
+  }
+  return n;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "../DataStore.h"
+
+#ifndef MAX_CHAT_MESSAGES
+  #define MAX_CHAT_MESSAGES          100    // when in internal RAM
+#endif
+#ifndef MAX_CHAT_MESSAGES_PSRAM
+  #define MAX_CHAT_MESSAGES_PSRAM   1000    // when board has PSRAM (BOARD_HAS_PSRAM)
+#endif
+#ifndef MAX_CHAT_CONVERSATIONS
+  #define MAX_CHAT_CONVERSATIONS      32
+#endif
+#ifndef CHAT_SCROLLBACK_MESSAGES
+  #define CHAT_SCROLLBACK_MESSAGES    32    // window of older messages of a conversation paged in from flash (x10 with PSRAM)
+#endif
+#ifndef CHAT_SCROLLBACK_PAGE
+  #define CHAT_SCROLLBACK_PAGE         8    // messages read from flash at a time
+#endif
+
+static_assert(CHAT_SCROLLBACK_MESSAGES % CHAT_SCROLLBACK_PAGE == 0, "CHAT_SCROLLBACK_MESSAGES must be a multiple of page");
+static_assert(CHAT_SCROLLBACK_MESSAGES >= 3 * CHAT_SCROLLBACK_PAGE, "scrollback window too small, paging would evict messages on screen");
+
+#define CHAT_KEY_PREFIX_LEN   6
+
+/**
+ * \brief  Identifies a conversation: a contact (by pub_key prefix) or a channel (by channel index)
+*/
+struct ChatConvKey {
+  uint8_t is_channel;
+  uint8_t id[CHAT_KEY_PREFIX_LEN];   // contact pub_key prefix, or channel index in id[0]
+
+  static ChatConvKey forContact(const uint8_t* pub_key) {
+    ChatConvKey k;
+    k.is_channel = 0;
+    memcpy(k.id, pub_key, CHAT_KEY_PREFIX_LEN);
+    return k;
+  }
+  static ChatConvKey forChannel(int channel_idx) {
+    ChatConvKey k;
+    memset(&k, 0, sizeof(k));
+    k.is_channel = 1;
+    k.id[0] = channel_idx;
+    return k;
+  }
+  bool operator==(const ChatConvKey& other) const { return memcmp(this, &other, sizeof(ChatConvKey)) == 0; }
+};
+
+static_assert(sizeof(ChatConvKey) == CHAT_LOG_KEY_LEN, "ChatConvKey must match chat log key");
+
+// Message structure for chat history
+struct ChatMessage {
+  char text[128];
+  char from_name[32];
+  ChatConvKey key;      // conversation this message belongs to
+  bool is_outgoing;
+  uint32_t timestamp;
+  uint32_t seq;         // order of arrival, across all conversations
+  int16_t prev_in_conv; // slot of previous (older) message in same conversation, or -1
+  uint32_t log_seq;     // seq in chat log (or 'seq' if there is no store)
+  uint32_t log_pos;     // position in chat log, or CHAT_LOG_POS_NONE
+  uint32_t prev_log_pos;
+
+  bool isChannel() const { return key.is_channel != 0; }
+};
+
+/**
+ * \brief  Chat messages for all conversations, in a ring buffer (oldest overwritten when full). Each message
+ *         links to the previous one of its conversation, so appending is O(1), and walking a conversation
+ *         from newest back only touches that conversation's messages.
+ *         The buffer is allocated from PSRAM when available, allowing a much larger history.
+ *         With a DataStore, messages are also appended to its chat log, the ring is filled from the log's
+ *         tail at boot, and walking back past the ring pages older messages in from the log, into a sliding
+ *         window (newest page is dropped when an older one is needed, so the whole log can be scrolled).
+*/
+class ChatHistory {
+  struct Conversation {
+    ChatConvKey key;
+    int16_t newest;     // slot of newest message, or -1 if none
+    uint16_t count;
+  };
+
+  ChatMessage* _msgs;
+  int _capacity;
+  int _count;
+  int _next;            // next slot to write
+  uint32_t _next_seq;
+  bool _in_psram;
+  Conversation _convs[MAX_CHAT_CONVERSATIONS];
+  int _num_convs;
+
+  DataStore* _store;
+  ChatMessage* _scrollback;     // window of older messages of one conversation, from the log. Ring, by depth
+  int _scrollback_capacity;     // multiple of CHAT_SCROLLBACK_PAGE
+  int _scrollback_first;        // depth of newest message in window (depth 0 = log record at _scrollback_start)
+  int _scrollback_count;
+  ChatConvKey _scrollback_key;
+  uint32_t _scrollback_start;   // log pos of newest message older than the ring
+  uint32_t _scrollback_next;    // log pos of next (older) page, or CHAT_LOG_POS_NONE if at start of log
+  uint32_t* _page_pos;          // log pos of each page paged in so far, so can jump back to it
+  int _num_page_pos, _page_pos_capacity;
+
+  Conversation* findConversation(const ChatConvKey& key) const;
+  Conversation* addConversation(const ChatConvKey& key);
+  void evict(int slot);
+  const ChatMessage* append(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing,
+                            uint32_t timestamp, const ChatLogRecord* logged);
+  const ChatMessage* ringOlder(const ChatMessage* msg) const;
+  bool isScrollback(const ChatMessage* msg) const;
+  int scrollbackDepth(const ChatMessage* msg) const;
+  const ChatMessage* getScrollback(const ChatConvKey& key, uint32_t start, int depth);
+  bool loadOlderPage();
+  void addPagePos(int page, uint32_t pos);
+  void loadTail();
+
+public:
+  ChatHistory();
+
+  /**
+   * \brief  allocates the buffer, MAX_CHAT_MESSAGES_PSRAM if PSRAM available, otherwise MAX_CHAT_MESSAGES
+   * \param  store  if not NULL, messages are persisted in its chat log (and recent ones loaded from it now)
+  */
+  bool begin(DataStore* store = NULL);
+
+  int getCapacity() const { return _capacity; }
+  bool isInPSRAM() const { return _in_psram; }
+
+  /**
+   * \returns  the new message, with text and from_name truncated to fit
+  */
+  const ChatMessage* add(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing, uint32_t timestamp);
+
+  /**
+   * \returns  number of messages, in all conversations
+  */
+  int getCount() const { return _count; }
+
+  /**
+   * \returns  number of messages in the given conversation
+  */
+  int getCount(const ChatConvKey& key) const;
+
+  /**
+   * \returns  newest message of the given conversation, or NULL if none
+  */
+  const ChatMessage* getNewest(const ChatConvKey& key);
+
+  /**
+   * \returns  the message before 'msg' in the same conversation, or NULL if 'msg' is its oldest
+   *           NOTE: may read from flash. Scrollback messages previously returned for another conversation become invalid.
+  */
+  const ChatMessage* getOlder(const ChatMessage* msg);
+
+  /**
+   * \brief  same as walking back 'depth' times with getOlder() from getNewest(), but once past the ring, goes
+   *          straight to the page holding it (at most one page read, when scrolling a message at a time)
+   * \returns  NULL if conversation has no message that old
+  */
+  const ChatMessage* getByDepth(const ChatConvKey& key, int depth);
+
+  /**
+   * \param  age  0 = newest message, of any conversation, up to getCount() - 1
+  */
+  const ChatMessage* getByAge(int age) const;
+
+  /**
+   * \brief  reads up to 'max' messages with log_seq > 'after_seq', oldest first. From the chat log if there is
+   *          one, so can go back further than the ring. 'cursor' must start as CHAT_LOG_POS_NONE, and be
+   *          passed back unchanged to continue.
+   * \returns  number of messages read
+  */
+  int getMessagesSince(uint32_t after_seq, uint32_t& cursor, ChatLogRecord dest[], int max);
+};
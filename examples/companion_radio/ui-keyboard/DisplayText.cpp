@@ -0,0 +1,120 @@
+#include "DisplayText.h"
+
+// Length of UTF-8 sequence, by lead byte. 0 = continuation byte, or never valid (C0, C1, F5..FF)
+static const uint8_t utf8_seq_len[256] = {
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,   // 00..1F
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,   // 20..3F
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,   // 40..5F
+  1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,   // 60..7F
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,   // 80..9F
+  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,   // A0..BF
+  0,0,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,   // C0..DF
+  3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3, 4,4,4,4,4,0,0,0,0,0,0,0,0,0,0,0,   // E0..FF
+};
+
+// payload bits of lead byte, by sequence length
+static const uint8_t utf8_lead_mask[5] = { 0, 0x7F, 0x1F, 0x0F, 0x07 };
+
+#define UTF8_INVALID   0xFFFFFFFF
+
+static uint32_t decodeUTF8(const uint8_t*& p) {
+  int len = utf8_seq_len[*p];
+  if (len == 0) {
+    p++;
+    return UTF8_INVALID;
+  }
+  uint32_t cp = *p & utf8_lead_mask[len];
+  for (int i = 1; i < len; i++) {
+    if ((p[i] & 0xC0) != 0x80) {   // truncated (also stops at the terminator)
+      p++;
+      return UTF8_INVALID;
+    }
+    cp = (cp << 6) | (p[i] & 0x3F);
+  }
+  p += len;
+  return cp;
+}
+
+struct Transliteration {
+  uint16_t cp;
+  char ascii[3];
+};
+
+// MUST be sorted by 'cp'
+static constexpr Transliteration translit_map[] = {
+  { 0x00C0, "A" }, { 0x00C1, "A" }, { 0x00C2, "A" }, { 0x00C3, "A" }, { 0x00C4, "A" }, { 0x00C5, "A" },  // À Á Â Ã Ä Å
+  { 0x00C6, "AE" }, { 0x00C7, "C" },                                                                      // Æ Ç
+  { 0x00C8, "E" }, { 0x00C9, "E" }, { 0x00CA, "E" }, { 0x00CB, "E" },                                     // È É Ê Ë
+  { 0x00CC, "I" }, { 0x00CD, "I" }, { 0x00CE, "I" }, { 0x00CF, "I" },                                     // Ì Í Î Ï
+  { 0x00D0, "D" }, { 0x00D1, "N" },                                                                       // Ð Ñ
+  { 0x00D2, "O" }, { 0x00D3, "O" }, { 0x00D4, "O" }, { 0x00D5, "O" }, { 0x00D6, "O" }, { 0x00D8, "O" },  // Ò Ó Ô Õ Ö Ø
+  { 0x00D9, "U" }, { 0x00DA, "U" }, { 0x00DB, "U" }, { 0x00DC, "U" },                                     // Ù Ú Û Ü
+  { 0x00DD, "Y" }, { 0x00DE, "TH" }, { 0x00DF, "ss" },                                                    // Ý Þ ß
+  { 0x00E0, "a" }, { 0x00E1, "a" }, { 0x00E2, "a" }, { 0x00E3, "a" }, { 0x00E4, "a" }, { 0x00E5, "a" },  // à á â ã ä å
+  { 0x00E6, "ae" }, { 0x00E7, "c" },                                                                      // æ ç
+  { 0x00E8, "e" }, { 0x00E9, "e" }, { 0x00EA, "e" }, { 0x00EB, "e" },                                     // è é ê ë
+  { 0x00EC, "i" }, { 0x00ED, "i" }, { 0x00EE, "i" }, { 0x00EF, "i" },                                     // ì í î ï
+  { 0x00F0, "d" }, { 0x00F1, "n" },                                                                       // ð ñ
+  { 0x00F2, "o" }, { 0x00F3, "o" }, { 0x00F4, "o" }, { 0x00F5, "o" }, { 0x00F6, "o" }, { 0x00F8, "o" },  // ò ó ô õ ö ø
+  { 0x00F9, "u" }, { 0x00FA, "u" }, { 0x00FB, "u" }, { 0x00FC, "u" },                                     // ù ú û ü
+  { 0x00FD, "y" }, { 0x00FE, "th" }, { 0x00FF, "y" },                                                     // ý þ ÿ
+  { 0x0102, "A" }, { 0x0103, "a" }, { 0x0104, "A" }, { 0x0105, "a" }, { 0x0106, "C" }, { 0x0107, "c" },  // Ă ă Ą ą Ć ć
+  { 0x010C, "C" }, { 0x010D, "c" }, { 0x010E, "D" }, { 0x010F, "d" },                                     // Č č Ď ď
+  { 0x0118, "E" }, { 0x0119, "e" }, { 0x011A, "E" }, { 0x011B, "e" }, { 0x011E, "G" }, { 0x011F, "g" },  // Ę ę Ě ě Ğ ğ
+  { 0x0130, "I" }, { 0x0131, "i" },                                                                       // İ ı
+  { 0x0141, "L" }, { 0x0142, "l" }, { 0x0143, "N" }, { 0x0144, "n" },                                     // Ł ł Ń ń
+  { 0x0150, "O" }, { 0x0151, "o" }, { 0x0152, "OE" }, { 0x0153, "oe" },                                   // Ő ő Œ œ
+  { 0x0158, "R" }, { 0x0159, "r" }, { 0x015A, "S" }, { 0x015B, "s" }, { 0x015E, "S" }, { 0x015F, "s" },  // Ř ř Ś ś Ş ş
+  { 0x0160, "S" }, { 0x0161, "s" }, { 0x0164, "T" }, { 0x0165, "t" },                                     // Š š Ť ť
+  { 0x0170, "U" }, { 0x0171, "u" },                                                                       // Ű ű
+  { 0x0179, "Z" }, { 0x017A, "z" }, { 0x017B, "Z" }, { 0x017C, "z" }, { 0x017D, "Z" }, { 0x017E, "z" },  // Ź ź Ż ż Ž ž
+  { 0x0218, "S" }, { 0x0219, "s" }, { 0x021A, "T" }, { 0x021B, "t" },                                     // Ș ș Ț ț
+};
+
+#define TRANSLIT_MAP_SIZE   ((int)(sizeof(translit_map) / sizeof(translit_map[0])))
+
+static constexpr bool isSortedFrom(int i) {
+  return i + 1 >= TRANSLIT_MAP_SIZE || (translit_map[i].cp < translit_map[i + 1].cp && isSortedFrom(i + 1));
+}
+static_assert(isSortedFrom(0), "translit_map must be sorted by code point");
+
+static const char* lookupTransliteration(uint32_t cp) {
+  if (cp < translit_map[0].cp || cp > translit_map[TRANSLIT_MAP_SIZE - 1].cp) return NULL;
+
+  int lo = 0, hi = TRANSLIT_MAP_SIZE - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (translit_map[mid].cp == cp) return translit_map[mid].ascii;
+    if (translit_map[mid].cp < cp) {
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return NULL;
+}
+
+int transliterateUTF8(const char* input, char* output, int max_len) {
+  const uint8_t* p = (const uint8_t*) input;
+  int out_idx = 0;
+
+  while (*p && out_idx < max_len - 1) {
+    if (*p < 0x80) {   // ASCII, keep printable only
+      if (*p >= 0x20 && *p <= 0x7E) output[out_idx++] = *p;
+      p++;
+      continue;
+    }
+
+    const char* replacement = lookupTransliteration(decodeUTF8(p));
+    if (replacement) {
+      int len = strlen(replacement);
+      if (out_idx + len > max_len - 1) break;   // doesn't fit
+      memcpy(&output[out_idx], replacement, len);
+      out_idx += len;
+    }
+    // else emoji or other unsupported character, skip it
+  }
+
+  output[out_idx] = '\0';
+  return out_idx;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef NAME_TEXT_CACHE_SIZE
+  #define NAME_TEXT_CACHE_SIZE       8    // contact/channel names on screen at once
+#endif
+#ifndef MESSAGE_TEXT_CACHE_SIZE
+  #define MESSAGE_TEXT_CACHE_SIZE   12    // chat messages on screen at once
+#endif
+
+/**
+ * \brief  converts UTF-8 'input' to printable ASCII, for the display's built-in font. Latin letters with
+ *         diacritics are transliterated (eg. 'ł' -> 'l', 'ß' -> 'ss'), other non-ASCII characters, control
+ *         characters and malformed sequences are dropped.
+ * \returns  length of 'output'
+*/
+int transliterateUTF8(const char* input, char* output, int max_len);
+
+/**
+ * \brief  Transliterated (and optionally ellipsized) copies of strings which are drawn every frame, eg. contact
+ *         names or chat messages. Entries are looked up by an id (eg. message seq) and a hash of the source
+ *         text, so a changed source (eg. renamed contact) is re-converted. Least recently used entry is replaced.
+*/
+template <int N, int LEN>
+class DisplayTextCache {
+  struct Entry {
+    uint32_t id;
+    uint32_t src_hash;
+    uint32_t last_used;   // 0 = empty
+    int16_t max_chars;
+    char text[LEN];
+  };
+
+  Entry _entries[N];
+  uint32_t _tick;
+
+  static uint32_t hash(const char* s) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+  }
+
+public:
+  DisplayTextCache() : _tick(0) { invalidateAll(); }
+
+  void invalidateAll() {
+    for (int i = 0; i < N; i++) _entries[i].last_used = 0;
+  }
+
+  /**
+   * \param  max_chars  if > 0, text longer than this is cut, and ends with "..." (built-in font is fixed width)
+   * \returns  display text for 'src'. Valid until next get()
+  */
+  const char* get(uint32_t id, const char* src, int max_chars = 0) {
+    uint32_t h = hash(src);
+    Entry* e = &_entries[0];
+    for (int i = 0; i < N; i++) {
+      Entry* t = &_entries[i];
+      if (t->last_used && t->id == id && t->src_hash == h && t->max_chars == max_chars) {
+        t->last_used = ++_tick;
+        return t->text;
+      }
+      if (t->last_used < e->last_used) e = t;
+    }
+
+    // miss, replace LRU entry
+    int len = transliterateUTF8(src, e->text, LEN);
+    if (max_chars > 3 && max_chars < LEN && len > max_chars) {
+      strcpy(&e->text[max_chars - 3], "...");
+    }
+    e->id = id;
+    e->src_hash = h;
+    e->max_chars = max_chars;
+    e->last_used = ++_tick;
+    return e->text;
+  }
+};
@@ -1,17 +1,18 @@
 #include "UITask.h"
 #include <helpers/TxtDataHelpers.h>
+#include <LoopProfiler.h>
 #include "../MyMesh.h"
 #include "target.h"
 #include <M5Cardputer.h>
 #include <qrcodedisplay.h>
 #include <esp_sleep.h>  // For ESP32 light sleep functionality
 
-// QRcode implementation for M5GFX
+// QRcode implementation for M5CardputerDisplay
 class QRcode_M5GFX : public QRcodeDisplay {
 private:
-    M5GFX* _display;
+    M5CardputerDisplay* _display;
 public:
-    QRcode_M5GFX(M5GFX* display) : _display(display) {}
+    QRcode_M5GFX(M5CardputerDisplay* display) : _display(display) {}
     
     void init() override {
         QRcodeDisplay::init();
@@ -23,18 +24,18 @@ public:
     }
     
     void screenwhite() override {
-        _display->fillScreen(0xFFFF); // White background
+        _display->fillRectRGB(0, 0, _display->width(), _display->height(), 0xFFFF); // White background
     }
     
     void screenupdate() override {
-        // M5GFX updates immediately, no buffer to flush
+        // pushed to panel in endFrame()
     }
     
 protected:
     void drawPixel(int x, int y, int color) override {
         uint16_t gfx_color = (color == 1) ? 0x0000 : 0xFFFF; // 1=black, 0=white
         // Draw a square of multiply x multiply pixels for each QR module
-        _display->fillRect(x, y, multiply, multiply, gfx_color);
+        _display->fillRectRGB(x, y, multiply, multiply, gfx_color);
     }
 };
 
@@ -45,6 +46,7 @@ protected:
 
 
 extern MyMesh the_mesh;
+extern DataStore store;
 
 UITask::UITask(mesh::MainBoard* board, BaseSerialInterface* serial_interface)
     : AbstractUITask(board, serial_interface), _display(nullptr),
@@ -52,14 +54,20 @@ UITask::UITask(mesh::MainBoard* board, BaseSerialInterface* serial_interface)
       _screen_timeout_millis(300000), _screen_sleeping(false), _ignore_next_keypress(false),
       _need_refresh(false), _alert_expiry(0), _input_length(0), _input_mode(false),
       _scroll_pos(0), _selected_idx(0), _chat_is_channel(false),
-      _chat_history_count(0), _chat_scroll(0), _notification_expiry(0), _has_notification(false),
+      _chat_scroll(0), _notification_expiry(0), _has_notification(false),
       _chat_msg_scroll_index(0), _search_filter_length(0), _backspace_hold_start(0), _backspace_was_held(false),
       _last_backspace_delete(0), _delete_processed(false),
       _settings_selected(false), _settings_category(SettingsCategory::MAIN_MENU), _settings_menu_idx(0), _settings_item_idx(0), _settings_scroll_pos(0), _public_info_scroll_pos(0), _radio_preset_scroll_pos(0), _radio_setup_scroll_pos(0),
       _editing_name(false), _show_qr_code(false), _edit_buffer_length(0),
       _editing_frequency(false), _editing_bandwidth(false), _editing_spreading_factor(false), _editing_coding_rate(false), _editing_tx_power(false), _manual_setup_step(-1),
       _show_factory_reset_confirm(false),
-      _brightness(128), _main_color_idx(0), _secondary_color_idx(1) {
+      _brightness(128), _main_color_idx(0), _secondary_color_idx(1),
+      _layout_screen(MenuScreen::CONTACTS), _layout_notification(false), _cursor_blink_phase(0),
+      _w_list_header(this, &UITask::renderListHeader), _w_contacts(this, &UITask::renderContactList),
+      _w_channels(this, &UITask::renderChannelList), _w_bottom_bar(this, &UITask::renderBottomBar),
+      _w_chat_header(this, &UITask::renderChatHeader), _w_chat_messages(this, &UITask::renderChatScreen),
+      _w_chat_input(this, &UITask::renderChatInput), _w_settings(this, &UITask::renderSettingsMenu),
+      _w_notification(this, &UITask::renderNotification) {
     _alert[0] = '\0';
     _input_buffer[0] = '\0';
     _search_filter[0] = '\0';
@@ -69,7 +77,7 @@ UITask::UITask(mesh::MainBoard* board, BaseSerialInterface* serial_interface)
     _last_read_channel[0] = '\0';
     memset(&_chat_contact, 0, sizeof(_chat_contact));
     memset(&_chat_channel, 0, sizeof(_chat_channel));
-    memset(_chat_history, 0, sizeof(_chat_history));
+    memset(&_chat_key, 0, sizeof(_chat_key));
     memset(_channel_has_unread, 0, sizeof(_channel_has_unread));
 }
 
@@ -78,6 +86,8 @@ void UITask::begin(DisplayDriver* display, SensorManager* sensors, NodePrefs* no
     _sensors = sensors;
     _node_prefs = node_prefs;
     
+    _chat_history.begin(&store);   // loads recent messages from chat log
+    
     if (_display) {
         _display->turnOn();
     }
@@ -142,6 +152,7 @@ void UITask::loop() {
     if (M5Cardputer.Keyboard.isChange()) {
         if (M5Cardputer.Keyboard.isPressed()) {
             Keyboard_Class::KeysState status = M5Cardputer.Keyboard.keysState();
+            bool was_dirty = _widgets.isDirty();
             
             // If notification is active, any key dismisses it
             if (_has_notification) {
@@ -175,7 +186,11 @@ void UITask::loop() {
                     Serial.println("[Input] Ignoring wake keypress");
                 }
             }
-            _need_refresh = true;
+            // Handlers that know exactly what changed (eg. typing) just invalidate those widgets,
+            // anything else redraws the whole screen
+            if (was_dirty || !_widgets.isDirty()) {
+                _need_refresh = true;
+            }
             
             // Reset auto-off timer (using configured timeout)
             if (_screen_timeout_millis > 0) {
@@ -208,7 +223,7 @@ void UITask::loop() {
                 if (_menu_state == MenuScreen::CHAT && _input_mode && _input_length > 0) {
                     _input_length--;
                     _input_buffer[_input_length] = '\0';
-                    _need_refresh = true;
+                    _w_chat_input.invalidate();
                 } else if ((_menu_state == MenuScreen::CONTACTS || _menu_state == MenuScreen::CHANNELS) && _search_filter_length > 0) {
                     _search_filter_length--;
                     _search_filter[_search_filter_length] = '\0';
@@ -228,43 +243,33 @@ void UITask::loop() {
         }
     }
     
-    // Refresh display only when needed
-    if (_display && _display->isOn() && _need_refresh) {
-        _need_refresh = false;
-        
-        // Don't clear entire screen - reduces flicker!
-        // Each UI element will draw its own background
-        _display->startFrame();
-        
-        switch (_menu_state) {
-            case MenuScreen::CONTACTS:
-                renderContactList();
-                break;
-                
-            case MenuScreen::CHANNELS:
-                renderChannelList();
-                break;
-                
-            case MenuScreen::CHAT:
-                renderChatScreen();
-                break;
-                
-            case MenuScreen::SETTINGS:
-                renderSettingsMenu();
-                break;
-        }
-        
-        // Don't show bottom bar in Settings (it has its own)
-        if (_menu_state != MenuScreen::SETTINGS) {
-            renderBottomBar();
+    // Blink the input cursor (only the input line gets redrawn)
+    if (_menu_state == MenuScreen::CHAT && _input_mode) {
+        int phase = (millis() / 350) % 2;
+        if (phase != _cursor_blink_phase) {
+            _cursor_blink_phase = phase;
+            _w_chat_input.invalidate();
         }
+    }
+    
+    if (_has_notification && millis() >= _notification_expiry) {
+        _has_notification = false;
+        _need_refresh = true;
+    }
+    
+    // Refresh display only when needed: everything after a screen change, otherwise just the dirty widgets
+    bool relayout = _need_refresh || _menu_state != _layout_screen || _has_notification != _layout_notification;
+    if (_display && _display->isOn() && (relayout || _widgets.isDirty())) {
+        LOOP_PROFILE_SCOPE(PROF_UI_RENDER);
         
-        // Show notification popup if active
-        if (_has_notification && millis() < _notification_expiry) {
-            renderNotification();
-        } else if (_has_notification && millis() >= _notification_expiry) {
-            _has_notification = false;
+        if (relayout) {
+            _need_refresh = false;
+            layoutWidgets();
+            _display->startFrame();
+        } else {
+            _display->startPartialFrame();
         }
+        _widgets.render(*_display);
         
         _display->endFrame();
     }
@@ -277,19 +282,50 @@ void UITask::loop() {
         // Note: CPU stays active to receive LoRa packets and keyboard input
         // Light sleep was too deep and prevented proper operation
     }
+}
+
+void UITask::layoutWidgets() {
+    _widgets.clear();
     
-    // Check for notification timeout
-    if (_has_notification && millis() >= _notification_expiry) {
-        _has_notification = false;
-        _need_refresh = true;
+    if (_has_notification) {
+        // Full screen popup, covers everything else
+        _w_notification.setBounds(0, 0, 240, 135);
+        _widgets.add(&_w_notification);
+    } else {
+        switch (_menu_state) {
+            case MenuScreen::CONTACTS:
+            case MenuScreen::CHANNELS: {
+                UIMethodWidget<UITask>& list = (_menu_state == MenuScreen::CONTACTS) ? _w_contacts : _w_channels;
+                _w_list_header.setBounds(0, 0, 240, 28);
+                list.setBounds(0, 27, 240, 82);          // items at y: 27, 54, 81 (overlap header/bar borders)
+                _w_bottom_bar.setBounds(0, 107, 240, 28);
+                _widgets.add(&_w_list_header);
+                _widgets.add(&list);
+                _widgets.add(&_w_bottom_bar);
+                break;
+            }
+                
+            case MenuScreen::CHAT:
+                _w_chat_header.setBounds(0, 0, 240, 28);
+                _w_chat_messages.setBounds(0, 28, 240, 79);
+                _w_chat_input.setBounds(0, 107, 240, 28);
+                _widgets.add(&_w_chat_header);
+                _widgets.add(&_w_chat_messages);
+                _widgets.add(&_w_chat_input);
+                break;
+                
+            case MenuScreen::SETTINGS:
+                // Settings has its own bottom bar
+                _w_settings.setBounds(0, 0, 240, 135);
+                _widgets.add(&_w_settings);
+                break;
+        }
     }
+    _layout_screen = _menu_state;
+    _layout_notification = _has_notification;
 }
 
-void UITask::renderContactList() {
-    // Clear screen background (reduces flicker vs clearing every frame)
-    _display->setColor(DisplayDriver::DARK);
-    _display->fillRect(0, 0, 240, 135);
-    
+void UITask::renderListHeader() {
     // Header bar (0, 0, 240, 28)
     _display->setColor(DisplayDriver::LIGHT);
     _display->drawRect(0, 0, 240, 28);
@@ -303,16 +339,16 @@ void UITask::renderContactList() {
     
     if (_settings_selected) {
         // Selected: fill background with main color
-        M5Cardputer.Display.fillRect(0, 0, 30, 28, main_color);
+        display.fillRectRGB(0, 0, 30, 28, main_color);
         // Draw 3 lines in secondary color
-        M5Cardputer.Display.fillRect(6, 7, 18, 3, secondary_color);
-        M5Cardputer.Display.fillRect(6, 13, 18, 3, secondary_color);
-        M5Cardputer.Display.fillRect(6, 19, 18, 3, secondary_color);
+        display.fillRectRGB(6, 7, 18, 3, secondary_color);
+        display.fillRectRGB(6, 13, 18, 3, secondary_color);
+        display.fillRectRGB(6, 19, 18, 3, secondary_color);
     } else {
         // Normal: draw 3 lines in main color
-        M5Cardputer.Display.fillRect(6, 7, 18, 3, main_color);
-        M5Cardputer.Display.fillRect(6, 13, 18, 3, main_color);
-        M5Cardputer.Display.fillRect(6, 19, 18, 3, main_color);
+        display.fillRectRGB(6, 7, 18, 3, main_color);
+        display.fillRectRGB(6, 13, 18, 3, main_color);
+        display.fillRectRGB(6, 19, 18, 3, main_color);
     }
     
     // MeshCore title (center)
@@ -329,7 +365,9 @@ void UITask::renderContactList() {
         _display->setCursor(189, 11);
         _display->print(pin);
     }
-    
+}
+
+void UITask::renderContactList() {
     int num_contacts = the_mesh.getNumContacts();
     
     // Filter contacts by search term
@@ -405,61 +443,14 @@ void UITask::renderContactList() {
                 _display->setTextSize(2);
                 _display->setCursor(16, y + 6);
                 
-                // Filter and truncate long names - max 18 chars to prevent wrapping
-                char filtered_name[32];
-                filterDisplayText(contact.name, filtered_name, sizeof(filtered_name));
-                char display_name[19];
-                strncpy(display_name, filtered_name, 18);
-                display_name[18] = '\0';
-                _display->print(display_name);
+                // Filter and ellipsize long names - max 18 chars to prevent wrapping
+                _display->print(_name_text.get(contactTextId(contact), contact.name, 18));
             }
         }
     }
 }
 
 void UITask::renderChannelList() {
-    // Clear screen background (reduces flicker vs clearing every frame)
-    _display->setColor(DisplayDriver::DARK);
-    _display->fillRect(0, 0, 240, 135);
-    
-    // Header bar (0, 0, 240, 28)
-    _display->setColor(DisplayDriver::LIGHT);
-    _display->drawRect(0, 0, 240, 28);
-    
-    // Settings icon box (left)
-    _display->drawRect(0, 0, 30, 28);
-    
-    // Draw hamburger menu icon (3 horizontal lines)
-    uint16_t main_color = COLORS[_main_color_idx].rgb565;
-    uint16_t secondary_color = COLORS[_secondary_color_idx].rgb565;
-    
-    if (_settings_selected) {
-        // Selected: fill background with main color
-        M5Cardputer.Display.fillRect(0, 0, 30, 28, main_color);
-        // Draw 3 lines in secondary color
-        M5Cardputer.Display.fillRect(6, 7, 18, 3, secondary_color);
-        M5Cardputer.Display.fillRect(6, 13, 18, 3, secondary_color);
-        M5Cardputer.Display.fillRect(6, 19, 18, 3, secondary_color);
-    } else {
-        // Normal: draw 3 lines in main color
-        M5Cardputer.Display.fillRect(6, 7, 18, 3, main_color);
-        M5Cardputer.Display.fillRect(6, 13, 18, 3, main_color);
-        M5Cardputer.Display.fillRect(6, 19, 18, 3, main_color);
-    }
-    _display->setTextSize(2);
-    _display->setCursor(73, 7);
-    _display->print("MeshCore");
-    
-    // BLE PIN (right)
-    uint32_t ble_pin = the_mesh.getBLEPin();
-    if (ble_pin != 0 && ble_pin != 123456) {
-        _display->setTextSize(1);
-        char pin[16];
-        sprintf(pin, "%lu", ble_pin);
-        _display->setCursor(189, 11);
-        _display->print(pin);
-    }
-    
     // Count and collect channels
     int num_channels = 0;
     ChannelDetails channels[MAX_GROUP_CHANNELS];
@@ -542,13 +533,8 @@ void UITask::renderChannelList() {
             _display->setTextSize(2);
             _display->setCursor(16, y + 6);
             
-            // Filter and truncate long names - max 18 chars to prevent wrapping
-            char filtered_name[32];
-            filterDisplayText(channel.name, filtered_name, sizeof(filtered_name));
-            char display_name[19];
-            strncpy(display_name, filtered_name, 18);
-            display_name[18] = '\0';
-            _display->print(display_name);
+            // Filter and ellipsize long names - max 18 chars to prevent wrapping
+            _display->print(_name_text.get(channelTextId(channel_mesh_idx[real_idx]), channel.name, 18));
             
             // Show unread indicator (dot) if channel has unread messages
             // Use the original mesh index for this channel
@@ -562,11 +548,7 @@ void UITask::renderChannelList() {
     }
 }
 
-void UITask::renderChatScreen() {
-    // Clear screen background (reduces flicker vs clearing every frame)
-    _display->setColor(DisplayDriver::DARK);
-    _display->fillRect(0, 0, 240, 135);
-    
+void UITask::renderChatHeader() {
     // === HEADER BAR === (0, 0, 240, 28)
     _display->setColor(DisplayDriver::LIGHT);
     _display->drawRect(0, 0, 240, 28);
@@ -577,73 +559,58 @@ void UITask::renderChatScreen() {
     _display->print("<");
     
     // Chat name - centered
-    char filtered_name[32];
     char full_name[15];
     if (_chat_is_channel) {
-        filterDisplayText(_chat_channel.name, filtered_name, sizeof(filtered_name));
-        char name[13];
-        strncpy(name, filtered_name, 12);
-        name[12] = '\0';
-        snprintf(full_name, 15, "%s", name);
+        snprintf(full_name, 15, "%s", _name_text.get(channelTextId(_chat_key.id[0]), _chat_channel.name, 12));
     } else {
-        filterDisplayText(_chat_contact.name, filtered_name, sizeof(filtered_name));
-        char name[13];
-        strncpy(name, filtered_name, 12);
-        name[12] = '\0';
-        snprintf(full_name, 15, "@%s", name);
+        snprintf(full_name, 15, "@%s", _name_text.get(contactTextId(_chat_contact), _chat_contact.name, 12));
     }
     
     int name_width = _display->getTextWidth(full_name);
     int center_x = (240 - name_width) / 2;
     _display->setCursor(center_x, 7);
     _display->print(full_name);
-    
+}
+
+void UITask::renderChatScreen() {
     // === SCROLLABLE MESSAGE AREA === (y=30 to y=106)
     // This area must be fully above the input bar
     int msg_area_top = 30;
     int msg_area_bottom = 106;
     int msg_area_height = msg_area_bottom - msg_area_top;
     
-    if (_chat_history_count == 0) {
+    const ChatMessage* m = _chat_history.getNewest(_chat_key);   // may page in from chat log
+    if (_chat_history.getCount() == 0 && m == NULL) {
         // No messages - just show empty space
     } else {
-        // Get current contact/channel name for filtering
-        const char* current_name = _chat_is_channel ? _chat_channel.name : _chat_contact.name;
-        
-        // First, collect messages for this conversation
-        int filtered_indices[MAX_CHAT_MESSAGES];
-        int filtered_count = 0;
-        for (int i = _chat_history_count - 1; i >= 0; i--) {
-            ChatMessage& msg = _chat_history[i];
-            if (msg.is_channel == _chat_is_channel && strcmp(msg.contact_or_channel, current_name) == 0) {
-                filtered_indices[filtered_count++] = i;
-            }
-        }
-        
-        if (filtered_count == 0) {
+        if (m == NULL) {
             _display->setTextSize(1);
             _display->setColor(DisplayDriver::LIGHT);
             _display->setCursor(80, 60);
             _display->print("No messages");
         } else {
-            // Clamp scroll index
-            if (_chat_msg_scroll_index >= filtered_count) _chat_msg_scroll_index = filtered_count - 1;
+            // scroll_index=0 means show newest messages, scroll_index=N means skip N newest
+            // (older ones are paged in from flash)
             if (_chat_msg_scroll_index < 0) _chat_msg_scroll_index = 0;
+            if (_chat_msg_scroll_index > 0) {
+                const ChatMessage* older;
+                while ((older = _chat_history.getByDepth(_chat_key, _chat_msg_scroll_index)) == NULL && _chat_msg_scroll_index > 0) {
+                    _chat_msg_scroll_index--;   // clamp scroll index to oldest
+                }
+                if (older) m = older;
+            }
             
             // Try to fit messages starting from scroll index
-            // scroll_index=0 means show newest messages, scroll_index=N means skip N newest
-            int messages_to_show[10]; // Max 10 messages on screen
+            const ChatMessage* messages_to_show[10]; // Max 10 messages on screen
             int show_count = 0;
             int available_height = msg_area_height; // Full 76px available
             
-            // Start from scroll_index and go toward older messages (higher indices)
-            for (int idx = _chat_msg_scroll_index; idx < filtered_count && show_count < 10; idx++) {
-                int hist_idx = filtered_indices[idx];
-                ChatMessage& msg = _chat_history[hist_idx];
+            // Go toward older messages
+            for ( ; m && show_count < 10; m = _chat_history.getOlder(m)) {
+                const ChatMessage& msg = *m;
                 
                 // Calculate message height
-                char filtered_text[128];
-                filterDisplayText(msg.text, filtered_text, sizeof(filtered_text));
+                const char* filtered_text = _message_text.get(msg.log_seq, msg.text);
                 
                 // Extract sender name for channel messages
                 const char* message_text = filtered_text;
@@ -651,7 +618,7 @@ void UITask::renderChatScreen() {
                 char sender_name[32] = "";
                 
                 if (_chat_is_channel && !msg.is_outgoing) {
-                    char* colon_pos = strchr(filtered_text, ':');
+                    const char* colon_pos = strchr(filtered_text, ':');
                     if (colon_pos != nullptr && (colon_pos - filtered_text) < 30) {
                         int name_len = colon_pos - filtered_text;
                         strncpy(sender_name, filtered_text, name_len);
@@ -678,7 +645,7 @@ void UITask::renderChatScreen() {
                     break;
                 }
                 
-                messages_to_show[show_count++] = hist_idx;
+                messages_to_show[show_count++] = m;
                 available_height -= total_height;
             }
             
@@ -686,11 +653,10 @@ void UITask::renderChatScreen() {
             int y = msg_area_bottom - 2;
             
             for (int i = 0; i < show_count; i++) {
-                ChatMessage& msg = _chat_history[messages_to_show[i]];
+                const ChatMessage& msg = *messages_to_show[i];
                 
-                // Filter emojis and non-ASCII characters for display
-                char filtered_text[128];
-                filterDisplayText(msg.text, filtered_text, sizeof(filtered_text));
+                // Filter emojis and non-ASCII characters for display (cached, same as in pass above)
+                const char* filtered_text = _message_text.get(msg.log_seq, msg.text);
             
                 // For INCOMING channel messages, extract sender name and message text
                 char sender_name[32] = "";
@@ -698,7 +664,7 @@ void UITask::renderChatScreen() {
                 
                 if (_chat_is_channel && !msg.is_outgoing) {
                     // Look for "Name: Message" pattern
-                    char* colon_pos = strchr(filtered_text, ':');
+                    const char* colon_pos = strchr(filtered_text, ':');
                     if (colon_pos != nullptr && (colon_pos - filtered_text) < 30) {
                         // Extract sender name (before colon)
                         int name_len = colon_pos - filtered_text;
@@ -840,7 +806,9 @@ void UITask::renderChatScreen() {
             } // End of for loop iterating through messages_to_show
         }
     }
-    
+}
+
+void UITask::renderChatInput() {
     // === FIXED INPUT BAR AT BOTTOM === (107-135)
     // This is ALWAYS at the bottom, messages never overlap it
     _display->setColor(DisplayDriver::LIGHT);
@@ -1248,7 +1216,7 @@ void UITask::renderSettingsMenu() {
             } else {
                 // Special gold color for "Spark the project" option (index 2)
                 if (option_idx == 2) {
-                    M5Cardputer.Display.setTextColor(0xFEA0);  // Gold color (RGB: 255, 215, 0)
+                    display.setTextColorRGB(0xFEA0);  // Gold color (RGB: 255, 215, 0)
                 } else {
                     _display->setColor(DisplayDriver::LIGHT);  // White text
                 }
@@ -1428,6 +1396,16 @@ void UITask::renderSettingsMenu() {
         char uptime_str[20];
         snprintf(uptime_str, sizeof(uptime_str), "%luh %lum %lus", hours, minutes, seconds);
         _display->print(uptime_str);
+        y += line_height;
+        
+        // Frame time (render + push to panel), to compare buffered vs direct drawing
+        const DisplayFrameStats& fs = display.getFrameStats();
+        _display->setCursor(5, y);
+        char frame_str[48];
+        snprintf(frame_str, sizeof(frame_str), "Frame: %lums avg, %lums max%s",
+                 (unsigned long)(fs.frames ? fs.total_us / fs.frames / 1000 : 0), (unsigned long)(fs.max_us / 1000),
+                 display.isBuffered() ? "" : " (direct)");
+        _display->print(frame_str);
         
     } else {
         // Other categories (empty for now)
@@ -1932,7 +1910,7 @@ void UITask::renderSettingsMenu() {
         M5Cardputer.Display.setBrightness(23);
         
         // Clear screen to black
-        M5.Display.fillScreen(0x0000);
+        display.fillRectRGB(0, 0, display.width(), display.height(), 0x0000);
         
         char qr_data[256];
         
@@ -1955,7 +1933,7 @@ void UITask::renderSettingsMenu() {
         }
         
         // Create QR code using custom M5GFX implementation
-        QRcode_M5GFX qrcode(&M5.Display);
+        QRcode_M5GFX qrcode(&display);
         qrcode.init();
         
         // Create and render QR code
@@ -2114,6 +2092,7 @@ void UITask::handleKeyPress(Keyboard_Class::KeysState& status) {
                 _input_length--;
                 _input_buffer[_input_length] = '\0';
             }
+            _w_chat_input.invalidate();
         } else {
             // Reset backspace hold timer when other keys pressed
             _backspace_hold_start = 0;
@@ -2134,6 +2113,7 @@ void UITask::handleKeyPress(Keyboard_Class::KeysState& status) {
                     }
                 }
             }
+            _w_chat_input.invalidate();
         }
     }
     
@@ -2163,8 +2143,7 @@ void UITask::handleKeyPress(Keyboard_Class::KeysState& status) {
                 return;
             } else if (has_semicolon) {
                 // FN+; = scroll to show older messages (move view up)
-                _chat_msg_scroll_index += 1;
-                if (_chat_msg_scroll_index > _chat_history_count - 1) _chat_msg_scroll_index = _chat_history_count - 1;
+                _chat_msg_scroll_index += 1;   // clamped by renderChatScreen(), history may extend into flash
                 _need_refresh = true;
                 return;
             } else if (has_period) {
@@ -2206,6 +2185,7 @@ void UITask::handleKeyPress(Keyboard_Class::KeysState& status) {
                     }
                 }
             }
+            _w_chat_input.invalidate();
         }
         return;
     }
@@ -3004,6 +2984,7 @@ void UITask::handleNavigation(Keyboard_Class::KeysState& status) {
                     if (the_mesh.getContactByIdx(real_idx, _chat_contact)) {
                         _menu_state = MenuScreen::CHAT;
                         _chat_is_channel = false;
+                        _chat_key = ChatConvKey::forContact(_chat_contact.id.pub_key);
                         _input_mode = false;
                         _input_buffer[0] = '\0';
                         _input_length = 0;
@@ -3133,6 +3114,7 @@ void UITask::handleNavigation(Keyboard_Class::KeysState& status) {
                     _chat_channel = channels[real_idx];
                     _menu_state = MenuScreen::CHAT;
                     _chat_is_channel = true;
+                    _chat_key = ChatConvKey::forChannel(channel_mesh_idx[real_idx]);
                     _input_mode = false;
                     _input_buffer[0] = '\0';
                     _input_length = 0;
@@ -3622,12 +3604,8 @@ void UITask::sendMessage() {
     
     uint32_t timestamp = rtc_clock.getCurrentTime();
     
-    // Add to chat history with contact/channel info
-    if (_chat_is_channel) {
-        addMessageToHistory(_node_prefs->node_name, _input_buffer, true, _chat_channel.name, true);
-    } else {
-        addMessageToHistory(_node_prefs->node_name, _input_buffer, true, _chat_contact.name, false);
-    }
+    // Add to chat history of current conversation
+    addMessageToHistory(_chat_key, _node_prefs->node_name, _input_buffer, true);
     
     if (_chat_is_channel) {
         // Send to channel
@@ -3645,252 +3623,22 @@ void UITask::sendMessage() {
     // Only sync RECEIVED messages (which happens automatically in MyMesh::queueMessage)
 }
 
-void UITask::addMessageToHistory(const char* from_name, const char* text, bool is_outgoing,
-                                  const char* contact_or_channel, bool is_channel) {
-    if (_chat_history_count >= MAX_CHAT_MESSAGES) {
-        // Shift messages down
-        for (int i = 0; i < MAX_CHAT_MESSAGES - 1; i++) {
-            _chat_history[i] = _chat_history[i + 1];
-        }
-        _chat_history_count = MAX_CHAT_MESSAGES - 1;
-    }
-    
-    ChatMessage& msg = _chat_history[_chat_history_count];
-    strncpy(msg.from_name, from_name, 31);
-    msg.from_name[31] = '\0';
-    strncpy(msg.text, text, 127);
-    msg.text[127] = '\0';
-    strncpy(msg.contact_or_channel, contact_or_channel, 31);
-    msg.contact_or_channel[31] = '\0';
-    msg.is_outgoing = is_outgoing;
-    msg.is_channel = is_channel;
-    msg.timestamp = millis();
-    
-    _chat_history_count++;
+void UITask::addMessageToHistory(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing) {
+    _chat_history.add(key, from_name, text, is_outgoing, rtc_clock.getCurrentTime());   // persisted, so needs wall clock
 }
 
 void UITask::filterDisplayText(const char* input, char* output, int max_len) {
-    int out_idx = 0;
-    int in_idx = 0;
-    
-    while (input[in_idx] != '\0' && out_idx < max_len - 1) {
-        unsigned char c = (unsigned char)input[in_idx];
-        
-        // Handle 2-byte UTF-8 sequences (most European diacritics)
-        if (c == 0xC4 || c == 0xC5) {
-            unsigned char next = (unsigned char)input[in_idx + 1];
-            const char* replacement = nullptr;
-            
-            // Polish characters
-            if (c == 0xC4 && next == 0x85) replacement = "a";      // ą
-            else if (c == 0xC4 && next == 0x87) replacement = "c"; // ć
-            else if (c == 0xC4 && next == 0x99) replacement = "e"; // ę
-            else if (c == 0xC5 && next == 0x82) replacement = "l"; // ł
-            else if (c == 0xC5 && next == 0x84) replacement = "n"; // ń
-            else if (c == 0xC5 && next == 0x9B) replacement = "s"; // ś
-            else if (c == 0xC5 && next == 0xBA) replacement = "z"; // ź
-            else if (c == 0xC5 && next == 0xBC) replacement = "z"; // ż
-            else if (c == 0xC4 && next == 0x84) replacement = "A"; // Ą
-            else if (c == 0xC4 && next == 0x86) replacement = "C"; // Ć
-            else if (c == 0xC4 && next == 0x98) replacement = "E"; // Ę
-            else if (c == 0xC5 && next == 0x81) replacement = "L"; // Ł
-            else if (c == 0xC5 && next == 0x83) replacement = "N"; // Ń
-            else if (c == 0xC5 && next == 0x9A) replacement = "S"; // Ś
-            else if (c == 0xC5 && next == 0xB9) replacement = "Z"; // Ź
-            else if (c == 0xC5 && next == 0xBB) replacement = "Z"; // Ż
-            
-            // Czech, Slovak, Hungarian, Romanian
-            else if (c == 0xC4 && next == 0x8D) replacement = "c"; // č
-            else if (c == 0xC4 && next == 0x8F) replacement = "d"; // ď
-            else if (c == 0xC4 && next == 0x9B) replacement = "e"; // ě
-            else if (c == 0xC5 && next == 0x99) replacement = "r"; // ř
-            else if (c == 0xC5 && next == 0xA1) replacement = "s"; // š
-            else if (c == 0xC5 && next == 0xA5) replacement = "t"; // ť
-            else if (c == 0xC5 && next == 0xBE) replacement = "z"; // ž
-            else if (c == 0xC4 && next == 0x83) replacement = "a"; // ă
-            else if (c == 0xC5 && next == 0x91) replacement = "o"; // ő
-            else if (c == 0xC5 && next == 0xB1) replacement = "u"; // ű
-            else if (c == 0xC4 && next == 0x8C) replacement = "C"; // Č
-            else if (c == 0xC4 && next == 0x8E) replacement = "D"; // Ď
-            else if (c == 0xC4 && next == 0x9A) replacement = "E"; // Ě
-            else if (c == 0xC5 && next == 0x98) replacement = "R"; // Ř
-            else if (c == 0xC5 && next == 0xA0) replacement = "S"; // Š
-            else if (c == 0xC5 && next == 0xA4) replacement = "T"; // Ť
-            else if (c == 0xC5 && next == 0xBD) replacement = "Z"; // Ž
-            else if (c == 0xC4 && next == 0x82) replacement = "A"; // Ă
-            else if (c == 0xC5 && next == 0x90) replacement = "O"; // Ő
-            else if (c == 0xC5 && next == 0xB0) replacement = "U"; // Ű
-            
-            if (replacement != nullptr) {
-                while (*replacement && out_idx < max_len - 1) {
-                    output[out_idx++] = *replacement++;
-                }
-                in_idx += 2;
-            } else {
-                in_idx += 2; // Skip unknown sequence
-            }
-        }
-        // C3 prefix: Latin diacritics, German umlauts, etc.
-        else if (c == 0xC3) {
-            unsigned char next = (unsigned char)input[in_idx + 1];
-            const char* replacement = nullptr;
-            
-            // Lowercase
-            if (next == 0xA0 || next == 0xA1 || next == 0xA2 || next == 0xA3 || next == 0xA4 || next == 0xA5) replacement = "a"; // à á â ã ä å
-            else if (next == 0xA7) replacement = "c"; // ç
-            else if (next == 0xA8 || next == 0xA9 || next == 0xAA || next == 0xAB) replacement = "e"; // è é ê ë
-            else if (next == 0xAC || next == 0xAD || next == 0xAE || next == 0xAF) replacement = "i"; // ì í î ï
-            else if (next == 0xB1) replacement = "n"; // ñ
-            else if (next == 0xB2 || next == 0xB3 || next == 0xB4 || next == 0xB5 || next == 0xB6 || next == 0xB8) replacement = "o"; // ò ó ô õ ö ø
-            else if (next == 0xB9 || next == 0xBA || next == 0xBB || next == 0xBC) replacement = "u"; // ù ú û ü
-            else if (next == 0xBD || next == 0xBF) replacement = "y"; // ý ÿ
-            else if (next == 0xA6) replacement = "ae"; // æ
-            else if (next == 0xB0) replacement = "d"; // ð (Icelandic)
-            else if (next == 0x9F) replacement = "ss"; // ß (German)
-            
-            // Uppercase
-            else if (next == 0x80 || next == 0x81 || next == 0x82 || next == 0x83 || next == 0x84 || next == 0x85) replacement = "A"; // À Á Â Ã Ä Å
-            else if (next == 0x87) replacement = "C"; // Ç
-            else if (next == 0x88 || next == 0x89 || next == 0x8A || next == 0x8B) replacement = "E"; // È É Ê Ë
-            else if (next == 0x8C || next == 0x8D || next == 0x8E || next == 0x8F) replacement = "I"; // Ì Í Î Ï
-            else if (next == 0x91) replacement = "N"; // Ñ
-            else if (next == 0x92 || next == 0x93 || next == 0x94 || next == 0x95 || next == 0x96 || next == 0x98) replacement = "O"; // Ò Ó Ô Õ Ö Ø
-            else if (next == 0x99 || next == 0x9A || next == 0x9B || next == 0x9C) replacement = "U"; // Ù Ú Û Ü
-            else if (next == 0x9D) replacement = "Y"; // Ý
-            else if (next == 0x86) replacement = "AE"; // Æ
-            else if (next == 0x90) replacement = "D"; // Ð (Icelandic)
-            
-            if (replacement != nullptr) {
-                while (*replacement && out_idx < max_len - 1) {
-                    output[out_idx++] = *replacement++;
-                }
-                in_idx += 2;
-            } else {
-                in_idx += 2; // Skip unknown sequence
-            }
-        }
-        // C4 prefix continued (more diacritics)
-        else if (c == 0xC4) {
-            unsigned char next = (unsigned char)input[in_idx + 1];
-            const char* replacement = nullptr;
-            
-            // German umlauts (already handled above but for clarity)
-            // Turkish and other special cases handled in C4/C5 section above
-            
-            if (replacement != nullptr) {
-                while (*replacement && out_idx < max_len - 1) {
-                    output[out_idx++] = *replacement++;
-                }
-                in_idx += 2;
-            } else {
-                in_idx += 2;
-            }
-        }
-        // C8 prefix: Turkish ş, Romanian ș ț, etc.
-        else if (c == 0xC8) {
-            unsigned char next = (unsigned char)input[in_idx + 1];
-            const char* replacement = nullptr;
-            
-            if (next == 0x99) replacement = "s"; // ș (Romanian)
-            else if (next == 0x9B) replacement = "t"; // ț (Romanian)
-            else if (next == 0x98) replacement = "S"; // Ș
-            else if (next == 0x9A) replacement = "T"; // Ț
-            
-            if (replacement != nullptr) {
-                while (*replacement && out_idx < max_len - 1) {
-                    output[out_idx++] = *replacement++;
-                }
-                in_idx += 2;
-            } else {
-                in_idx += 2;
-            }
-        }
-        // C4 B0/B1: Turkish ı İ (already partially handled)
-        else if (c == 0xC4 && input[in_idx + 1] == 0xB1) {
-            output[out_idx++] = 'i'; // ı (Turkish dotless i)
-            in_idx += 2;
-        }
-        else if (c == 0xC4 && input[in_idx + 1] == 0xB0) {
-            output[out_idx++] = 'I'; // İ (Turkish dotted I)
-            in_idx += 2;
-        }
-        // C4 9F: Turkish ğ
-        else if (c == 0xC4 && input[in_idx + 1] == 0x9F) {
-            output[out_idx++] = 'g'; // ğ
-            in_idx += 2;
-        }
-        else if (c == 0xC4 && input[in_idx + 1] == 0x9E) {
-            output[out_idx++] = 'G'; // Ğ
-            in_idx += 2;
-        }
-        // C5 9F: Turkish ş
-        else if (c == 0xC5 && input[in_idx + 1] == 0x9F) {
-            output[out_idx++] = 's'; // ş
-            in_idx += 2;
-        }
-        else if (c == 0xC5 && input[in_idx + 1] == 0x9E) {
-            output[out_idx++] = 'S'; // Ş
-            in_idx += 2;
-        }
-        // C3 BE/C3 9E: Icelandic þ Þ
-        else if (c == 0xC3 && input[in_idx + 1] == 0xBE) {
-            if (out_idx + 2 < max_len) {
-                output[out_idx++] = 't';
-                output[out_idx++] = 'h'; // þ → th
-            }
-            in_idx += 2;
-        }
-        else if (c == 0xC3 && input[in_idx + 1] == 0x9E) {
-            if (out_idx + 2 < max_len) {
-                output[out_idx++] = 'T';
-                output[out_idx++] = 'H'; // Þ → TH
-            }
-            in_idx += 2;
-        }
-        // C5 92/93: œ Œ (French ligatures)
-        else if (c == 0xC5 && input[in_idx + 1] == 0x93) {
-            if (out_idx + 2 < max_len) {
-                output[out_idx++] = 'o';
-                output[out_idx++] = 'e'; // œ
-            }
-            in_idx += 2;
-        }
-        else if (c == 0xC5 && input[in_idx + 1] == 0x92) {
-            if (out_idx + 2 < max_len) {
-                output[out_idx++] = 'O';
-                output[out_idx++] = 'E'; // Œ
-            }
-            in_idx += 2;
-        }
-        // Handle other UTF-8 sequences (emojis and special characters) - skip them
-        else if (c >= 0x80) {
-            // Skip UTF-8 multi-byte sequences completely
-            if (c >= 0xF0) {
-                // 4-byte sequence (most emojis)
-                in_idx += 4;
-            } else if (c >= 0xE0) {
-                // 3-byte sequence
-                in_idx += 3;
-            } else if (c >= 0xC0) {
-                // 2-byte sequence (fallback for unhandled)
-                in_idx += 2;
-            } else {
-                // Invalid sequence, skip 1 byte
-                in_idx += 1;
-            }
-        }
-        // ASCII printable characters (space to ~)
-        else if (c >= 0x20 && c <= 0x7E) {
-            output[out_idx++] = c;
-            in_idx++;
-        }
-        // Skip control characters
-        else {
-            in_idx++;
-        }
-    }
-    
-    output[out_idx] = '\0';
+    transliterateUTF8(input, output, max_len);
+}
+
+uint32_t UITask::contactTextId(const ContactInfo& contact) {
+    uint32_t id;
+    memcpy(&id, contact.id.pub_key, sizeof(id));
+    return id & 0x7FFFFFFF;
+}
+
+uint32_t UITask::channelTextId(int channel_idx) {
+    return 0x80000000 | channel_idx;   // can't clash with contactTextId()
 }
 
 void UITask::showAlert(const char* msg) {
@@ -3940,21 +3688,23 @@ void UITask::newMsg(uint8_t path_len, const char* from_name, const char* text, i
     
     // Always save message to history (for all contacts and channels)
     if (is_direct_message) {
-        // Save to contact's history
-        addMessageToHistory(from_name, text, false, from_name, false);
+        // Save to contact's history (keyed by pub_key, so find the contact)
+        ContactInfo contact;
+        ContactsIterator iter = the_mesh.startContactsIterator();
+        while (iter.hasNext(&the_mesh, contact)) {
+            if (strcmp(contact.name, from_name) == 0) {
+                addMessageToHistory(ChatConvKey::forContact(contact.id.pub_key), from_name, text, false);
+                break;
+            }
+        }
     } else if (is_channel_msg) {
-        // For channel messages, extract channel name and save
-        char channel_name[32];
-        
         // Try to find which channel this belongs to
         ChannelDetails temp_ch;
-        bool found_channel = false;
+        int channel_idx = -1;
         for (int i = 0; i < MAX_GROUP_CHANNELS; i++) {
             if (the_mesh.getChannel(i, temp_ch) && temp_ch.name[0] != '\0') {
                 if (strstr(from_name, temp_ch.name) != nullptr) {
-                    strncpy(channel_name, temp_ch.name, 31);
-                    channel_name[31] = '\0';
-                    found_channel = true;
+                    channel_idx = i;
                     
                     // Mark as unread if not currently viewing this channel
                     if (!(_menu_state == MenuScreen::CHAT && _chat_is_channel && 
@@ -3966,8 +3716,8 @@ void UITask::newMsg(uint8_t path_len, const char* from_name, const char* text, i
             }
         }
         
-        if (found_channel) {
-            addMessageToHistory(from_name, text, false, channel_name, true);
+        if (channel_idx >= 0) {
+            addMessageToHistory(ChatConvKey::forChannel(channel_idx), from_name, text, false);
         }
     }
     
@@ -4005,7 +3755,11 @@ void UITask::newMsg(uint8_t path_len, const char* from_name, const char* text, i
         }
     }
     
-    _need_refresh = true;
+    if (_menu_state == MenuScreen::CHAT && !_has_notification) {
+        _w_chat_messages.invalidate();   // rest of chat screen is unchanged
+    } else {
+        _need_refresh = true;
+    }
 }
 
 void UITask::notify(UIEventType t) {
@@ -4013,66 +3767,47 @@ void UITask::notify(UIEventType t) {
     _need_refresh = true;
 }
 
-void UITask::syncChatHistoryToBLE(int max_messages) {
-    // Sync last N messages from chat history to phone via BLE
-    if (_chat_history_count == 0) {
-        Serial.println("No chat history to sync");
-        return;
-    }
-    
-    int start_idx = (_chat_history_count > max_messages) ? 
-                    (_chat_history_count - max_messages) : 0;
-    
-    Serial.printf("Syncing %d messages to BLE (from idx %d to %d)\n", 
-                  _chat_history_count - start_idx, start_idx, _chat_history_count - 1);
-    
-    for (int i = start_idx; i < _chat_history_count; i++) {
-        ChatMessage& msg = _chat_history[i];
-        
-        // ONLY sync INCOMING messages (is_outgoing = false)
-        // Outgoing messages are already sent through mesh and will appear on phone naturally
-        if (msg.is_outgoing) {
-            continue; // Skip outgoing messages
-        }
-        
-        // Find contact or channel info
-        if (msg.is_channel) {
-            // Find channel by name
-            ChannelDetails channel;
-            bool found = false;
-            for (int ch_idx = 0; ch_idx < MAX_GROUP_CHANNELS; ch_idx++) {
-                if (the_mesh.getChannel(ch_idx, channel) && 
-                    strcmp(channel.name, msg.contact_or_channel) == 0) {
-                    found = true;
-                    break;
+uint32_t UITask::syncChatHistoryToBLE(uint32_t since_seq, int max_messages) {
+    // Sync up to N messages newer than 'since_seq' to phone via BLE, oldest first. From the chat log,
+    // so works across reboots. Caller passes back the returned seq to continue where this left off.
+    ChatLogRecord recs[CHAT_SCROLLBACK_PAGE];
+    uint32_t cursor = CHAT_LOG_POS_NONE;
+    uint32_t last_seq = since_seq;
+    int num_read = 0, num_sent = 0;
+
+    while (num_read < max_messages) {
+        int want = max_messages - num_read;
+        int n = _chat_history.getMessagesSince(since_seq, cursor, recs, want < CHAT_SCROLLBACK_PAGE ? want : CHAT_SCROLLBACK_PAGE);
+        if (n == 0) break;
+
+        for (int i = 0; i < n; i++) {
+            const ChatLogRecord& msg = recs[i];
+            last_seq = msg.seq;
+
+            // ONLY sync INCOMING messages
+            // Outgoing messages are already sent through mesh and will appear on phone naturally
+            if (msg.flags & CHAT_LOG_FLAG_OUTGOING) continue;
+
+            // key bytes: is_channel, then id (see ChatConvKey)
+            if (msg.key[0]) {
+                ChannelDetails channel;
+                if (the_mesh.getChannel(msg.key[1], channel)) {
+                    the_mesh.queueOutgoingMessageForBLE(NULL, &channel, msg.from_name, msg.text, msg.timestamp);
+                    num_sent++;
                 }
-            }
-            
-            if (found) {
-                the_mesh.queueOutgoingMessageForBLE(NULL, &channel, 
-                                                     msg.from_name, msg.text, msg.timestamp);
-            }
-        } else {
-            // Find contact by name
-            ContactInfo contact;
-            bool found = false;
-            
-            ContactsIterator iter = the_mesh.startContactsIterator();
-            while (iter.hasNext(&the_mesh, contact)) {
-                if (strcmp(contact.name, msg.contact_or_channel) == 0) {
-                    found = true;
-                    break;
+            } else {
+                ContactInfo* contact = the_mesh.lookupContactByPubKey(&msg.key[1], CHAT_KEY_PREFIX_LEN);
+                if (contact) {
+                    the_mesh.queueOutgoingMessageForBLE(contact, NULL, msg.from_name, msg.text, msg.timestamp);
+                    num_sent++;
                 }
             }
-            
-            if (found) {
-                the_mesh.queueOutgoingMessageForBLE(&contact, NULL,
-                                                     msg.from_name, msg.text, msg.timestamp);
-            }
         }
+        num_read += n;
     }
-    
-    Serial.println("Chat history sync complete");
+
+    Serial.printf("Chat history sync: %d messages read, %d sent, up to seq %u\n", num_read, num_sent, last_seq);
+    return last_seq;
 }
 
 void UITask::enterLightSleep() {
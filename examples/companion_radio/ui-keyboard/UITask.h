@@ -8,6 +8,9 @@
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
 #include "../AbstractUITask.h"
+#include "UIWidgets.h"
+#include "ChatHistory.h"
+#include "DisplayText.h"
 #include <M5Cardputer.h>
 #include <Preferences.h>
 
@@ -59,18 +62,6 @@ static const RadioPreset RADIO_PRESETS[] = {
 };
 #define NUM_RADIO_PRESETS 14
 
-// Message structure for chat history
-struct ChatMessage {
-    char text[128];
-    char from_name[32];
-    char contact_or_channel[32]; // Contact name or channel name this message belongs to
-    bool is_outgoing;
-    bool is_channel; // true if channel message, false if contact message
-    uint32_t timestamp;
-};
-
-#define MAX_CHAT_MESSAGES 100 // Increased to store more messages
-
 // Color definitions
 struct ColorOption {
     const char* name;
@@ -179,10 +170,12 @@ private:
     ContactInfo _chat_contact;
     ChannelDetails _chat_channel;
     bool _chat_is_channel;
+    ChatConvKey _chat_key;
     
     // Chat message history
-    ChatMessage _chat_history[MAX_CHAT_MESSAGES];
-    int _chat_history_count;
+    ChatHistory _chat_history;
+    DisplayTextCache<NAME_TEXT_CACHE_SIZE, 32> _name_text;          // contact/channel names, as displayed
+    DisplayTextCache<MESSAGE_TEXT_CACHE_SIZE, 128> _message_text;   // chat message texts, by log_seq
     int _chat_scroll;
     int _chat_msg_scroll_index; // Index of first message to display (0 = newest)
     
@@ -190,9 +183,28 @@ private:
     bool _channel_has_unread[MAX_GROUP_CHANNELS];
     char _last_read_channel[32];
     
+    // Retained widgets - only the dirty ones get redrawn between full refreshes
+    UIWidgetTree _widgets;
+    MenuScreen _layout_screen;      // screen the widget tree was laid out for
+    bool _layout_notification;
+    int _cursor_blink_phase;
+    UIMethodWidget<UITask> _w_list_header;
+    UIMethodWidget<UITask> _w_contacts;
+    UIMethodWidget<UITask> _w_channels;
+    UIMethodWidget<UITask> _w_bottom_bar;
+    UIMethodWidget<UITask> _w_chat_header;
+    UIMethodWidget<UITask> _w_chat_messages;
+    UIMethodWidget<UITask> _w_chat_input;
+    UIMethodWidget<UITask> _w_settings;
+    UIMethodWidget<UITask> _w_notification;
+    
+    void layoutWidgets();
+    void renderListHeader();
     void renderContactList();
     void renderChannelList();
+    void renderChatHeader();
     void renderChatScreen();
+    void renderChatInput();
     void renderSettingsMenu();
     void renderBottomBar();
     void renderNotification();
@@ -203,9 +215,10 @@ private:
     void loadSettings();
     void saveSettings();
     void applyTheme();
-    void addMessageToHistory(const char* from_name, const char* text, bool is_outgoing, 
-                            const char* contact_or_channel, bool is_channel);
+    void addMessageToHistory(const ChatConvKey& key, const char* from_name, const char* text, bool is_outgoing);
     void filterDisplayText(const char* input, char* output, int max_len);
+    static uint32_t contactTextId(const ContactInfo& contact);
+    static uint32_t channelTextId(int channel_idx);
 
 public:
     UITask(mesh::MainBoard* board, BaseSerialInterface* serial_interface);
@@ -217,7 +230,7 @@ public:
     void notify(UIEventType t = UIEventType::none) override;
     
     // Chat history synchronization for BLE
-    void syncChatHistoryToBLE(int max_messages = 10);
+    uint32_t syncChatHistoryToBLE(uint32_t since_seq, int max_messages = 10);
     void enterLightSleep();  // Power management: light sleep mode
     
     void showAlert(const char* msg);
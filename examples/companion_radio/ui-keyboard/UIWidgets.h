@@ -0,0 +1,122 @@
+#pragma once
+
+#include <helpers/ui/DisplayDriver.h>
+
+#ifndef UI_MAX_WIDGETS
+  #define UI_MAX_WIDGETS  8     // max widgets on one screen
+#endif
+
+/**
+ * \brief  A rectangular region of the screen which remembers whether it needs redrawing.
+ *         Subclasses just draw their content, the background is cleared by UIWidgetTree.
+*/
+class UIWidget {
+  int16_t _x, _y, _w, _h;
+  bool _dirty;
+
+public:
+  UIWidget() : _x(0), _y(0), _w(0), _h(0), _dirty(true) { }
+  virtual ~UIWidget() { }
+
+  void setBounds(int x, int y, int w, int h) { _x = x; _y = y; _w = w; _h = h; }
+  int x() const { return _x; }
+  int y() const { return _y; }
+  int width() const { return _w; }
+  int height() const { return _h; }
+
+  bool overlaps(const UIWidget& other) const {
+    return _x < other._x + other._w && other._x < _x + _w && _y < other._y + other._h && other._y < _y + _h;
+  }
+
+  void invalidate() { _dirty = true; }
+  void markClean() { _dirty = false; }
+  bool isDirty() const { return _dirty; }
+
+  virtual void render(DisplayDriver& display) = 0;
+};
+
+/**
+ * \brief  Widget which renders by calling a member function of its owner (eg. UITask::renderChatInput)
+*/
+template <class T>
+class UIMethodWidget : public UIWidget {
+  T* _owner;
+  void (T::*_method)();
+
+public:
+  UIMethodWidget(T* owner, void (T::*method)()) : _owner(owner), _method(method) { }
+
+  void render(DisplayDriver& display) override { (_owner->*_method)(); }
+};
+
+/**
+ * \brief  The widgets making up the current screen, in drawing order. render() redraws only
+ *         the dirty ones, clipped to their bounds, leaving the rest of the frame untouched.
+*/
+class UIWidgetTree {
+  UIWidget* _widgets[UI_MAX_WIDGETS];
+  int _count;
+
+public:
+  UIWidgetTree() : _count(0) { }
+
+  void clear() { _count = 0; }
+
+  bool add(UIWidget* w) {
+    if (_count >= UI_MAX_WIDGETS) return false;
+    _widgets[_count++] = w;
+    w->invalidate();
+    return true;
+  }
+
+  void invalidateAll() {
+    for (int i = 0; i < _count; i++) _widgets[i]->invalidate();
+  }
+
+  bool isDirty() const {
+    for (int i = 0; i < _count; i++) {
+      if (_widgets[i]->isDirty()) return true;
+    }
+    return false;
+  }
+
+  /**
+   * \returns  number of widgets redrawn
+  */
+  int render(DisplayDriver& display) {
+    // clearing a dirty widget's background also wipes any widget overlapping it, so they need redrawing too
+    bool spread = true;
+    while (spread) {
+      spread = false;
+      for (int i = 0; i < _count; i++) {
+        if (!_widgets[i]->isDirty()) continue;
+        for (int j = 0; j < _count; j++) {
+          if (!_widgets[j]->isDirty() && _widgets[i]->overlaps(*_widgets[j])) {
+            _widgets[j]->invalidate();
+            spread = true;
+          }
+        }
+      }
+    }
+
+    // clear all backgrounds first, so overlapping widgets paint in order, same as a full redraw
+    display.setColor(DisplayDriver::DARK);
+    for (int i = 0; i < _count; i++) {
+      UIWidget* w = _widgets[i];
+      if (w->isDirty()) display.fillRect(w->x(), w->y(), w->width(), w->height());
+    }
+
+    int n = 0;
+    for (int i = 0; i < _count; i++) {
+      UIWidget* w = _widgets[i];
+      if (!w->isDirty()) continue;
+
+      display.setClipRect(w->x(), w->y(), w->width(), w->height());
+      w->render(display);
+      display.clearClipRect();
+      w->markClean();
+      n++;
+    }
+    return n;
+  }
+};
@@ -0,0 +1,76 @@
+// Micro-benchmark of trial decryption, as done by Mesh::onRecvPacket(): the MAC of a received datagram is
+// checked (verifyMAC) against each candidate shared secret in turn, until one matches, then it is decrypted. Compares the key
+// cache in Utils (expanded AES keys and HMAC pad states, per secret) against recalculating them on every
+// call. NOTE: on the host build AES128/SHA256 are the arch/native stand-ins, so the absolute numbers are
+// only indicative of the relative cost of the key schedules vs the data blocks.
+//
+//   crypto_bench [iterations]
+
+#include <Arduino.h>
+#include <Utils.h>
+#include <chrono>
+
+static uint32_t rng_state = 1;
+
+static uint8_t nextRand() {
+  uint32_t x = rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rng_state = x;
+  return (uint8_t) x;
+}
+
+#define MAX_CANDIDATES  8
+
+// returns ns per received packet
+static double runTrialDecrypt(bool cached, int num_candidates, int payload_len, uint32_t iterations, bool& ok) {
+  uint8_t secrets[MAX_CANDIDATES][PUB_KEY_SIZE];
+  for (int i = 0; i < num_candidates; i++) {
+    for (int j = 0; j < PUB_KEY_SIZE; j++) secrets[i][j] = nextRand();
+  }
+  uint8_t plain[MAX_PACKET_PAYLOAD], cipher[MAX_PACKET_PAYLOAD + CIPHER_BLOCK_SIZE], dest[MAX_PACKET_PAYLOAD + CIPHER_BLOCK_SIZE];
+  for (int j = 0; j < payload_len; j++) plain[j] = nextRand();
+
+  mesh::Utils::setKeyCacheEnabled(cached);
+  int len = mesh::Utils::encryptThenMAC(secrets[num_candidates - 1], cipher, plain, payload_len);   // last candidate is the sender
+
+  ok = true;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < iterations; n++) {
+    int i;
+    for (i = 0; i < num_candidates; i++) {
+      if (mesh::Utils::verifyMAC(secrets[i], cipher, len)) break;
+    }
+    if (i < num_candidates) mesh::Utils::decrypt(secrets[i], dest, &cipher[CIPHER_MAC_SIZE], len - CIPHER_MAC_SIZE);
+    if (i != num_candidates - 1) ok = false;   // (2 byte MAC, so a false match is possible, but not with this seed)
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  if (memcmp(dest, plain, payload_len) != 0) ok = false;
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  printf("Trial decrypt per received packet, %u iterations\n", iterations);
+  printf("%10s %8s %14s %14s %8s\n", "candidates", "payload", "no cache (ns)", "cached (ns)", "speedup");
+  static const int candidates[] = { 1, 4, 8 };
+  static const int sizes[] = { 16, 64, 160 };
+  for (int c = 0; c < (int)(sizeof(candidates)/sizeof(candidates[0])); c++) {
+    for (int s = 0; s < (int)(sizeof(sizes)/sizeof(sizes[0])); s++) {
+      bool ok_a, ok_b;
+      rng_state = 12345;
+      double a = runTrialDecrypt(false, candidates[c], sizes[s], iterations, ok_a);
+      rng_state = 12345;
+      double b = runTrialDecrypt(true, candidates[c], sizes[s], iterations, ok_b);
+      printf("%10d %8d %14.1f %14.1f %7.2fx%s\n", candidates[c], sizes[s], a, b, a / b, ok_a && ok_b ? "" : "  (decrypt mismatch!)");
+    }
+  }
+
+  uint32_t hits, misses;
+  mesh::Utils::getKeyCacheStats(hits, misses);
+  printf("key cache: %u hits, %u misses\n", hits, misses);
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Micro-benchmark of the Dispatcher RX -> TX path: a frame is injected into a SimRadio, parsed into a
+// pooled Packet by checkRecv(), retransmitted (serialised by checkSend()), then the send is completed.
+// Compares the in-place radio buffers (SimRadio's recvRawInPlace()/getSendBuffer()) against the
+// Radio defaults, which copy via the shared wire buffer, as recvRaw()/startSendRaw() did.
+//
+//   dispatch_bench [iterations]
+
+#include <Arduino.h>
+#include <Dispatcher.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <helpers/native/SimClock.h>
+#include <helpers/native/SimRadio.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define HAS_TSC  1
+#endif
+
+class EchoDispatcher : public mesh::Dispatcher {
+public:
+  EchoDispatcher(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::PacketManager& mgr) : mesh::Dispatcher(radio, ms, mgr) { }
+
+protected:
+  mesh::DispatcherAction onRecvPacket(mesh::Packet* pkt) override { return ACTION_RETRANSMIT(0); }
+  float getAirtimeBudgetFactor() const override { return 0; }
+  int calcRxDelay(float score, uint32_t air_time) const override { return 0; }
+};
+
+struct BenchResult {
+  double ns_per_pkt;
+  double cycles_per_pkt;
+  uint32_t sent;
+};
+
+static BenchResult runEcho(bool zero_copy, int payload_len, uint32_t iterations) {
+  VirtualMillisClock clock;
+  clock.setMillis(1000);
+  SimRadioParams params;
+  SimRadio radio(clock, params);
+  radio.setZeroCopy(zero_copy);
+  StaticPoolPacketManager mgr(16);
+  EchoDispatcher disp(radio, clock, mgr);
+  disp.begin();
+
+  // a flood packet, with a 4 hop path
+  uint8_t frame[MAX_TRANS_UNIT];
+  int len = 0;
+  frame[len++] = (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  frame[len++] = 4;
+  for (int i = 0; i < 4 + payload_len; i++) frame[len++] = (uint8_t) i;
+
+  BenchResult res;
+#ifdef HAS_TSC
+  uint64_t c0 = __rdtsc();
+#endif
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < iterations; n++) {
+    radio.injectRaw(frame, len, params.snr, params.rssi);
+    clock.advance(1);      // (past next_tx_time)
+    disp.loop();           // checkRecv() + checkSend()
+    clock.advance(3000);   // > max air-time
+    disp.loop();           // send complete, Packet released
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  res.ns_per_pkt = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+#ifdef HAS_TSC
+  res.cycles_per_pkt = (double)(__rdtsc() - c0) / iterations;
+#else
+  res.cycles_per_pkt = 0;
+#endif
+  res.sent = radio.getPacketsSent();
+  return res;
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  printf("Dispatcher RX->TX per packet, %u iterations\n", iterations);
+  printf("%8s %18s %18s %10s\n", "payload", "copy (ns/cyc)", "in-place (ns/cyc)", "saving");
+  static const int sizes[] = { 16, 64, 128, 184 };
+  for (int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    runEcho(true, sizes[i], iterations / 10);   // warm up
+    BenchResult a = runEcho(false, sizes[i], iterations);
+    BenchResult b = runEcho(true, sizes[i], iterations);
+    printf("%8d %8.1f/%-9.0f %8.1f/%-9.0f %9.1f%%%s\n", sizes[i], a.ns_per_pkt, a.cycles_per_pkt, b.ns_per_pkt, b.cycles_per_pkt,
+           100.0 * (a.ns_per_pkt - b.ns_per_pkt) / a.ns_per_pkt,
+           a.sent == iterations && b.sent == iterations ? "" : "  (not all packets sent!)");
+  }
+  return 0;
+}
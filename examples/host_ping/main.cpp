@@ -0,0 +1,67 @@
+// Host-native smoke test: two nodes on SimRadio's, one sends an Advert, the other receives
+// and verifies it, then forwards it back (with its own hash appended to the path).
+
+#include <Arduino.h>
+#include <Mesh.h>
+#include <helpers/ArduinoHelpers.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <helpers/native/SimRadio.h>
+
+class PingMesh : public mesh::Mesh {
+  const char* _name;
+public:
+  int num_adverts;
+
+  PingMesh(const char* name, mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::MeshTables& tables)
+    : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(16), tables), _name(name)
+  {
+    num_adverts = 0;
+  }
+
+protected:
+  bool allowPacketForward(const mesh::Packet* packet) override { return true; }
+
+  void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override {
+    num_adverts++;
+    Serial.printf("%s: advert from ", _name);
+    mesh::Utils::printHex(Serial, id.pub_key, 4);
+    Serial.printf("..., path_len=%d, snr=%.1f\n", (int)packet->path_len, packet->getSNR());
+  }
+};
+
+int main(int argc, char* argv[]) {
+  ArduinoMillis ms;
+  StdRNG rng;
+  rng.begin(1234);
+  VolatileRTCClock rtc;
+
+  SimRadioParams params;
+  params.sf = 7;   // keep it quick
+  params.bw = 250;
+  SimRadio radio_a(ms, params, 1), radio_b(ms, params, 2);
+  radio_a.addNeighbour(radio_b);
+  radio_b.addNeighbour(radio_a);
+
+  SimpleMeshTables tables_a, tables_b;
+  PingMesh a("A", radio_a, ms, rng, rtc, tables_a);
+  PingMesh b("B", radio_b, ms, rng, rtc, tables_b);
+  a.self_id = mesh::LocalIdentity(&rng);
+  b.self_id = mesh::LocalIdentity(&rng);
+  a.begin();
+  b.begin();
+
+  Serial.printf("airtime for 100 bytes (SF%d, BW%.0f, CR4/%d): %u ms\n", (int)params.sf, params.bw, (int)params.cr, radio_a.getEstAirtimeFor(100));
+
+  mesh::Packet* adv = a.createAdvert(a.self_id);
+  a.sendFlood(adv);
+
+  unsigned long until = millis() + 2000;
+  while (millis() < until && b.num_adverts == 0) {
+    a.loop();
+    b.loop();
+    delay(1);
+  }
+  Serial.printf("sent=%u, recv=%u\n", radio_a.getPacketsSent(), radio_b.getPacketsRecv());
+  return b.num_adverts == 1 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "SimNode.h"
+#include <math.h>
+
+#define PUBLIC_GROUP_PSK  "izOH6cXN6mrJ5e26oRXNcg=="
+
+static mesh::PacketManager* newPacketManager(const SimNodeConfig& cfg) {
+  if (cfg.heap_queue) return new HeapPoolPacketManager(cfg.pool_size);
+  return new StaticPoolPacketManager(cfg.pool_size);
+}
+
+SimNode::SimNode(int idx, const SimNodeConfig& cfg, SimRadio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng,
+                 mesh::RTCClock& rtc, mesh::MeshTables& tables, SimNodeListener* listener)
+    : BaseChatMesh(radio, ms, rng, rtc, *newPacketManager(cfg), tables),
+      _idx(idx), _cfg(cfg), _listener(listener), _sim_radio(&radio)
+{
+  sprintf(_name, "n%03d", idx);
+  memset(tx_by_type, 0, sizeof(tx_by_type));
+  dup_forwards = tx_fails = 0;
+
+  self_id = mesh::LocalIdentity(&rng);
+  addChannel("Public", PUBLIC_GROUP_PSK);
+}
+
+int SimNode::calcRxDelay(float score, uint32_t air_time) const {
+  if (_cfg.rx_delay_base <= 0.0f) return 0;
+  return (int)((pow(_cfg.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+}
+
+uint32_t SimNode::getRetransmitDelay(const mesh::Packet* packet) {
+  uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _cfg.tx_delay_factor);
+  return getRNG()->nextInt(0, 5*t + 1);
+}
+
+uint32_t SimNode::getDirectRetransmitDelay(const mesh::Packet* packet) {
+  uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _cfg.direct_tx_delay_factor);
+  return getRNG()->nextInt(0, 5*t + 1);
+}
+
+void SimNode::logTx(mesh::Packet* packet, int len) {
+  tx_by_type[packet->getPayloadType()]++;
+
+  uint64_t key;
+  packet->calculatePacketHash((uint8_t *) &key);
+  if (!_transmitted.insert(key).second) {
+    dup_forwards++;
+  }
+}
+
+void SimNode::sendAdvert() {
+  mesh::Packet* pkt = createSelfAdvert(_name);
+  if (pkt) sendFlood(pkt);
+}
+
+bool SimNode::sendChannelText(const char* text) {
+  ChannelDetails ch;
+  if (!getChannel(0, ch)) return false;
+  return sendGroupMessage(getRTCClock()->getCurrentTimeUnique(), ch.channel, _name, text, strlen(text));
+}
+
+void SimNode::onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) {
+  if (_listener) _listener->onChannelMessage(*this, text);
+}
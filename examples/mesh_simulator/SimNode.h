@@ -0,0 +1,88 @@
+#pragma once
+
+#include <helpers/BaseChatMesh.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <helpers/HeapPoolPacketManager.h>
+#include <helpers/native/SimClock.h>
+#include <helpers/native/SimRadio.h>
+#include <set>
+
+struct SimNodeConfig {
+  bool is_repeater;
+  int pool_size;
+  bool heap_queue;                // use HeapPoolPacketManager instead of StaticPoolPacketManager
+  float airtime_factor;           // as per NodePrefs
+  float duty_cycle;               // max fraction of TX time per hour (0 = no limit)
+  float rx_delay_base;            // as per NodePrefs (0 = disabled)
+  float tx_delay_factor;          // flood retransmit delay, as per repeater prefs
+  float direct_tx_delay_factor;   // direct retransmit delay, as per repeater prefs
+
+  SimNodeConfig() : is_repeater(false), pool_size(16), heap_queue(false), airtime_factor(1.0f), duty_cycle(0.0f), rx_delay_base(0.0f),
+                    tx_delay_factor(0.5f), direct_tx_delay_factor(0.2f) { }
+};
+
+class SimNode;
+
+class SimNodeListener {
+public:
+  virtual void onChannelMessage(SimNode& node, const char* text) = 0;
+};
+
+/**
+ * \brief  A BaseChatMesh node, for use in the mesh simulator. Repeater nodes forward everything (like
+ *         simple_repeater), other nodes are plain chat clients.
+*/
+class SimNode : public BaseChatMesh {
+  int _idx;
+  char _name[16];
+  SimNodeConfig _cfg;
+  SimNodeListener* _listener;
+  SimRadio* _sim_radio;
+  std::set<uint64_t> _transmitted;   // packet hashes transmitted by this node
+
+public:
+  uint32_t tx_by_type[16];
+  uint32_t dup_forwards;      // same packet hash transmitted more than once (ie. dedup table was too small)
+  uint32_t tx_fails;
+
+  SimNode(int idx, const SimNodeConfig& cfg, SimRadio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng,
+          mesh::RTCClock& rtc, mesh::MeshTables& tables, SimNodeListener* listener);
+
+  int getIndex() const { return _idx; }
+  const char* getName() const { return _name; }
+  const SimNodeConfig& getConfig() const { return _cfg; }
+  SimRadio& getSimRadio() const { return *_sim_radio; }
+  int getPoolFreeCount() const { return _mgr->getFreeCount(); }
+  bool isIdle() const { return _mgr->getFreeCount() == _cfg.pool_size; }
+  bool getPoolStats(mesh::PacketPoolStats& dest) const { return _mgr->getPoolStats(dest); }
+
+  void sendAdvert();
+  bool sendChannelText(const char* text);
+
+protected:
+  float getAirtimeBudgetFactor() const override { return _cfg.airtime_factor; }
+  float getDutyCycleLimit() const override { return _cfg.duty_cycle; }
+  int calcRxDelay(float score, uint32_t air_time) const override;
+  bool allowPacketForward(const mesh::Packet* packet) override { return _cfg.is_repeater; }
+  uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
+  uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override;
+
+  void logTx(mesh::Packet* packet, int len) override;
+  void logTxFail(mesh::Packet* packet, int len) override { tx_fails++; }
+
+  // BaseChatMesh
+  void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) override { }
+  ContactInfo* processAck(const uint8_t *data) override { return NULL; }
+  void onContactPathUpdated(const ContactInfo& contact) override { }
+  void onMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onCommandDataRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onSignedMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const uint8_t *sender_prefix, const char *text) override { }
+  uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override { return 500 + 16*pkt_airtime_millis; }
+  uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override {
+    return 500 + (pkt_airtime_millis*6 + 250)*(path_len + 1);
+  }
+  void onSendTimeout() override { }
+  void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) override;
+  uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override { return 0; }
+  void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override { }
+};
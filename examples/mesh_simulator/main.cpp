@@ -0,0 +1,447 @@
+// Discrete-time, multi-node mesh simulator. All nodes share one virtual clock, so runs are fully
+// deterministic for a given --seed. Reports delivery ratio and latency of flooded channel messages,
+// duplicate forwards, collisions and channel utilisation per node.
+//
+//   mesh_simulator --nodes 200 --repeaters 80 --area 30000 --msgs 50 --adverts --csv nodes.csv
+//   mesh_simulator --topology links.txt ...     (lines of: <from> <to> <snr> [<rssi>], '#' comments)
+//
+// NOTE: with --crypto-worker, jobs complete in real time on other threads, so runs are no longer deterministic.
+
+#include <Arduino.h>
+#include <helpers/native/SimMedium.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/HashedMeshTables.h>
+#include <helpers/native/ThreadCryptoWorker.h>
+#include <helpers/StatsFormatHelper.h>
+#include "SimNode.h"
+
+#include <algorithm>
+#include <vector>
+
+struct SimEvent {
+  unsigned long when;
+  int node;
+  int msg_id;   // -1 for an advert
+  bool operator<(const SimEvent& other) const { return when < other.when; }
+};
+
+struct SimOptions {
+  int num_nodes = 100;
+  int num_repeaters = 30;
+  float area = 20000;         // metres (square)
+  float tx_power = 22;        // dBm
+  float pl_exp = 2.8f;        // log-distance path loss exponent (PL0 = 40dB @ 1m)
+  float shadowing = 4.0f;     // std-dev of per-link shadowing, dB
+  const char* topology = NULL;
+  uint32_t duration = 600;    // seconds
+  int msgs = 50;
+  bool adverts = false;
+  bool crypto_worker = false;   // offload advert verify to a ThreadCryptoWorker per node
+  uint32_t advert_window = 60;   // seconds
+  float capture_db = 6.0f;
+  int dedup_capacity = 0;     // > 0 to use HashedMeshTables
+  uint32_t dedup_max_age = HASHED_TABLES_MAX_AGE_MILLIS / 1000;   // seconds
+  uint32_t seed = 1;
+  const char* csv = NULL;
+  SimRadioParams radio;
+  SimNodeConfig repeater, client;
+
+  SimOptions() {
+    repeater.is_repeater = true;
+  }
+};
+
+class Simulator : public SimNodeListener {
+  SimOptions _opts;
+  VirtualMillisClock _clock;
+  SimRNG _rng;
+  SimMedium* _medium;
+  std::vector<SimNode*> _nodes;
+  std::vector<SimpleMeshTables*> _simple_tables;   // per node, one of these is used
+  std::vector<HashedMeshTables*> _hashed_tables;
+  std::vector<ThreadCryptoWorker*> _workers;
+  std::vector<SimEvent> _events;
+  std::vector<unsigned long> _msg_sent_at;
+  std::vector<bool> _delivered;   // [msg * num_nodes + node]
+  std::vector<uint32_t> _latencies;
+  uint32_t _num_delivered = 0;
+
+  float noiseFloor() const { return -174 + 10*log10f(_opts.radio.bw * 1000) + 6; }   // 6dB NF
+  float gaussian();
+  void buildRandomTopology();
+  bool loadTopology(const char* filename);
+  void scheduleTraffic();
+  uint32_t getNumFloodDups(int i) const {
+    return _hashed_tables[i] ? _hashed_tables[i]->getNumFloodDups() : _simple_tables[i]->getNumFloodDups();
+  }
+  uint32_t getNumEvictions(int i) const {
+    return _hashed_tables[i] ? _hashed_tables[i]->getNumEvictions() : 0;
+  }
+
+public:
+  Simulator(const SimOptions& opts) : _opts(opts), _rng(opts.seed) { }
+
+  bool setup();
+  void run();
+  void report();
+
+  void onChannelMessage(SimNode& node, const char* text) override;
+};
+
+float Simulator::gaussian() {   // Box-Muller
+  float u1 = (_rng.next() + 1.0f) / 4294967296.0f;
+  float u2 = _rng.next() / 4294967296.0f;
+  return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+bool Simulator::setup() {
+  int n = _opts.num_nodes;
+  _medium = new SimMedium(_clock, n, n);
+  _medium->capture_db = _opts.capture_db;
+
+  // choose which nodes are repeaters (deterministically)
+  std::vector<bool> is_rpt(n, false);
+  for (int i = 0, placed = 0; placed < _opts.num_repeaters && placed < n; i = (i + 1) % n) {
+    if (!is_rpt[i] && _rng.next() % n < (uint32_t)_opts.num_repeaters) {
+      is_rpt[i] = true;
+      placed++;
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    auto radio = new SimRadio(_clock, _opts.radio, _opts.seed*7919 + i);
+    auto rng = new SimRNG(_opts.seed*104729 + i);
+    auto rtc = new VirtualRTCClock(_clock);
+    mesh::MeshTables* tables;
+    if (_opts.dedup_capacity > 0) {
+      _hashed_tables.push_back(new HashedMeshTables(_clock, _opts.dedup_capacity, _opts.dedup_capacity / 2, _opts.dedup_max_age * 1000));
+      _simple_tables.push_back(NULL);
+      tables = _hashed_tables.back();
+    } else {
+      _simple_tables.push_back(new SimpleMeshTables());
+      _hashed_tables.push_back(NULL);
+      tables = _simple_tables.back();
+    }
+    auto node = new SimNode(i, is_rpt[i] ? _opts.repeater : _opts.client, *radio, _clock, *rng, *rtc, *tables, this);
+    _medium->addRadio(*radio);
+    if (_opts.crypto_worker) {
+      auto worker = new ThreadCryptoWorker();
+      worker->begin();
+      node->setCryptoWorker(worker);
+      _workers.push_back(worker);
+    }
+    node->begin();
+    _nodes.push_back(node);
+  }
+
+  if (_opts.topology) {
+    if (!loadTopology(_opts.topology)) return false;
+  } else {
+    buildRandomTopology();
+  }
+  scheduleTraffic();
+  return true;
+}
+
+void Simulator::buildRandomTopology() {
+  int n = _opts.num_nodes;
+  std::vector<float> x(n), y(n);
+  for (int i = 0; i < n; i++) {
+    x[i] = (_rng.next() / 4294967296.0f) * _opts.area;
+    y[i] = (_rng.next() / 4294967296.0f) * _opts.area;
+  }
+  static const float snr_floor[] = { -7.5, -10, -12.5, -15, -17.5, -20 };
+  float min_snr = snr_floor[_opts.radio.sf - 7] - 6;   // still close enough to interfere
+  float nf = noiseFloor();
+
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      float d = sqrtf((x[i]-x[j])*(x[i]-x[j]) + (y[i]-y[j])*(y[i]-y[j]));
+      if (d < 1) d = 1;
+      float rssi = _opts.tx_power - (40 + 10*_opts.pl_exp*log10f(d)) + gaussian()*_opts.shadowing;
+      float snr = rssi - nf;
+      if (snr < min_snr) continue;
+
+      _medium->addLink(i, j, snr, rssi);   // symmetric links
+      _medium->addLink(j, i, snr, rssi);
+    }
+  }
+}
+
+bool Simulator::loadTopology(const char* filename) {
+  FILE* f = fopen(filename, "r");
+  if (f == NULL) {
+    fprintf(stderr, "can't open topology file: %s\n", filename);
+    return false;
+  }
+  char line[128];
+  int line_no = 0;
+  while (fgets(line, sizeof(line), f)) {
+    line_no++;
+    if (line[0] == '#' || line[0] == '\n') continue;
+
+    int a, b;
+    float snr, rssi;
+    int n = sscanf(line, "%d %d %f %f", &a, &b, &snr, &rssi);
+    if (n < 3) {
+      fprintf(stderr, "%s:%d: bad link\n", filename, line_no);
+      continue;
+    }
+    if (n < 4) rssi = snr + noiseFloor();
+    if (!_medium->addLink(a, b, snr, rssi)) {
+      fprintf(stderr, "%s:%d: invalid node index, or too many links\n", filename, line_no);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+void Simulator::scheduleTraffic() {
+  int n = _opts.num_nodes;
+  if (_opts.adverts) {
+    for (int i = 0; i < n; i++) {
+      SimEvent e = { _rng.next() % (_opts.advert_window*1000 + 1), i, -1 };
+      _events.push_back(e);
+    }
+  }
+  // channel messages, after the adverts, and leaving time at end for them to propagate
+  uint32_t start = _opts.adverts ? _opts.advert_window*1000 : 0;
+  uint32_t span = _opts.duration*1000 * 3/4 - (start < _opts.duration*750 ? start : 0);
+  for (int m = 0; m < _opts.msgs; m++) {
+    SimEvent e = { start + _rng.next() % (span + 1), (int)(_rng.next() % n), m };
+    _events.push_back(e);
+  }
+  std::stable_sort(_events.begin(), _events.end());
+
+  _msg_sent_at.assign(_opts.msgs, 0);
+  _delivered.assign((size_t)_opts.msgs * n, false);
+}
+
+void Simulator::onChannelMessage(SimNode& node, const char* text) {
+  const char* sp = strstr(text, ": m");   // "<sender>: m<id>"
+  if (sp == NULL) return;
+  int id = atoi(sp + 3);
+  if (id < 0 || id >= _opts.msgs) return;
+
+  size_t k = (size_t)id * _opts.num_nodes + node.getIndex();
+  if (!_delivered[k]) {
+    _delivered[k] = true;
+    _num_delivered++;
+    _latencies.push_back(_clock.getMillis() - _msg_sent_at[id]);
+  }
+}
+
+void Simulator::run() {
+  unsigned long end = _opts.duration * 1000UL;
+  size_t next_event = 0;
+
+  while (_clock.getMillis() < end) {
+    unsigned long now = _clock.getMillis();
+    while (next_event < _events.size() && _events[next_event].when <= now) {
+      const SimEvent& e = _events[next_event++];
+      SimNode* node = _nodes[e.node];
+      if (e.msg_id < 0) {
+        node->sendAdvert();
+      } else {
+        char text[16];
+        sprintf(text, "m%d", e.msg_id);
+        _msg_sent_at[e.msg_id] = now;
+        node->sendChannelText(text);
+      }
+    }
+
+    _medium->loop();
+    for (size_t i = 0; i < _nodes.size(); i++) {
+      _nodes[i]->loop();
+    }
+
+    // skip ahead over idle periods (nothing on air, and every node's Packet pool is full)
+    bool idle = !_medium->isActive();
+    for (size_t i = 0; idle && i < _nodes.size(); i++) {
+      idle = _nodes[i]->isIdle();
+    }
+    if (idle && next_event < _events.size() && _events[next_event].when > now + 1) {
+      _clock.setMillis(_events[next_event].when);
+    } else if (idle && next_event >= _events.size()) {
+      _clock.setMillis(end);
+    } else {
+      _clock.advance(1);
+    }
+  }
+
+  for (size_t i = 0; i < _workers.size(); i++) {
+    _workers[i]->stop();
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, float p) {
+  if (sorted.empty()) return 0;
+  size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5f);
+  return sorted[idx];
+}
+
+void Simulator::report() {
+  int n = _opts.num_nodes;
+  float secs = _opts.duration;
+
+  uint32_t links = 0, tx_total = 0, fwd_grp = 0, dup_fwd = 0, collided = 0, half_dup = 0, flood_dups = 0, tx_fails = 0;
+  uint32_t evictions = 0;
+  uint32_t pool_high_water = 0, alloc_failures = 0;
+  uint32_t drops[DROP_NUM_REASONS] = { 0 }, max_queue_wait = 0;
+  uint32_t trial_pkts = 0, mac_checks = 0, max_checks = 0, advert_hits = 0, advert_misses = 0;
+  float max_util = 0, sum_util = 0, max_load = 0;
+  for (int i = 0; i < n; i++) {
+    SimNode* node = _nodes[i];
+    const SimMediumStats& st = _medium->getStats(i);
+    mesh::PacketPoolStats pool;
+    if (node->getPoolStats(pool)) {
+      if (pool.high_water > pool_high_water) pool_high_water = pool.high_water;
+      alloc_failures += pool.alloc_failures;
+    }
+    const mesh::TrialMatchStats& trial = node->getTrialMatchStats();
+    trial_pkts += trial.packets;
+    mac_checks += trial.mac_checks;
+    if (trial.max_per_packet > max_checks) max_checks = trial.max_per_packet;
+    advert_hits += node->getAdvertVerifyHits();
+    advert_misses += node->getAdvertVerifyMisses();
+    for (int r = 0; r < DROP_NUM_REASONS; r++) drops[r] += node->getNumDropped(r);
+    if (node->getQueueStats().max_wait > max_queue_wait) max_queue_wait = node->getQueueStats().max_wait;
+    links += _medium->getNumLinks(i);
+    tx_total += node->getSimRadio().getPacketsSent();
+    fwd_grp += node->tx_by_type[PAYLOAD_TYPE_GRP_TXT];
+    dup_fwd += node->dup_forwards;
+    tx_fails += node->tx_fails;
+    collided += st.rx_collided;
+    half_dup += st.rx_half_duplex;
+    flood_dups += getNumFloodDups(i);
+    evictions += getNumEvictions(i);
+    float util = node->getTotalAirTime() / (secs * 10.0f);   // percent
+    sum_util += util;
+    if (util > max_util) max_util = util;
+    float load = st.heard_millis / (secs * 10.0f);
+    if (load > max_load) max_load = load;
+  }
+
+  std::vector<uint32_t> lat(_latencies);
+  std::sort(lat.begin(), lat.end());
+  uint32_t possible = (uint32_t)_opts.msgs * (n - 1);
+
+  printf("nodes: %d (%d repeaters), avg degree: %.1f, SF%d BW%.0f CR4/%d\n", n, _opts.num_repeaters, links / (float)n,
+         (int)_opts.radio.sf, _opts.radio.bw, (int)_opts.radio.cr);
+  printf("channel msgs: %d, delivery ratio: %.3f (%u/%u)\n", _opts.msgs, possible ? _num_delivered / (float)possible : 0.0f, _num_delivered, possible);
+  printf("latency ms: p50=%u p90=%u p99=%u max=%u\n", percentile(lat, 0.5f), percentile(lat, 0.9f), percentile(lat, 0.99f),
+         lat.empty() ? 0 : lat.back());
+  printf("transmissions: %u total, %u GRP_TXT (%.1f per msg), %u duplicate forwards, %u tx fails\n", tx_total, fwd_grp,
+         _opts.msgs ? fwd_grp / (float)_opts.msgs : 0.0f, dup_fwd, tx_fails);
+  printf("rx losses: %u collisions, %u half-duplex; dups suppressed: %u", collided, half_dup, flood_dups);
+  if (_opts.dedup_capacity > 0) printf(", dedup evictions before expiry: %u", evictions);
+  printf("\n");
+  printf("packet pool: max high-water %u (of %d), %u alloc failures\n", pool_high_water, _opts.client.pool_size, alloc_failures);
+  printf("trial MAC checks: %.2f per datagram (max %u), %u datagrams\n", trial_pkts ? mac_checks / (float)trial_pkts : 0.0f, max_checks, trial_pkts);
+  printf("advert signatures: %u verified, %u already verified (cached)\n", advert_misses, advert_hits);
+  printf("tx utilisation: avg %.2f%%, max %.2f%%; max channel load heard: %.2f%%\n", sum_util / n, max_util, max_load);
+  printf("drops: dup %u, no MAC match %u, not next hop %u, pool full %u, corrupt %u, tx timeout %u, duty cycle %u; max tx queue wait %u ms\n",
+         drops[DROP_DUPLICATE], drops[DROP_NO_MAC_MATCH], drops[DROP_NOT_NEXT_HOP], drops[DROP_POOL_FULL], drops[DROP_CORRUPT],
+         drops[DROP_TX_TIMEOUT], drops[DROP_DUTY_CYCLE], max_queue_wait);
+  if (mesh::LoopProfiler::isEnabled()) {   // host timings, summed over all nodes
+    char reply[512];
+    StatsFormatHelper::formatLoopStats(reply, sizeof(reply));
+    printf("loop profile [count,avg_us,max_us]: %s\n", reply);
+  }
+
+  if (_opts.csv) {
+    FILE* f = fopen(_opts.csv, "w");
+    if (f == NULL) {
+      fprintf(stderr, "can't write: %s\n", _opts.csv);
+      return;
+    }
+    fprintf(f, "node,repeater,degree,sent,recv,flood_dups,dup_forwards,collisions,half_duplex,weak,pool_high_water,tx_util_pct,chan_load_pct\n");
+    for (int i = 0; i < n; i++) {
+      SimNode* node = _nodes[i];
+      const SimMediumStats& st = _medium->getStats(i);
+      mesh::PacketPoolStats pool;
+      if (!node->getPoolStats(pool)) memset(&pool, 0, sizeof(pool));
+      fprintf(f, "%d,%d,%d,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%.3f\n", i, node->getConfig().is_repeater ? 1 : 0, _medium->getNumLinks(i),
+              node->getSimRadio().getPacketsSent(), node->getSimRadio().getPacketsRecv(), getNumFloodDups(i),
+              node->dup_forwards, st.rx_collided, st.rx_half_duplex, st.rx_weak, (uint32_t)pool.high_water,
+              node->getTotalAirTime() / (secs * 10.0f), st.heard_millis / (secs * 10.0f));
+    }
+    fclose(f);
+  }
+}
+
+static void usage() {
+  printf("usage: mesh_simulator [options]\n"
+    "  --nodes N            number of nodes (100)\n"
+    "  --repeaters N        how many of them are repeaters (30)\n"
+    "  --area M             side of square area, metres (20000)\n"
+    "  --pl-exp X           path loss exponent (2.8)\n"
+    "  --shadowing DB       per-link shadowing std-dev (4)\n"
+    "  --topology FILE      load links from FILE instead (lines: from to snr [rssi])\n"
+    "  --duration SECS      simulated time (600)\n"
+    "  --msgs N             number of flooded channel messages (50)\n"
+    "  --adverts            every node floods an advert in the first --advert-window secs (60)\n"
+    "  --crypto-worker      verify adverts / calc shared secrets on a worker thread per node\n"
+    "  --sf N --bw KHZ --cr N   radio params (11, 250, 5)\n"
+    "  --tx-delay-factor X  repeater flood retransmit delay factor (0.5)\n"
+    "  --direct-tx-delay-factor X  (0.2)\n"
+    "  --rx-delay-base X    score based rx delay, 0 = off (0)\n"
+    "  --airtime-factor X   (1.0)\n"
+    "  --duty-cycle PCT     hourly duty cycle limit, 0 = none (0)\n"
+    "  --pool N             Packet pool size per node (16)\n"
+    "  --heap-queue         use HeapPoolPacketManager\n"
+    "  --capture-db DB      capture effect margin (6)\n"
+    "  --dedup N            use HashedMeshTables with N packet hashes (default: SimpleMeshTables)\n"
+    "  --dedup-age SECS     HashedMeshTables max entry age (600)\n"
+    "  --seed N             (1)\n"
+    "  --csv FILE           write per-node stats\n");
+}
+
+int main(int argc, char* argv[]) {
+  SimOptions opts;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+    bool has_arg = true;
+    if (strcmp(a, "--adverts") == 0) { opts.adverts = true; has_arg = false; }
+    else if (strcmp(a, "--crypto-worker") == 0) { opts.crypto_worker = true; has_arg = false; }
+    else if (strcmp(a, "--heap-queue") == 0) { opts.repeater.heap_queue = opts.client.heap_queue = true; has_arg = false; }
+    else if (strcmp(a, "--help") == 0 || v == NULL) { usage(); return 1; }
+    else if (strcmp(a, "--nodes") == 0) opts.num_nodes = atoi(v);
+    else if (strcmp(a, "--repeaters") == 0) opts.num_repeaters = atoi(v);
+    else if (strcmp(a, "--area") == 0) opts.area = atof(v);
+    else if (strcmp(a, "--pl-exp") == 0) opts.pl_exp = atof(v);
+    else if (strcmp(a, "--shadowing") == 0) opts.shadowing = atof(v);
+    else if (strcmp(a, "--topology") == 0) opts.topology = v;
+    else if (strcmp(a, "--duration") == 0) opts.duration = atoi(v);
+    else if (strcmp(a, "--msgs") == 0) opts.msgs = atoi(v);
+    else if (strcmp(a, "--advert-window") == 0) opts.advert_window = atoi(v);
+    else if (strcmp(a, "--sf") == 0) opts.radio.sf = atoi(v);
+    else if (strcmp(a, "--bw") == 0) opts.radio.bw = atof(v);
+    else if (strcmp(a, "--cr") == 0) opts.radio.cr = atoi(v);
+    else if (strcmp(a, "--tx-delay-factor") == 0) opts.repeater.tx_delay_factor = atof(v);
+    else if (strcmp(a, "--direct-tx-delay-factor") == 0) opts.repeater.direct_tx_delay_factor = atof(v);
+    else if (strcmp(a, "--rx-delay-base") == 0) opts.repeater.rx_delay_base = opts.client.rx_delay_base = atof(v);
+    else if (strcmp(a, "--airtime-factor") == 0) opts.repeater.airtime_factor = opts.client.airtime_factor = atof(v);
+    else if (strcmp(a, "--duty-cycle") == 0) opts.repeater.duty_cycle = opts.client.duty_cycle = atof(v) / 100.0f;
+    else if (strcmp(a, "--pool") == 0) opts.repeater.pool_size = opts.client.pool_size = atoi(v);
+    else if (strcmp(a, "--capture-db") == 0) opts.capture_db = atof(v);
+    else if (strcmp(a, "--dedup") == 0) opts.dedup_capacity = atoi(v);
+    else if (strcmp(a, "--dedup-age") == 0) opts.dedup_max_age = atoi(v);
+    else if (strcmp(a, "--seed") == 0) opts.seed = atoi(v);
+    else if (strcmp(a, "--csv") == 0) opts.csv = v;
+    else { usage(); return 1; }
+    if (has_arg) i++;
+  }
+  if (opts.num_nodes < 2 || opts.radio.sf < 7 || opts.radio.sf > 12) {
+    usage();
+    return 1;
+  }
+  if (opts.num_repeaters > opts.num_nodes) opts.num_repeaters = opts.num_nodes;
+
+  Simulator sim(opts);
+  if (!sim.setup()) return 1;
+  sim.run();
+  sim.report();
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Micro-benchmark of the PacketManager implementations, modelled on a busy repeater: every tick
+// Dispatcher::checkSend() asks getOutboundCount(now), then getNextOutbound(now), and sent packets
+// are replaced by new arrivals, scheduled a random delay ahead, with random priority.
+//
+//   queue_bench [iterations]
+
+#include <Arduino.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <helpers/HeapPoolPacketManager.h>
+#include <chrono>
+
+static uint32_t rng_state = 1;
+
+static uint32_t nextRand() {
+  uint32_t x = rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return rng_state = x;
+}
+
+struct BenchResult {
+  double ns_per_tick;
+  uint32_t sent;
+};
+
+static BenchResult runBusyRepeater(mesh::PacketManager& mgr, int pool_size, uint32_t ticks, uint32_t start_millis) {
+  rng_state = 12345;
+  uint32_t now = start_millis;
+  uint32_t max_delay = 20 * pool_size;   // keeps roughly 1/20 of the queue due at any time
+  for (int i = 0; i < pool_size; i++) {
+    mgr.queueOutbound(mgr.allocNew(), nextRand() % 4, now + nextRand() % max_delay);
+  }
+
+  BenchResult res = { 0, 0 };
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < ticks; t++, now++) {
+    if (mgr.getOutboundCount(now) == 0) continue;
+    mesh::Packet* pkt = mgr.getNextOutbound(now);
+    if (pkt == NULL) continue;
+    res.sent++;
+    mgr.free(pkt);
+    mgr.queueOutbound(mgr.allocNew(), nextRand() % 4, now + nextRand() % max_delay);   // next arrival
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  res.ns_per_tick = std::chrono::duration<double, std::nano>(t1 - t0).count() / ticks;
+
+  while (mgr.getOutboundTotal() > 0) {   // drain
+    mgr.free(mgr.removeOutboundByIdx(0));
+  }
+  return res;
+}
+
+// queue a packet due 500ms ahead, just before millis() wraps, then see whether it's released early
+template <class T>
+static bool releasedEarlyAtRollover() {
+  T mgr(4);
+  uint32_t now = 0xFFFFFF00;
+  mgr.queueOutbound(mgr.allocNew(), 0, now + 500);
+  return mgr.getNextOutbound(now) != NULL;
+}
+
+int main(int argc, char* argv[]) {
+  uint32_t ticks = argc > 1 ? atoi(argv[1]) : 2000000;
+
+  printf("busy repeater, %u ticks (ns per checkSend() tick):\n", ticks);
+  printf("%6s %14s %14s %8s\n", "pool", "StaticPool", "HeapPool", "speedup");
+  static const int sizes[] = { 16, 32, 64, 128, 256 };
+  for (int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    int n = sizes[i];
+    StaticPoolPacketManager linear(n);
+    HeapPoolPacketManager heap(n);
+    BenchResult a = runBusyRepeater(linear, n, ticks, 1000);
+    BenchResult b = runBusyRepeater(heap, n, ticks, 1000);
+    printf("%6d %14.1f %14.1f %7.2fx%s\n", n, a.ns_per_tick, b.ns_per_tick, a.ns_per_tick / b.ns_per_tick,
+           a.sent == b.sent ? "" : "  (send counts differ!)");
+  }
+
+  printf("\nmillis() rollover, packet due in 500ms released immediately:\n");
+  printf("  StaticPool: %s\n", releasedEarlyAtRollover<StaticPoolPacketManager>() ? "yes (BUG)" : "no");
+  printf("  HeapPool:   %s\n", releasedEarlyAtRollover<HeapPoolPacketManager>() ? "yes (BUG)" : "no");
+  return 0;
+}
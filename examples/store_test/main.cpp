@@ -0,0 +1,343 @@
+// Crash recovery tests for the companion DataStore, against the in-memory FS stand-in (arch/native/include/FS.h).
+// Simulates power loss part way through writes, and damaged files (contacts, chat log segments), then checks
+// what a fresh DataStore loads.
+//
+//   store_test
+
+#include <Arduino.h>
+#include <DataStore.h>
+#include <vector>
+
+static int num_checks = 0, num_failed = 0;
+
+#define CHECK(cond, ...)  do { num_checks++; if (!(cond)) { num_failed++; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+class TestClock : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1700000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class TestHost : public DataStoreHost {
+public:
+  std::vector<ContactInfo> contacts;
+
+  bool onContactLoaded(const ContactInfo& contact) override { contacts.push_back(contact); return true; }
+  bool getContactForSave(uint32_t idx, ContactInfo& contact) override {
+    if (idx >= contacts.size()) return false;
+    contact = contacts[idx];
+    return true;
+  }
+  ContactInfo* lookupContactForLoad(const uint8_t* key_prefix, int prefix_len) override {
+    for (auto& c : contacts) {
+      if (memcmp(c.id.pub_key, key_prefix, prefix_len) == 0) return &c;
+    }
+    return NULL;
+  }
+  bool onContactDeleted(ContactInfo& contact) override {
+    contacts.erase(contacts.begin() + (&contact - &contacts[0]));
+    return true;
+  }
+  bool onSharedSecretLoaded(const uint8_t* pub_key, const uint8_t* secret) override { return false; }
+  bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return true; }
+  bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return false; }
+};
+
+static TestClock test_clock;
+
+static ContactInfo makeContact(int n) {
+  ContactInfo c;
+  memset(&c, 0, sizeof(c));
+  uint8_t pub_key[PUB_KEY_SIZE];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) pub_key[i] = random(256);
+  c.id = mesh::Identity(pub_key);
+  snprintf(c.name, sizeof(c.name), "node%d", n);
+  c.out_path_len = -1;
+  c.lastmod = n;
+  return c;
+}
+
+static bool sameContacts(const TestHost& a, const TestHost& b) {
+  if (a.contacts.size() != b.contacts.size()) return false;
+  for (size_t i = 0; i < a.contacts.size(); i++) {
+    const ContactInfo& x = a.contacts[i];
+    const ContactInfo& y = b.contacts[i];
+    if (memcmp(x.id.pub_key, y.id.pub_key, PUB_KEY_SIZE) != 0 || strcmp(x.name, y.name) != 0 || x.lastmod != y.lastmod
+        || x.out_path_len != y.out_path_len || x.gps_lat != y.gps_lat || x.flags != y.flags) return false;
+  }
+  return true;
+}
+
+static void changeSome(TestHost& host, int count) {
+  for (int i = 0; i < count; i++) {
+    host.contacts[random(host.contacts.size())].lastmod = random(1000000);
+  }
+}
+
+// what a fresh boot loads
+static TestHost reload(fs::FS& fs) {
+  DataStore store(fs, test_clock);
+  TestHost host;
+  store.loadContacts(&host);
+  return host;
+}
+
+static void testContactsRecovery() {
+  fs::FS fs;
+  TestHost saved;
+  for (int i = 0; i < 100; i++) saved.contacts.push_back(makeContact(i));
+  {
+    DataStore store(fs, test_clock);
+    store.saveContacts(&saved);   // first save, writes all
+    CHECK(fs.exists("/contacts3") && !fs.exists("/contacts3_tmp"), "initial save");
+  }
+  DataStore store(fs, test_clock);
+  TestHost host;
+  store.loadContacts(&host);
+  CHECK(sameContacts(saved, host), "initial load");
+
+  changeSome(host, 5);
+  store.saveContacts(&host);   // journaled
+  CHECK(fs.exists("/contacts3_jnl"), "change went to journal");
+  TestHost before = reload(fs);
+  CHECK(sameContacts(host, before), "base + journal");
+
+  // power lost part way through rewriting (an unsynced store rewrites all), temp file is torn
+  for (int budget : { 0, 100, 1000, 100 * CONTACT_REC_SIZE - 1 }) {
+    TestHost changed = before;
+    changeSome(changed, 3);
+    {
+      DataStore fresh(fs, test_clock);
+      fs.setWriteBudget(budget);
+      fresh.saveContacts(&changed);
+      fs.setWriteBudget(-1);
+    }
+    TestHost after = reload(fs);
+    CHECK(sameContacts(before, after), "rewrite torn after %d bytes: old contacts + journal not intact", budget);
+    CHECK(!fs.exists("/contacts3_tmp"), "torn temp file left behind");
+  }
+
+  // power lost before the failed write could clean up: partial, or garbage, temp file found at boot
+  fs::FileData tmp_data;
+  {
+    fs::FileData* base = fs.getData("/contacts3");
+    tmp_data.assign(base->begin(), base->begin() + base->size() / 2);
+  }
+  for (int damage = 0; damage < 2; damage++) {
+    File f = fs.open("/contacts3_tmp", "w");
+    if (damage) {
+      memset(tmp_data.data(), 0xA5, tmp_data.size());
+    }
+    f.write(tmp_data.data(), tmp_data.size());
+    f.close();
+    TestHost after = reload(fs);
+    CHECK(sameContacts(before, after), "stale temp file (%s) loaded", damage ? "garbage" : "truncated");
+    CHECK(!fs.exists("/contacts3_tmp"), "stale temp file not removed");
+  }
+
+  // completed rewrite, but power lost before the journal was removed: replaying it again must be harmless
+  fs::FileData journal = *fs.getData("/contacts3_jnl");
+  {
+    DataStore fresh(fs, test_clock);
+    fresh.saveContacts(&before);
+  }
+  CHECK(!fs.exists("/contacts3_jnl"), "journal removed after rewrite");
+  {
+    File f = fs.open("/contacts3_jnl", "w");
+    f.write(journal.data(), journal.size());
+    f.close();
+  }
+  CHECK(sameContacts(before, reload(fs)), "stale journal replayed over new base");
+
+  // SPIFFS style (no rename over existing): lost power after removing /contacts3, before the rename
+  {
+    fs::FileData base = *fs.getData("/contacts3");
+    fs.remove("/contacts3");
+    File f = fs.open("/contacts3_tmp", "w");
+    f.write(base.data(), base.size());
+    f.close();
+  }
+  TestHost after = reload(fs);
+  CHECK(sameContacts(before, after), "complete temp file not recovered");
+  CHECK(fs.exists("/contacts3") && !fs.exists("/contacts3_tmp"), "temp file not renamed to /contacts3");
+
+  // torn journal append: loads either the old or the new state, and the next save gets back in sync
+  {
+    DataStore s(fs, test_clock);
+    TestHost h;
+    s.loadContacts(&h);
+    TestHost old_state = h;
+    changeSome(h, 1);
+    fs.setWriteBudget(10);
+    s.saveContacts(&h);
+    fs.setWriteBudget(-1);
+    TestHost loaded = reload(fs);
+    CHECK(sameContacts(old_state, loaded) || sameContacts(h, loaded), "torn journal record");
+
+    DataStore s2(fs, test_clock);
+    TestHost h2;
+    s2.loadContacts(&h2);
+    changeSome(h2, 2);
+    s2.saveContacts(&h2);
+    CHECK(sameContacts(h2, reload(fs)), "save after torn journal record");
+  }
+}
+
+static bool appendChat(DataStore& store, uint8_t key, const char* text) {
+  ChatLogRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.key[0] = key;
+  strcpy(rec.from_name, "x");
+  strcpy(rec.text, text);
+  return store.appendChatMessage(rec);
+}
+
+// msg00, msg01, ... alternating between conversations 0 and 1 (msgNN gets seq NN+1). With the 256 byte
+// CHAT_LOG_SEGMENT_SIZE the store_test target is built with, 7 fit in each segment
+static void fillChatLog(fs::FS& fs, int count) {
+  DataStore store(fs, test_clock);
+  for (int i = 0; i < count; i++) {
+    char text[16];
+    sprintf(text, "msg%02d", i);
+    appendChat(store, i & 1, text);
+  }
+}
+
+static int readWholeLog(DataStore& store, ChatLogRecord dest[], int max) {
+  uint32_t pos = store.findChatLogStart(0);
+  int n = 0, got;
+  while (n < max && (got = store.readChatLog(pos, 0, &dest[n], max - n)) > 0) n += got;
+  return n;
+}
+
+static bool inSeqOrder(const ChatLogRecord recs[], int n) {
+  for (int i = 1; i < n; i++) {
+    if (recs[i].seq <= recs[i - 1].seq) return false;
+  }
+  return true;
+}
+
+// the segment file holding 'text'
+static fs::FileData* findSegment(fs::FS& fs, const char* text, size_t& offset) {
+  for (int slot = 0; slot < CHAT_LOG_MAX_SEGMENTS; slot++) {
+    char filename[16];
+    sprintf(filename, "/chat_log%d", slot);
+    fs::FileData* data = fs.getData(filename);
+    if (data == NULL) continue;
+    for (offset = 0; offset + strlen(text) <= data->size(); offset++) {
+      if (memcmp(data->data() + offset, text, strlen(text)) == 0) return data;
+    }
+  }
+  return NULL;
+}
+
+static void testChatLogTornTail() {
+  fs::FS fs;
+  fillChatLog(fs, 30);
+  size_t offset;
+  fs::FileData* newest = findSegment(fs, "msg29", offset);
+  newest->resize(newest->size() - 2);   // power lost while appending msg29
+
+  const uint8_t key1[CHAT_LOG_KEY_LEN] = { 1 };
+  ChatLogRecord recs[64];
+  {
+    DataStore store(fs, test_clock);
+    CHECK(store.getChatLogNextSeq() == 30, "torn tail: next seq %u", store.getChatLogNextSeq());
+    int n = store.readChatHistory(store.getChatLogNewest(key1), recs, 64);
+    CHECK(n == 14 && strcmp(recs[0].text, "msg27") == 0, "torn tail: history %d, newest '%s'", n, n ? recs[0].text : "");
+
+    CHECK(appendChat(store, 1, "again"), "append after torn tail");
+    fs.setWriteBudget(10);
+    CHECK(!appendChat(store, 1, "lost"), "torn append not reported");
+    fs.setWriteBudget(-1);
+    CHECK(appendChat(store, 1, "after"), "append after torn append");
+  }
+  DataStore store(fs, test_clock);
+  int n = store.readChatHistory(store.getChatLogNewest(key1), recs, 64);
+  CHECK(n == 16 && strcmp(recs[0].text, "after") == 0 && strcmp(recs[1].text, "again") == 0 && strcmp(recs[2].text, "msg27") == 0,
+        "torn tail: history after appends %d", n);
+  n = readWholeLog(store, recs, 64);
+  CHECK(n == 31 && inSeqOrder(recs, n) && recs[n - 1].seq == 31 && strcmp(recs[n - 1].text, "after") == 0,
+        "torn tail: log after appends %d", n);
+}
+
+static void testChatLogCorruptRecord() {
+  fs::FS fs;
+  fillChatLog(fs, 40);
+  size_t offset;
+  fs::FileData* seg = findSegment(fs, "msg16", offset);
+  (*seg)[offset + 4] ^= 0x01;   // bit rot, part way through the third segment (msg14..msg20)
+
+  const uint8_t key0[CHAT_LOG_KEY_LEN] = { 0 };
+  ChatLogRecord recs[64];
+  DataStore store(fs, test_clock);
+  CHECK(store.getChatLogNextSeq() == 41, "corrupt record: next seq %u", store.getChatLogNextSeq());
+
+  // history follows links back until the bad record
+  int n = store.readChatHistory(store.getChatLogNewest(key0), recs, 64);
+  CHECK(n == 11 && strcmp(recs[0].text, "msg38") == 0 && strcmp(recs[n - 1].text, "msg18") == 0, "corrupt record: history %d", n);
+
+  // sync skips rest of that segment, carries on with the next
+  n = readWholeLog(store, recs, 64);
+  CHECK(n == 35 && inSeqOrder(recs, n) && strcmp(recs[15].text, "msg15") == 0 && strcmp(recs[16].text, "msg21") == 0
+        && strcmp(recs[n - 1].text, "msg39") == 0, "corrupt record: log %d", n);
+}
+
+static void testChatLogBadSegmentHeader() {
+  fs::FS fs;
+  fillChatLog(fs, 40);
+  size_t offset;
+  fs::FileData* seg = findSegment(fs, "msg16", offset);
+  (*seg)[0] ^= 0xFF;   // magic, of the third segment (msg14..msg20)
+
+  const uint8_t key0[CHAT_LOG_KEY_LEN] = { 0 };
+  ChatLogRecord recs[64];
+  {
+    DataStore store(fs, test_clock);
+    CHECK(store.getChatLogNextSeq() == 41, "bad header: next seq %u", store.getChatLogNextSeq());
+
+    // log starts after the bad segment
+    int n = readWholeLog(store, recs, 64);
+    CHECK(n == 19 && inSeqOrder(recs, n) && strcmp(recs[0].text, "msg21") == 0 && strcmp(recs[n - 1].text, "msg39") == 0,
+          "bad header: log %d", n);
+
+    n = store.readChatHistory(store.getChatLogNewest(key0), recs, 64);
+    CHECK(n == 9 && strcmp(recs[0].text, "msg38") == 0 && strcmp(recs[n - 1].text, "msg22") == 0, "bad header: history %d", n);
+    CHECK(appendChat(store, 0, "msg40"), "bad header: append");
+  }
+  DataStore store(fs, test_clock);
+  CHECK(store.getChatLogNextSeq() == 42, "bad header: next seq after append %u", store.getChatLogNextSeq());
+}
+
+static void testChatLogWrap() {
+  fs::FS fs;
+  DataStore store(fs, test_clock);
+  const uint8_t key1[CHAT_LOG_KEY_LEN] = { 1 };
+  appendChat(store, 1, "lonely");
+  uint32_t cursor = store.findChatLogStart(0);
+  ChatLogRecord recs[4];
+  CHECK(store.readChatLog(cursor, 0, recs, 4) == 1, "wrap: first read");
+
+  // past 4096 segments, so segment numbers in positions wrap round
+  while (store.getChatLogNextSeq() < 4096*6) appendChat(store, 2, "filler message text");
+  CHECK(store.getChatLogNewest(key1) == CHAT_LOG_POS_NONE, "wrap: dropped conversation still has a head");
+
+  int n = store.readChatLog(cursor, 0, recs, 4);
+  CHECK(n == 4 && recs[0].seq > 1 && recs[0].seq < 4096*6, "wrap: parked cursor, %d records", n);
+
+  appendChat(store, 1, "back");
+  n = store.readChatHistory(store.getChatLogNewest(key1), recs, 4);
+  CHECK(n == 1 && strcmp(recs[0].text, "back") == 0, "wrap: history of dropped conversation %d", n);
+}
+
+int main(int argc, char* argv[]) {
+  randomSeed(1);
+  testContactsRecovery();
+  testChatLogTornTail();
+  testChatLogCorruptRecord();
+  testChatLogBadSegmentHeader();
+  testChatLogWrap();
+
+  printf("%d checks, %d failed\n", num_checks, num_failed);
+  return num_failed ? 1 : 0;
+}
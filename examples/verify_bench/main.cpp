@@ -0,0 +1,116 @@
+// Micro-benchmark of Ed25519 signature verification of adverts: one at a time (Identity::verify) vs in
+// batches (Identity::verifyBatch), per signature, for batch sizes N = 1..64. Also checks that a batch
+// with one bad, or non-canonical, signature is rejected.
+//
+//   verify_bench [rounds]
+
+#include <Arduino.h>
+#include <Identity.h>
+#include <chrono>
+#define ED25519_NO_SEED  1
+#include <ed_25519.h>
+
+#define MAX_BATCH   64
+#define MSG_LEN     (PUB_KEY_SIZE + 4 + 32)   // typical advert
+
+static uint8_t pub_keys[MAX_BATCH][PUB_KEY_SIZE];
+static uint8_t sigs[MAX_BATCH][SIGNATURE_SIZE];
+static uint8_t msgs[MAX_BATCH][MSG_LEN];
+static void* scratch;
+
+// l, little endian
+static const uint8_t L[32] = {
+  0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+// s += l (or -= l), ie. same scalar mod l, but not reduced
+static void addL(uint8_t* s, bool subtract) {
+  int carry = 0;
+  for (int i = 0; i < 32; i++) {
+    int v = subtract ? s[i] - L[i] - carry : s[i] + L[i] + carry;
+    carry = subtract ? (v < 0) : (v > 0xFF);
+    s[i] = v & 0xFF;
+  }
+}
+
+static void makeAdverts() {
+  uint32_t x = 1;
+  for (int i = 0; i < MAX_BATCH; i++) {
+    uint8_t seed[SEED_SIZE], prv_key[PRV_KEY_SIZE];
+    for (int j = 0; j < SEED_SIZE; j++) { x = x * 1103515245 + 12345; seed[j] = x >> 16; }
+    ed25519_create_keypair(pub_keys[i], prv_key, seed);
+
+    memcpy(msgs[i], pub_keys[i], PUB_KEY_SIZE);
+    for (int j = PUB_KEY_SIZE; j < MSG_LEN; j++) { x = x * 1103515245 + 12345; msgs[i][j] = x >> 16; }
+    ed25519_sign(sigs[i], msgs[i], MSG_LEN, pub_keys[i], prv_key);
+  }
+}
+
+static bool verifyBatch(int n) {
+  const uint8_t* s[MAX_BATCH];
+  const uint8_t* k[MAX_BATCH];
+  const uint8_t* m[MAX_BATCH];
+  int lens[MAX_BATCH];
+  for (int i = 0; i < n; i++) {
+    s[i] = sigs[i];
+    k[i] = pub_keys[i];
+    m[i] = msgs[i];
+    lens[i] = MSG_LEN;
+  }
+  return mesh::Identity::verifyBatch(s, k, m, lens, n, scratch);
+}
+
+int main(int argc, char* argv[]) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 20;
+  makeAdverts();
+  scratch = malloc(mesh::Identity::getBatchScratchSize());
+  printf("batch scratch: %d bytes\n", (int) mesh::Identity::getBatchScratchSize());
+
+  // one at a time
+  bool ok = true;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < MAX_BATCH; i++) {
+      mesh::Identity id(pub_keys[i]);
+      if (!id.verify(sigs[i], msgs[i], MSG_LEN)) ok = false;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double single = std::chrono::duration<double, std::micro>(t1 - t0).count() / (rounds * MAX_BATCH);
+  printf("Ed25519 verify, %d rounds (batches of up to %d per multi-scalar mult)\n", rounds, ED25519_BATCH_CHUNK);
+  printf("single: %.1f us per signature%s\n", single, ok ? "" : "  (verify failed!)");
+
+  printf("%6s %16s %8s\n", "N", "batch (us/sig)", "speedup");
+  static const int sizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+  for (int s = 0; s < (int)(sizeof(sizes)/sizeof(sizes[0])); s++) {
+    int n = sizes[s];
+    ok = true;
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      if (!verifyBatch(n)) ok = false;
+    }
+    t1 = std::chrono::steady_clock::now();
+    double batch = std::chrono::duration<double, std::micro>(t1 - t0).count() / (rounds * n);
+    printf("%6d %16.1f %7.2fx%s\n", n, batch, single / batch, ok ? "" : "  (batch verify failed!)");
+  }
+
+  // a forged signature must fail the whole batch
+  sigs[MAX_BATCH / 2][10] ^= 0x01;
+  bool rejected = !verifyBatch(MAX_BATCH);
+  sigs[MAX_BATCH / 2][10] ^= 0x01;
+  msgs[3][MSG_LEN - 1] ^= 0x80;
+  rejected = rejected && !verifyBatch(8);
+  msgs[3][MSG_LEN - 1] ^= 0x80;
+  printf("bad signature in batch: %s\n", rejected ? "rejected" : "NOT REJECTED!");
+
+  // s + l is the same scalar, but single verify rejects it, so batch must too
+  addL(&sigs[5][32], false);
+  bool non_canonical = !verifyBatch(8);
+  addL(&sigs[5][32], true);
+  non_canonical = non_canonical && verifyBatch(8);
+  printf("non-canonical s in batch: %s\n", non_canonical ? "rejected" : "NOT REJECTED!");
+
+  free(scratch);
+  return rejected && non_canonical ? 0 : 1;
+}
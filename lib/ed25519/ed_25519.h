@@ -18,6 +18,10 @@
 #endif
 
 
+#ifndef ED25519_BATCH_CHUNK
+    #define ED25519_BATCH_CHUNK  16   /* signatures per multi-scalar multiplication (~1.8KB of scratch each) */
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,6 +34,10 @@ void ED25519_DECLSPEC ed25519_create_keypair(unsigned char *public_key, unsigned
 void ED25519_DECLSPEC ed25519_derive_pub(unsigned char *public_key, const unsigned char *private_key);
 void ED25519_DECLSPEC ed25519_sign(unsigned char *signature, const unsigned char *message, size_t message_len, const unsigned char *public_key, const unsigned char *private_key);
 int ED25519_DECLSPEC ed25519_verify(const unsigned char *signature, const unsigned char *message, size_t message_len, const unsigned char *public_key);
+/* returns 1 only if ALL count signatures are valid (see verify_batch.c). scratch is
+   ed25519_verify_batch_scratch_size() bytes, reusable between calls, or NULL to malloc() it each call */
+int ED25519_DECLSPEC ed25519_verify_batch(const unsigned char * const *signatures, const unsigned char * const *messages, const size_t *message_lens, const unsigned char * const *public_keys, size_t count, void *scratch);
+size_t ED25519_DECLSPEC ed25519_verify_batch_scratch_size(void);
 void ED25519_DECLSPEC ed25519_add_scalar(unsigned char *public_key, unsigned char *private_key, const unsigned char *scalar);
 void ED25519_DECLSPEC ed25519_key_exchange(unsigned char *shared_secret, const unsigned char *public_key, const unsigned char *private_key);
 
@@ -0,0 +1,302 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ed_25519.h"
+#include "sha512.h"
+#include "ge.h"
+#include "sc.h"
+
+/*
+Batch verification: for random odd 128-bit z_i, checks that
+
+    (sum z_i s_i) B - sum z_i R_i - sum (z_i h_i) A_i == 0
+
+with one multi-scalar multiplication (interleaved sliding windows, so the 256 doublings are
+shared by all the points). Per signature this costs about two point decompressions plus the
+additions, instead of a full double scalar multiplication and a field inversion.
+
+The z_i are derived by hashing the whole batch, so no RNG is needed.
+
+The check is cofactorless, like single verification (which compares the encoding of
+sB - hA with R), and signatures that single verification would reject on their encoding
+alone fail the batch up front: s must be reduced (s < l), and R and A must be canonical
+point encodings. So a batch of signatures that each pass single verification always
+passes. A batch containing a bad signature fails, except if two or more signatures are
+off by small-order points that cancel out for the chosen z_i, which takes a deliberately
+malformed signature from the key's owner. A 0 result doesn't say which signature is
+bad, callers need to verify them individually then.
+*/
+
+#define WINDOW_MAX  7   /* odd multiples 1P, 3P, 5P, 7P per point */
+
+static const unsigned char B_bytes[32] = {
+    0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+/* l - 1, for negating scalars */
+static const unsigned char L_minus_1[32] = {
+    0xec, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static const unsigned char zero[32] = { 0 };
+
+/* l, little endian */
+static const unsigned char L_bytes[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+/* s < l */
+static int is_reduced_scalar(const unsigned char *s) {
+    int i;
+
+    for (i = 31; i >= 0; --i) {
+        if (s[i] < L_bytes[i]) {
+            return 1;
+        }
+        if (s[i] > L_bytes[i]) {
+            return 0;
+        }
+    }
+    return 0;   /* s == l */
+}
+
+/* does encoded y (ignoring sign bit) equal the value with these bytes: first, 30 x middle, last */
+static int y_equals(const unsigned char *s, unsigned char first, unsigned char middle, unsigned char last) {
+    int i;
+
+    if (s[0] != first || (s[31] & 0x7f) != last) {
+        return 0;
+    }
+    for (i = 1; i < 31; ++i) {
+        if (s[i] != middle) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* y < p, and no sign bit on x = 0 (only possible for y = 1 or y = p - 1) */
+static int is_canonical_point(const unsigned char *s) {
+    if (s[0] >= 0xed && y_equals(s, s[0], 0xff, 0x7f)) {
+        return 0;   /* y >= p = 2^255 - 19 */
+    }
+    if (s[31] & 0x80) {
+        if (y_equals(s, 0x01, 0x00, 0x00) || y_equals(s, 0xec, 0xff, 0x7f)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+typedef struct {
+    ge_cached multiples[(WINDOW_MAX + 1) / 2];
+    signed char digits[256];
+    int top;    /* highest non-zero digit, or -1 */
+} batch_point;
+
+/* same as slide() in ge.c, but with digits in [-WINDOW_MAX, WINDOW_MAX] */
+static int slide_window(signed char *r, const unsigned char *a) {
+    int i;
+    int b;
+    int k;
+    int top = -1;
+
+    for (i = 0; i < 256; ++i) {
+        r[i] = 1 & (a[i >> 3] >> (i & 7));
+    }
+
+    for (i = 0; i < 256; ++i)
+        if (r[i]) {
+            for (b = 1; b <= 4 && i + b < 256; ++b) {
+                if (r[i + b]) {
+                    if (r[i] + (r[i + b] << b) <= WINDOW_MAX) {
+                        r[i] += r[i + b] << b;
+                        r[i + b] = 0;
+                    } else if (r[i] - (r[i + b] << b) >= -WINDOW_MAX) {
+                        r[i] -= r[i + b] << b;
+
+                        for (k = i + b; k < 256; ++k) {
+                            if (!r[k]) {
+                                r[k] = 1;
+                                break;
+                            }
+
+                            r[k] = 0;
+                        }
+                    } else {
+                        break;
+                    }
+                }
+            }
+        }
+
+    for (i = 255; i >= 0; --i) {
+        if (r[i]) {
+            top = i;
+            break;
+        }
+    }
+    return top;
+}
+
+static void prepare_point(batch_point *p, const ge_p3 *P, const unsigned char *scalar) {
+    ge_p1p1 t;
+    ge_p3 u;
+    ge_p3 P2;
+    int i;
+
+    ge_p3_to_cached(&p->multiples[0], P);
+    ge_p3_dbl(&t, P);
+    ge_p1p1_to_p3(&P2, &t);
+    for (i = 1; i < (WINDOW_MAX + 1) / 2; ++i) {
+        ge_add(&t, &P2, &p->multiples[i - 1]);
+        ge_p1p1_to_p3(&u, &t);
+        ge_p3_to_cached(&p->multiples[i], &u);
+    }
+    p->top = slide_window(p->digits, scalar);
+}
+
+static int is_identity(const ge_p2 *r) {
+    fe d;
+    fe_sub(d, r->Y, r->Z);
+    return !fe_isnonzero(r->X) && !fe_isnonzero(d);
+}
+
+static int verify_chunk(batch_point *points, const unsigned char * const *signatures, const unsigned char * const *messages,
+                        const size_t *message_lens, const unsigned char * const *public_keys, size_t count) {
+    unsigned char h[64];
+    unsigned char seed[64];
+    unsigned char z[32];
+    unsigned char zh[32];
+    unsigned char s_sum[32];
+    sha512_context hash;
+    ge_p3 P;
+    ge_p1p1 t;
+    ge_p3 u;
+    ge_p2 r;
+    size_t i, j;
+    int bit;
+    int top = -1;
+
+    /* z_i come from a hash of the whole batch */
+    sha512_init(&hash);
+    for (i = 0; i < count; ++i) {
+        if (!is_reduced_scalar(signatures[i] + 32) || !is_canonical_point(signatures[i]) || !is_canonical_point(public_keys[i])) {
+            return 0;
+        }
+        sha512_update(&hash, signatures[i], 64);
+        sha512_update(&hash, public_keys[i], 32);
+        sha512_update(&hash, messages[i], message_lens[i]);
+    }
+    sha512_final(&hash, seed);
+
+    memset(s_sum, 0, sizeof(s_sum));
+    for (i = 0; i < count; ++i) {
+        unsigned char idx[4];
+
+        idx[0] = (unsigned char) i;
+        idx[1] = (unsigned char) (i >> 8);
+        idx[2] = (unsigned char) (i >> 16);
+        idx[3] = (unsigned char) (i >> 24);
+        sha512_init(&hash);
+        sha512_update(&hash, seed, 64);
+        sha512_update(&hash, idx, 4);
+        sha512_final(&hash, h);
+        memset(z, 0, sizeof(z));
+        memcpy(z, h, 16);
+        z[0] |= 1;    /* never zero */
+
+        /* h_i = H(R || A || M) */
+        sha512_init(&hash);
+        sha512_update(&hash, signatures[i], 32);
+        sha512_update(&hash, public_keys[i], 32);
+        sha512_update(&hash, messages[i], message_lens[i]);
+        sha512_final(&hash, h);
+        sc_reduce(h);
+
+        sc_muladd(zh, z, h, zero);
+        sc_muladd(s_sum, z, signatures[i] + 32, s_sum);
+
+        /* points are decompressed negated, ie. these add -z_i R_i and -(z_i h_i) A_i */
+        if (ge_frombytes_negate_vartime(&P, signatures[i]) != 0) {
+            return 0;
+        }
+        prepare_point(&points[1 + 2 * i], &P, z);
+
+        if (ge_frombytes_negate_vartime(&P, public_keys[i]) != 0) {
+            return 0;
+        }
+        prepare_point(&points[2 + 2 * i], &P, zh);
+    }
+
+    /* (sum z_i s_i) B == (l - sum z_i s_i) (-B) */
+    ge_frombytes_negate_vartime(&P, B_bytes);
+    sc_muladd(z, s_sum, L_minus_1, zero);
+    prepare_point(&points[0], &P, z);
+
+    for (j = 0; j < 1 + 2 * count; ++j) {
+        if (points[j].top > top) {
+            top = points[j].top;
+        }
+    }
+
+    ge_p2_0(&r);
+    for (bit = top; bit >= 0; --bit) {
+        ge_p2_dbl(&t, &r);
+
+        for (j = 0; j < 1 + 2 * count; ++j) {
+            signed char d = points[j].digits[bit];
+
+            if (d > 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_add(&t, &u, &points[j].multiples[d / 2]);
+            } else if (d < 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_sub(&t, &u, &points[j].multiples[(-d) / 2]);
+            }
+        }
+
+        ge_p1p1_to_p2(&r, &t);
+    }
+
+    return is_identity(&r);
+}
+
+size_t ed25519_verify_batch_scratch_size(void) {
+    return sizeof(batch_point) * (1 + 2 * ED25519_BATCH_CHUNK);
+}
+
+int ed25519_verify_batch(const unsigned char * const *signatures, const unsigned char * const *messages, const size_t *message_lens,
+                         const unsigned char * const *public_keys, size_t count, void *scratch) {
+    batch_point *points = (batch_point *) scratch;
+    size_t done = 0;
+    int ok = 1;
+
+    if (count == 0) {
+        return 1;
+    }
+
+    if (points == NULL) {
+        points = (batch_point *) malloc(ed25519_verify_batch_scratch_size());
+        if (points == NULL) {
+            return 0;
+        }
+    }
+
+    while (ok && done < count) {
+        size_t n = count - done;
+
+        if (n > ED25519_BATCH_CHUNK) {
+            n = ED25519_BATCH_CHUNK;
+        }
+        ok = verify_chunk(points, signatures + done, messages + done, message_lens + done, public_keys + done, n);
+        done += n;
+    }
+
+    if (points != scratch) {
+        free(points);
+    }
+    return ok;
+}
@@ -0,0 +1,51 @@
+#include "AirtimeBudget.h"
+#include <string.h>
+
+namespace mesh {
+
+void AirtimeBudget::reset(uint32_t now) {
+  memset(_buckets, 0, sizeof(_buckets));
+  _total = 0;
+  _curr = 0;
+  _curr_start = now;
+}
+
+void AirtimeBudget::advance(uint32_t now) {
+  uint32_t elapsed = now - _curr_start;
+  if (elapsed < AIRTIME_BUCKET_MILLIS) return;
+
+  if (elapsed >= AIRTIME_WINDOW_MILLIS) {   // whole window has expired
+    reset(now - (elapsed % AIRTIME_BUCKET_MILLIS));
+    return;
+  }
+  while (elapsed >= AIRTIME_BUCKET_MILLIS) {
+    _curr = (_curr + 1) % AIRTIME_WINDOW_BUCKETS;   // oldest bucket becomes the new current one
+    _total -= _buckets[_curr];
+    _buckets[_curr] = 0;
+    _curr_start += AIRTIME_BUCKET_MILLIS;
+    elapsed -= AIRTIME_BUCKET_MILLIS;
+  }
+}
+
+void AirtimeBudget::add(uint32_t now, uint32_t airtime) {
+  advance(now);
+  _buckets[_curr] += airtime;
+  _total += airtime;
+}
+
+uint32_t AirtimeBudget::getUsed(uint32_t now) {
+  advance(now);
+  return _total;
+}
+
+uint32_t AirtimeBudget::getUsedInBucket(uint32_t now) {
+  advance(now);
+  return _buckets[_curr];
+}
+
+uint32_t AirtimeBudget::getMillisToNextExpiry(uint32_t now) {
+  advance(now);
+  return AIRTIME_BUCKET_MILLIS - (now - _curr_start);
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef AIRTIME_WINDOW_BUCKETS
+  #define AIRTIME_WINDOW_BUCKETS    60         // 60 x 1 minute = 1 hour sliding window
+#endif
+#ifndef AIRTIME_BUCKET_MILLIS
+  #define AIRTIME_BUCKET_MILLIS     60000
+#endif
+
+#define AIRTIME_WINDOW_MILLIS   ((uint32_t)AIRTIME_WINDOW_BUCKETS * AIRTIME_BUCKET_MILLIS)
+
+namespace mesh {
+
+/**
+ * \brief  Transmitted airtime over a sliding window (eg. last hour), kept in fixed size buckets (eg. per minute),
+ *         for duty cycle limits.  Resolution is one bucket: airtime 'expires' a bucket at a time.
+*/
+class AirtimeBudget {
+  uint32_t _buckets[AIRTIME_WINDOW_BUCKETS];   // airtime millis, per bucket
+  uint32_t _curr_start;    // millis when current bucket started
+  uint32_t _total;         // sum of _buckets
+  int _curr;
+
+  void advance(uint32_t now);
+
+public:
+  AirtimeBudget() { reset(0); }
+
+  void reset(uint32_t now);
+
+  /**
+   * \brief  records 'airtime' millis of TX, ending at 'now'
+  */
+  void add(uint32_t now, uint32_t airtime);
+
+  /**
+   * \returns  TX millis within the window
+  */
+  uint32_t getUsed(uint32_t now);
+
+  /**
+   * \returns  TX millis in the current (latest) bucket
+  */
+  uint32_t getUsedInBucket(uint32_t now);
+
+  /**
+   * \returns  millis until the oldest bucket drops out of the window (freeing its airtime)
+  */
+  uint32_t getMillisToNextExpiry(uint32_t now);
+};
+
+}
@@ -1,4 +1,5 @@
 #include "Dispatcher.h"
+#include "LoopProfiler.h"
 
 #if MESH_PACKET_LOGGING
   #include <Arduino.h>
@@ -14,10 +15,23 @@ namespace mesh {
   #define NOISE_FLOOR_CALIB_INTERVAL   2000     // 2 seconds
 #endif
 
+static uint8_t wire_buf[MAX_TRANS_UNIT+1];   // shared by RX and TX, for Radio's without their own buffer
+
+const uint8_t* Radio::recvRawInPlace(int& len) {
+  len = recvRaw(wire_buf, MAX_TRANS_UNIT);
+  return len > 0 ? wire_buf : NULL;
+}
+
+uint8_t* Radio::getSendBuffer() {
+  return wire_buf;
+}
+
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
   _err_flags = 0;
+  resetPipelineStats();
+  airtime_budget.reset(_ms->getMillis());
   radio_nonrx_start = _ms->getMillis();
 
   _radio->begin();
@@ -32,6 +46,15 @@ int Dispatcher::calcRxDelay(float score, uint32_t air_time) const {
   return (int) ((pow(10, 0.85f - score) - 1.0) * air_time);
 }
 
+uint32_t Dispatcher::getDutyCycleRemaining() {
+  float limit = getDutyCycleLimit();
+  if (limit <= 0) return 0xFFFFFFFF;
+
+  uint32_t budget = AIRTIME_WINDOW_MILLIS * limit;
+  uint32_t used = airtime_budget.getUsed(_ms->getMillis());
+  return used < budget ? budget - used : 0;
+}
+
 uint32_t Dispatcher::getCADFailRetryDelay() const {
   return 200;
 }
@@ -39,6 +62,15 @@ uint32_t Dispatcher::getCADFailMaxDuration() const {
   return 4000;   // 4 seconds
 }
 
+void Dispatcher::resetPipelineStats() {
+  memset(n_recv_by_type, 0, sizeof(n_recv_by_type));
+  memset(n_sent_by_type, 0, sizeof(n_sent_by_type));
+  memset(n_dropped, 0, sizeof(n_dropped));
+  memset(&queue_stats, 0, sizeof(queue_stats));
+  tx_due = false;
+  n_duty_deferrals = 0;
+}
+
 void Dispatcher::loop() {
   if (millisHasNowPassed(next_floor_calib_time)) {
     _radio->triggerNoiseFloorCalibrate(getInterferenceThreshold());
@@ -62,6 +94,7 @@ void Dispatcher::loop() {
     if (_radio->isSendComplete()) {
       long t = _ms->getMillis() - outbound_start;
       total_air_time += t;  // keep track of how much air time we are using
+      airtime_budget.add(_ms->getMillis(), t);
       //Serial.print("  airtime="); Serial.println(t);
 
       // will need radio silence up to next_tx_time
@@ -74,14 +107,17 @@ void Dispatcher::loop() {
       } else {
         n_sent_direct++;
       }
+      n_sent_by_type[outbound->getPayloadType()]++;
       releasePacket(outbound);  // return to pool
       outbound = NULL;
     } else if (millisHasNowPassed(outbound_expiry)) {
       MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): WARNING: outbound packed send timed out!", getLogDateTime());
+      airtime_budget.add(_ms->getMillis(), _ms->getMillis() - outbound_start);   // (assume it was on air)
 
       _radio->onSendFinished();
       logTxFail(outbound, 2 + outbound->path_len + outbound->payload_len);
 
+      countDrop(DROP_TX_TIMEOUT);
       releasePacket(outbound);  // return to pool
       outbound = NULL;
     } else {
@@ -109,18 +145,20 @@ void Dispatcher::loop() {
 }
 
 void Dispatcher::checkRecv() {
+  LOOP_PROFILE_SCOPE(PROF_CHECK_RECV);
   Packet* pkt;
   float score;
   uint32_t air_time;
   {
-    uint8_t raw[MAX_TRANS_UNIT+1];
-    int len = _radio->recvRaw(raw, MAX_TRANS_UNIT);
-    if (len > 0) {
+    int len;
+    const uint8_t* raw = _radio->recvRawInPlace(len);   // (no stack copy)
+    if (raw && len > 0) {
       logRxRaw(_radio->getLastSNR(), _radio->getLastRSSI(), raw, len);
 
       pkt = _mgr->allocNew();
       if (pkt == NULL) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): WARNING: received data, no unused packets available!", getLogDateTime());
+        countDrop(DROP_POOL_FULL);
       } else {
         int i = 0;
 #ifdef NODE_ID
@@ -143,6 +181,7 @@ void Dispatcher::checkRecv() {
 
         if (pkt->path_len > MAX_PATH_SIZE || i + pkt->path_len > len) {
           MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): partial or corrupt packet received, len=%d", getLogDateTime(), len);
+          countDrop(DROP_CORRUPT);
           _mgr->free(pkt);  // put back into pool
           pkt = NULL;
         } else {
@@ -151,10 +190,12 @@ void Dispatcher::checkRecv() {
           pkt->payload_len = len - i;  // payload is remainder
           if (pkt->payload_len > sizeof(pkt->payload)) {
             MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): packet payload too big, payload_len=%d", getLogDateTime(), (uint32_t)pkt->payload_len);
+            countDrop(DROP_CORRUPT);
             _mgr->free(pkt);  // put back into pool
             pkt = NULL;  
           } else {
             memcpy(pkt->payload, &raw[i], pkt->payload_len);
+            pkt->invalidateHash();   // (pkt is recycled)
 
             pkt->_snr = _radio->getLastSNR() * 4.0f;
             score = _radio->packetScore(_radio->getLastSNR(), len);
@@ -174,10 +215,8 @@ void Dispatcher::checkRecv() {
             pkt->getRawLength(), pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
             (int)pkt->getSNR(), (int)_radio->getLastRSSI(), (int)(score*1000), air_time);
 
-    static uint8_t packet_hash[MAX_HASH_SIZE];
-    pkt->calculatePacketHash(packet_hash);
     Serial.print(" hash=");
-    mesh::Utils::printHex(Serial, packet_hash, MAX_HASH_SIZE);
+    mesh::Utils::printHex(Serial, pkt->getPacketHash(), MAX_HASH_SIZE);
 
     if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ
         || pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
@@ -187,6 +226,7 @@ void Dispatcher::checkRecv() {
     }
     #endif
     logRx(pkt, pkt->getRawLength(), score);   // hook for custom logging
+    n_recv_by_type[pkt->getPayloadType()]++;
 
     if (pkt->isRouteFlood()) {
       n_recv_flood++;
@@ -210,22 +250,56 @@ void Dispatcher::checkRecv() {
 }
 
 void Dispatcher::processRecvPacket(Packet* pkt) {
-  DispatcherAction action = onRecvPacket(pkt);
-  if (action == ACTION_RELEASE) {
+  DispatcherAction action;
+  {
+    LOOP_PROFILE_SCOPE(PROF_RECV_PAYLOAD + pkt->getPayloadType());
+    action = onRecvPacket(pkt);
+  }
+  if (action == ACTION_MANUAL_HOLD) {
+    // sub-class is wanting to manually hold Packet instance, and call releasePacket() (or completeRecvPacket()) at appropriate time
+    _mgr->onPacketHeld(pkt);
+  } else {
+    completeRecvPacket(pkt, action);
+  }
+}
+
+void Dispatcher::completeRecvPacket(Packet* pkt, DispatcherAction action) {
+  if (action == ACTION_RELEASE || action == ACTION_MANUAL_HOLD) {
     _mgr->free(pkt);
-  } else if (action == ACTION_MANUAL_HOLD) {
-    // sub-class is wanting to manually hold Packet instance, and call releasePacket() at appropriate time
   } else {   // ACTION_RETRANSMIT*
     uint8_t priority = (action >> 24) - 1;
     uint32_t _delay = action & 0xFFFFFF;
 
-    _mgr->queueOutbound(pkt, priority, futureMillis(_delay));
+    queueOutbound(pkt, priority, _delay);
   }
 }
 
+void Dispatcher::queueOutbound(Packet* pkt, uint8_t priority, uint32_t delay_millis) {
+  _mgr->queueOutbound(pkt, priority, futureMillis(delay_millis));
+
+  int depth = _mgr->getOutboundTotal();
+  if (depth > queue_stats.max_depth) queue_stats.max_depth = depth;
+}
+
 void Dispatcher::checkSend() {
-  if (_mgr->getOutboundCount(_ms->getMillis()) == 0) return;  // nothing waiting to send
+  LOOP_PROFILE_SCOPE(PROF_CHECK_SEND);
+  if (_mgr->getOutboundCount(_ms->getMillis()) == 0) {  // nothing waiting to send
+    tx_due = false;
+    return;
+  }
+  if (!tx_due) {
+    tx_due = true;
+    tx_due_since = _ms->getMillis();
+  }
   if (!millisHasNowPassed(next_tx_time)) return;   // still in 'radio silence' phase (from airtime budget setting)
+
+  uint32_t duty_remaining = getDutyCycleRemaining();
+  if (duty_remaining != 0xFFFFFFFF && duty_remaining < _radio->getEstAirtimeFor(MAX_TRANS_UNIT)) {   // duty cycle budget used up, wait for some to expire
+    MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): duty cycle budget used, deferring", getLogDateTime());
+    n_duty_deferrals++;
+    next_tx_time = futureMillis(airtime_budget.getMillisToNextExpiry(_ms->getMillis()));
+    return;
+  }
   if (_radio->isReceiving()) {   // LBT - check if radio is currently mid-receive, or if channel activity
     if (cad_busy_start == 0) {
       cad_busy_start = _ms->getMillis();   // record when CAD busy state started
@@ -245,9 +319,18 @@ void Dispatcher::checkSend() {
   cad_busy_start = 0;  // reset busy state
 
   outbound = _mgr->getNextOutbound(_ms->getMillis());
+  if (outbound && outbound->isRouteFlood() && outbound->path_len > 0 && duty_remaining != 0xFFFFFFFF
+      && duty_remaining < AIRTIME_WINDOW_MILLIS * getDutyCycleLimit() * DUTY_CYCLE_FLOOD_RESERVE) {
+    // a flood retransmit (not from this node), and budget is into the reserve for direct and our own packets
+    MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): duty cycle budget low, dropping flood retransmit", getLogDateTime());
+    countDrop(DROP_DUTY_CYCLE);
+    _mgr->free(outbound);
+    outbound = NULL;
+    return;
+  }
   if (outbound) {
     int len = 0;
-    uint8_t raw[MAX_TRANS_UNIT];
+    uint8_t* raw = _radio->getSendBuffer();   // serialise straight into radio's buffer
 
 #ifdef NODE_ID
     raw[len++] = NODE_ID;
@@ -262,6 +345,7 @@ void Dispatcher::checkSend() {
 
     if (len + outbound->payload_len > MAX_TRANS_UNIT) {
       MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): FATAL: Invalid packet queued... too long, len=%d", getLogDateTime(), len + outbound->payload_len);
+      countDrop(DROP_TX_INVALID);
       _mgr->free(outbound);
       outbound = NULL;
     } else {
@@ -275,12 +359,19 @@ void Dispatcher::checkSend() {
 
         logTxFail(outbound, outbound->getRawLength());
   
+        countDrop(DROP_TX_START_FAIL);
         releasePacket(outbound);  // return to pool
         outbound = NULL;
         return;
       }
       outbound_expiry = futureMillis(max_airtime);
 
+      uint32_t wait = outbound_start - tx_due_since;
+      queue_stats.num_waits++;
+      queue_stats.total_wait += wait;
+      if (wait > queue_stats.max_wait) queue_stats.max_wait = wait;
+      tx_due = false;   // next due Packet waits (at least) until this one is sent
+
     #if MESH_PACKET_LOGGING
       Serial.print(getLogDateTime());
       Serial.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", 
@@ -300,9 +391,11 @@ Packet* Dispatcher::obtainNewPacket() {
   auto pkt = _mgr->allocNew();  // TODO: zero out all fields
   if (pkt == NULL) {
     _err_flags |= ERR_EVENT_FULL;
+    countDrop(DROP_POOL_FULL);
   } else {
     pkt->payload_len = pkt->path_len = 0;
     pkt->_snr = 0;
+    pkt->invalidateHash();
   }
   return pkt;
 }
@@ -314,9 +407,10 @@ void Dispatcher::releasePacket(Packet* packet) {
 void Dispatcher::sendPacket(Packet* packet, uint8_t priority, uint32_t delay_millis) {
   if (packet->path_len > MAX_PATH_SIZE || packet->payload_len > MAX_PACKET_PAYLOAD) {
     MESH_DEBUG_PRINTLN("%s Dispatcher::sendPacket(): ERROR: invalid packet... path_len=%d, payload_len=%d", getLogDateTime(), (uint32_t) packet->path_len, (uint32_t) packet->payload_len);
+    countDrop(DROP_TX_INVALID);
     _mgr->free(packet);
   } else {
-    _mgr->queueOutbound(packet, priority, futureMillis(delay_millis));
+    queueOutbound(packet, priority, delay_millis);
   }
 }
 
@@ -3,6 +3,7 @@
 #include <MeshCore.h>
 #include <Identity.h>
 #include <Packet.h>
+#include <AirtimeBudget.h>
 #include <Utils.h>
 #include <string.h>
 
@@ -31,6 +32,22 @@ public:
   */
   virtual int recvRaw(uint8_t* bytes, int sz) = 0;
 
+  /**
+   * \brief  polls for incoming raw packet, without an intermediate copy.
+   *        Default impl calls recvRaw() into a shared static wire buffer. Drivers which already hold
+   *        the frame in memory should override this, to return a pointer to it.
+   * \param  len  (OUT) length of packet received (0 if none)
+   * \returns NULL if no incoming data, otherwise the raw packet. (only valid until next call to
+   *          recvRawInPlace() or getSendBuffer())
+  */
+  virtual const uint8_t* recvRawInPlace(int& len);
+
+  /**
+   * \returns  a buffer of MAX_TRANS_UNIT bytes to serialise the next outbound packet into, before
+   *          passing it to startSendRaw(). Default impl returns the shared static wire buffer.
+  */
+  virtual uint8_t* getSendBuffer();
+
   /**
    * \returns  estimated transmit air-time needed for packet of 'len_bytes', in milliseconds.
   */
@@ -78,6 +95,23 @@ public:
   virtual float getLastSNR() const { return 0; }
 };
 
+#define PACKET_OWNER_FREE       0   // in the pool
+#define PACKET_OWNER_APP        1   // allocated, being processed or transmitted
+#define PACKET_OWNER_OUTBOUND   2   // in the outbound queue
+#define PACKET_OWNER_INBOUND    3   // in the delayed inbound queue
+#define PACKET_OWNER_HELD       4   // held by sub-class (ACTION_MANUAL_HOLD), until releasePacket()
+#define PACKET_OWNER_COUNT      5
+
+struct PacketPoolStats {
+  uint16_t size;
+  uint16_t in_use;
+  uint16_t high_water;      // max in_use since boot
+  uint32_t alloc_failures;
+  uint32_t bad_frees;       // double frees, or Packets not from this pool
+  uint32_t poison_faults;   // free Packets modified after free() (only checked if PACKET_POOL_POISON)
+  uint16_t by_owner[PACKET_OWNER_COUNT];   // current count of Packets, per PACKET_OWNER_*
+};
+
 /**
  * \brief  An abstraction for managing instances of Packets (eg. in a static pool),
  *        and for managing the outbound packet queue.
@@ -89,12 +123,23 @@ public:
 
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
-  virtual int getOutboundCount(uint32_t now) const = 0;
+  virtual int getOutboundCount(uint32_t now) const = 0;   // due by 'now'
+  virtual int getOutboundTotal() const = 0;               // due or not
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
   virtual Packet* removeOutboundByIdx(int i) = 0;
   virtual void queueInbound(Packet* packet, uint32_t scheduled_for) = 0;
   virtual Packet* getNextInbound(uint32_t now) = 0;
+
+  /**
+   * \brief  called when sub-class has returned ACTION_MANUAL_HOLD for this Packet
+  */
+  virtual void onPacketHeld(Packet* packet) { }
+
+  /**
+   * \returns  false if this manager doesn't keep pool stats
+  */
+  virtual bool getPoolStats(PacketPoolStats& dest) const { return false; }
 };
 
 typedef uint32_t  DispatcherAction;
@@ -108,6 +153,35 @@ typedef uint32_t  DispatcherAction;
 #define ERR_EVENT_CAD_TIMEOUT       (1 << 1)
 #define ERR_EVENT_STARTRX_TIMEOUT   (1 << 2)
 
+// reasons a Packet was dropped, or not acted on (see Dispatcher::getNumDropped())
+#define DROP_POOL_FULL         0   // no free Packet, for a received frame (or a new outbound)
+#define DROP_CORRUPT           1   // bad path_len, or payload too long
+#define DROP_BAD_VERSION       2   // unsupported payload version
+#define DROP_DUPLICATE         3   // hasSeen()
+#define DROP_FLOOD_FILTER      4   // filterRecvFloodPacket()
+#define DROP_NOT_NEXT_HOP      5   // direct packet, but not for us (or forwarding not allowed)
+#define DROP_INCOMPLETE        6   // payload too short for its type
+#define DROP_NO_MAC_MATCH      7   // addressed to us, but no peer/channel MAC matched
+#define DROP_BAD_SIGNATURE     8   // advert signature invalid
+#define DROP_SELF_ADVERT       9   // our own advert, heard back
+#define DROP_UNKNOWN_TYPE     10
+#define DROP_TX_INVALID       11   // invalid packet given to sendPacket(), or too long for radio
+#define DROP_TX_START_FAIL    12   // radio rejected startSendRaw()
+#define DROP_TX_TIMEOUT       13   // send didn't complete in time
+#define DROP_DUTY_CYCLE       14   // flood retransmit, while duty cycle budget is low
+#define DROP_NUM_REASONS      15
+
+#ifndef DUTY_CYCLE_FLOOD_RESERVE
+  #define DUTY_CYCLE_FLOOD_RESERVE   0.25f   // fraction of duty cycle budget that flood retransmits can't use
+#endif
+
+struct QueueStats {
+  uint16_t max_depth;       // most Packets in outbound queue at once
+  uint32_t num_waits;       // outbound Packets sent after a wait
+  uint32_t total_wait;      // millis, summed
+  uint32_t max_wait;        // millis. Wait is from due (scheduled) time until TX starts, ie. LBT and airtime budget delays
+};
+
 /**
  * \brief  The low-level task that manages detecting incoming Packets, and the queueing
  *      and scheduling of outbound Packets.
@@ -122,8 +196,17 @@ class Dispatcher {
   bool  prev_isrecv_mode;
   uint32_t n_sent_flood, n_sent_direct;
   uint32_t n_recv_flood, n_recv_direct;
+  uint32_t n_recv_by_type[16], n_sent_by_type[16];   // per PAYLOAD_TYPE_*
+  uint32_t n_dropped[DROP_NUM_REASONS];
+  QueueStats queue_stats;
+  unsigned long tx_due_since;   // when an outbound Packet became due (if tx_due)
+  bool tx_due;
+  AirtimeBudget airtime_budget;
+  uint32_t n_duty_deferrals;
 
   void processRecvPacket(Packet* pkt);
+  void queueOutbound(Packet* pkt, uint8_t priority, uint32_t delay_millis);
+  void resetPipelineStats();
 
 protected:
   PacketManager* _mgr;
@@ -142,10 +225,13 @@ protected:
     _err_flags = 0;
     radio_nonrx_start = 0;
     prev_isrecv_mode = true;
+    resetPipelineStats();
   }
 
   virtual DispatcherAction onRecvPacket(Packet* pkt) = 0;
 
+  void countDrop(int reason) { n_dropped[reason]++; }
+
   virtual void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) { }   // custom hook
 
   virtual void logRx(Packet* packet, int len, float score) { }   // hooks for custom logging
@@ -154,6 +240,12 @@ protected:
   virtual const char* getLogDateTime() { return ""; }
 
   virtual float getAirtimeBudgetFactor() const;
+
+  /**
+   * \returns  max fraction of time to transmit, over the AIRTIME_WINDOW_MILLIS sliding window (eg. 0.1 for 10%), or zero for no limit.
+   *         When the budget runs low, flood retransmits are dropped first, then all sending is deferred until budget frees up.
+  */
+  virtual float getDutyCycleLimit() const { return 0; }    // disabled by default
   virtual int calcRxDelay(float score, uint32_t air_time) const;
   virtual uint32_t getCADFailRetryDelay() const;
   virtual uint32_t getCADFailMaxDuration() const;
@@ -166,6 +258,13 @@ public:
 
   Packet* obtainNewPacket();
   void releasePacket(Packet* packet);
+
+  /**
+   * \brief  finish with a received Packet that onRecvPacket() returned ACTION_MANUAL_HOLD for, as if 'action' had been
+   *         returned then. (ACTION_RELEASE, or ACTION_RETRANSMIT*)
+  */
+  void completeRecvPacket(Packet* packet, DispatcherAction action);
+
   void sendPacket(Packet* packet, uint8_t priority, uint32_t delay_millis=0);
 
   unsigned long getTotalAirTime() const { return total_air_time; }  // in milliseconds
@@ -174,9 +273,30 @@ public:
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
+  uint32_t getNumRecvByType(uint8_t payload_type) const { return n_recv_by_type[payload_type & 0x0F]; }
+  uint32_t getNumSentByType(uint8_t payload_type) const { return n_sent_by_type[payload_type & 0x0F]; }
+
+  /**
+   * \returns  number of Packets dropped for 'reason' (one of DROP_*)
+  */
+  uint32_t getNumDropped(int reason) const { return n_dropped[reason]; }
+  const QueueStats& getQueueStats() const { return queue_stats; }
+
+  /**
+   * \returns  TX millis used in the duty cycle window (last hour, by default)
+  */
+  uint32_t getDutyCycleUsed() { return airtime_budget.getUsed(_ms->getMillis()); }
+
+  /**
+   * \returns  TX millis left in the duty cycle budget, or 0xFFFFFFFF if there is no limit
+  */
+  uint32_t getDutyCycleRemaining();
+  uint32_t getNumDutyCycleDeferrals() const { return n_duty_deferrals; }
+
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
     _err_flags = 0;
+    resetPipelineStats();
   }
 
   // helper methods
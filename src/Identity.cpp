@@ -23,6 +23,23 @@ bool Identity::verify(const uint8_t* sig, const uint8_t* message, int msg_len) c
 #endif
 }
 
+bool Identity::verifyBatch(const uint8_t* const* sigs, const uint8_t* const* pub_keys, const uint8_t* const* messages,
+                           const int* msg_lens, int count, void* scratch) {
+  size_t lens[ED25519_BATCH_CHUNK];
+  for (int i = 0; i < count; i += ED25519_BATCH_CHUNK) {
+    int n = count - i;
+    if (n > ED25519_BATCH_CHUNK) n = ED25519_BATCH_CHUNK;
+    for (int j = 0; j < n; j++) lens[j] = msg_lens[i + j];
+
+    if (!ed25519_verify_batch(&sigs[i], &messages[i], lens, &pub_keys[i], n, scratch)) return false;
+  }
+  return true;
+}
+
+size_t Identity::getBatchScratchSize() {
+  return ed25519_verify_batch_scratch_size();
+}
+
 bool Identity::readFrom(Stream& s) {
   return (s.readBytes(pub_key, PUB_KEY_SIZE) == PUB_KEY_SIZE);
 }
@@ -36,6 +36,15 @@ public:
   */
   bool verify(const uint8_t* sig, const uint8_t* message, int msg_len) const;
 
+  /**
+   * \brief  Verifies 'count' signatures in one pass (cheaper per signature than verify() for larger counts, about 1.5x at 16+ on host).
+   * \param  scratch  getBatchScratchSize() bytes, reused between calls, or NULL to allocate on each call
+   * \returns true, only if ALL of them are valid. Otherwise caller needs to verify() them individually.
+  */
+  static bool verifyBatch(const uint8_t* const* sigs, const uint8_t* const* pub_keys, const uint8_t* const* messages,
+                          const int* msg_lens, int count, void* scratch = NULL);
+  static size_t getBatchScratchSize();
+
   bool matches(const Identity& other) const { return memcmp(pub_key, other.pub_key, PUB_KEY_SIZE) == 0; }
   bool matches(const uint8_t* other_pubkey) const { return memcmp(pub_key, other_pubkey, PUB_KEY_SIZE) == 0; }
 
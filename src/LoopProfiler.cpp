@@ -0,0 +1,69 @@
+#include "LoopProfiler.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ESP32)
+  #include <esp_timer.h>
+#else
+  #include <Arduino.h>
+#endif
+
+namespace mesh {
+
+#if LOOP_PROFILER_ENABLED
+LoopSectionStats LoopProfiler::_stats[PROF_NUM_SECTIONS];
+#endif
+
+uint32_t LoopProfiler::micros() {
+#if defined(ESP32)
+  return (uint32_t) esp_timer_get_time();
+#else
+  return ::micros();
+#endif
+}
+
+void LoopProfiler::record(int section, uint32_t elapsed_us) {
+#if LOOP_PROFILER_ENABLED
+  if (section < 0 || section >= PROF_NUM_SECTIONS) return;
+
+  LoopSectionStats& s = _stats[section];
+  s.count++;
+  s.total_us += elapsed_us;
+  if (elapsed_us > s.max_us) s.max_us = elapsed_us;
+
+  int b = 0;
+  if (elapsed_us >= PROF_FIRST_BUCKET_US) {
+    b = (31 - __builtin_clz(elapsed_us)) - 5;   // 64us..127us -> bucket 1
+    if (b >= PROF_NUM_BUCKETS) b = PROF_NUM_BUCKETS - 1;
+  }
+  if (s.buckets[b] < 0xFFFF) s.buckets[b]++;
+#endif
+}
+
+const LoopSectionStats* LoopProfiler::getStats(int section) {
+#if LOOP_PROFILER_ENABLED
+  if (section >= 0 && section < PROF_NUM_SECTIONS) return &_stats[section];
+#endif
+  return NULL;
+}
+
+const char* LoopProfiler::getSectionName(int section, char* buf) {
+  static const char* names[] = { "loop", "mesh", "recv", "send", "sensors", "ui", "render", "store" };
+
+  if (section >= 0 && section < PROF_RECV_PAYLOAD) return names[section];
+  sprintf(buf, "rx:%02X", section - PROF_RECV_PAYLOAD);
+  return buf;
+}
+
+uint32_t LoopProfiler::getBucketLimit(int bucket) {
+  if (bucket >= PROF_NUM_BUCKETS - 1) return 0;
+  return ((uint32_t)PROF_FIRST_BUCKET_US) << bucket;
+}
+
+void LoopProfiler::reset() {
+#if LOOP_PROFILER_ENABLED
+  memset(_stats, 0, sizeof(_stats));
+#endif
+}
+
+}
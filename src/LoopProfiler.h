@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef LOOP_PROFILER_ENABLED
+  #define LOOP_PROFILER_ENABLED   0    // compiled out by default, LOOP_PROFILE_SCOPE() expands to nothing
+#endif
+
+// profiled sections
+#define PROF_LOOP_TOTAL       0    // whole of main loop()
+#define PROF_MESH_LOOP        1    // the_mesh.loop()
+#define PROF_CHECK_RECV       2    // Dispatcher::checkRecv()
+#define PROF_CHECK_SEND       3    // Dispatcher::checkSend()
+#define PROF_SENSORS          4    // sensor polling
+#define PROF_UI_LOOP          5    // UITask::loop()
+#define PROF_UI_RENDER        6    // UI frame render (within UITask::loop)
+#define PROF_STORE_SAVE       7    // DataStore saves (flash writes)
+#define PROF_RECV_PAYLOAD     8    // onRecvPacket(), plus PAYLOAD_TYPE_* (16 sections)
+#define PROF_NUM_SECTIONS     (PROF_RECV_PAYLOAD + 16)
+
+#define PROF_NUM_BUCKETS      12   // log2 buckets: < 64us, < 128us, ... < 64ms, >= 64ms
+#define PROF_FIRST_BUCKET_US  64
+
+namespace mesh {
+
+struct LoopSectionStats {
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint16_t buckets[PROF_NUM_BUCKETS];   // saturating counts
+};
+
+/**
+ * \brief  Latency histograms for the sections of the main loop. All calls must be made from the main loop task.
+ *         Sections nest, eg. time in PROF_CHECK_RECV is also counted in PROF_MESH_LOOP and PROF_LOOP_TOTAL.
+*/
+class LoopProfiler {
+  static LoopSectionStats _stats[PROF_NUM_SECTIONS];
+
+public:
+  static bool isEnabled() { return LOOP_PROFILER_ENABLED != 0; }
+
+  /**
+   * \returns  current time, in micro-seconds (wraps)
+  */
+  static uint32_t micros();
+
+  static void record(int section, uint32_t elapsed_us);
+
+  /**
+   * \returns  the stats for 'section', or NULL if profiler is compiled out
+  */
+  static const LoopSectionStats* getStats(int section);
+
+  /**
+   * \returns  short name of section, eg. "recv", or "rx:04" for PROF_RECV_PAYLOAD+4
+  */
+  static const char* getSectionName(int section, char* buf);
+
+  /**
+   * \returns  upper bound (exclusive) of the given histogram bucket, in micro-seconds. (0 for the last, open ended, bucket)
+  */
+  static uint32_t getBucketLimit(int bucket);
+
+  static void reset();
+};
+
+class LoopProfileScope {
+  int _section;
+  uint32_t _start;
+public:
+  LoopProfileScope(int section) : _section(section), _start(LoopProfiler::micros()) { }
+  ~LoopProfileScope() { LoopProfiler::record(_section, LoopProfiler::micros() - _start); }
+};
+
+}
+
+#if LOOP_PROFILER_ENABLED
+  #define LOOP_PROFILE_CONCAT2(a, b)    a##b
+  #define LOOP_PROFILE_CONCAT(a, b)     LOOP_PROFILE_CONCAT2(a, b)
+  #define LOOP_PROFILE_SCOPE(section)   mesh::LoopProfileScope LOOP_PROFILE_CONCAT(_loop_prof_, __LINE__)(section)
+#else
+  #define LOOP_PROFILE_SCOPE(section)
+#endif
@@ -1,5 +1,6 @@
 #include "Mesh.h"
 //#include <Arduino.h>
+#include <stdlib.h>
 
 namespace mesh {
 
@@ -9,6 +10,81 @@ void Mesh::begin() {
 
 void Mesh::loop() {
   Dispatcher::loop();
+
+  if (_crypto) {
+    CryptoJob job;
+    while (_crypto->poll(job)) {
+      onCryptoJobDone(job);
+    }
+  }
+#if ADVERT_BATCH_VERIFY_SIZE > 0
+  if (_advert_batch_count >= ADVERT_BATCH_VERIFY_SIZE
+      || (_advert_batch_count > 0 && millisHasNowPassed(_advert_batch_since + ADVERT_BATCH_MAX_WAIT))) {
+    flushAdvertBatch();   // full, or don't hold a partial batch for too long
+  }
+#endif
+}
+
+void Mesh::flushAdvertBatch() {
+#if ADVERT_BATCH_VERIFY_SIZE > 0
+  int n = _advert_batch_count;
+  _advert_batch_count = 0;   // (onCryptoJobDone() could cause more adverts to be received, eg. via loop-back)
+
+  if (_advert_batch_scratch == NULL) {
+    _advert_batch_scratch = malloc(Identity::getBatchScratchSize());   // NULL is ok, verifyBatch() then allocates per call
+  }
+  CryptoWorker::executeBatch(_advert_batch, n, _advert_batch_scratch);
+  for (int i = 0; i < n; i++) {
+    onCryptoJobDone(_advert_batch[i]);
+  }
+#endif
+}
+
+void CryptoWorker::execute(CryptoJob& job) {
+  if (job.type == CRYPTO_JOB_VERIFY_ADVERT) {
+    Identity id(job.pub_key);
+    job.result = id.verify(job.signature, job.message, job.msg_len);
+  } else {
+    job.result = false;
+  }
+}
+
+void CryptoWorker::executeBatch(CryptoJob* jobs, int count, void* scratch) {
+#if ADVERT_BATCH_VERIFY_SIZE > 0
+  if (count > 1 && count <= ADVERT_BATCH_VERIFY_SIZE) {
+    const uint8_t* sigs[ADVERT_BATCH_VERIFY_SIZE];
+    const uint8_t* keys[ADVERT_BATCH_VERIFY_SIZE];
+    const uint8_t* msgs[ADVERT_BATCH_VERIFY_SIZE];
+    int lens[ADVERT_BATCH_VERIFY_SIZE];
+    for (int i = 0; i < count; i++) {
+      sigs[i] = jobs[i].signature;
+      keys[i] = jobs[i].pub_key;
+      msgs[i] = jobs[i].message;
+      lens[i] = jobs[i].msg_len;
+    }
+    if (Identity::verifyBatch(sigs, keys, msgs, lens, count, scratch)) {
+      for (int i = 0; i < count; i++) jobs[i].result = true;
+      return;
+    }
+  }
+#endif
+  for (int i = 0; i < count; i++) {   // find the bad one(s)
+    execute(jobs[i]);
+  }
+}
+
+void Mesh::onCryptoJobDone(CryptoJob& job) {
+  if (job.type == CRYPTO_JOB_VERIFY_ADVERT) {
+    DispatcherAction action = ACTION_RELEASE;
+    if (job.result) {
+      rememberVerifiedAdvert(job.digest);
+      action = onVerifiedAdvert(job.packet, job.message, job.msg_len);
+    } else {
+      MESH_DEBUG_PRINTLN("%s Mesh::onCryptoJobDone(): received advertisement with forged signature!", getLogDateTime());
+      countDrop(DROP_BAD_SIGNATURE);
+    }
+    completeRecvPacket(job.packet, action);   // Packet was held while verifying
+  }
 }
 
 bool Mesh::allowPacketForward(const mesh::Packet* packet) { 
@@ -38,9 +114,83 @@ int Mesh::searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int
   return 0;  // not found
 }
 
+void Mesh::recordTrialMatch(int num_checked, bool matched) {
+  _trial_stats.packets++;
+  _trial_stats.mac_checks += num_checked;
+  if (!matched) _trial_stats.unmatched++;
+  if (num_checked > _trial_stats.max_per_packet) _trial_stats.max_per_packet = num_checked;
+}
+
+int Mesh::findPeerByMAC(const uint8_t* hash, uint8_t* secret, const uint8_t* macAndData, int len) {
+  int num = searchPeersByHash(hash);
+  for (int j = 0; j < num; j++) {
+    getPeerSharedSecret(secret, j);
+    if (Utils::verifyMAC(secret, macAndData, len)) {
+      recordTrialMatch(j + 1, true);
+      return j;
+    }
+  }
+  recordTrialMatch(num, false);
+  return -1;  // not found
+}
+
+bool Mesh::findChannelByMAC(const uint8_t* hash, GroupChannel& channel, const uint8_t* macAndData, int len) {
+  GroupChannel channels[4];   // (max 4 matches supported ATM)
+  int num = searchChannelsByHash(hash, channels, 4);
+  for (int j = 0; j < num; j++) {
+    if (Utils::verifyMAC(channels[j].secret, macAndData, len)) {
+      recordTrialMatch(j + 1, true);
+      channel = channels[j];
+      return true;
+    }
+  }
+  recordTrialMatch(num, false);
+  return false;  // not found
+}
+
+bool Mesh::isAdvertVerified(const uint8_t* digest) {
+#if ADVERT_VERIFY_CACHE_SIZE > 0
+  _verified_counter++;
+  for (int i = 0; i < ADVERT_VERIFY_CACHE_SIZE; i++) {
+    VerifiedAdvert* v = &_verified_adverts[i];
+    if (v->last_used != 0 && memcmp(v->digest, digest, ADVERT_DIGEST_SIZE) == 0) {
+      _advert_verify_hits++;
+      v->last_used = _verified_counter;
+      return true;
+    }
+  }
+#endif
+  _advert_verify_misses++;
+  return false;
+}
+
+void Mesh::rememberVerifiedAdvert(const uint8_t* digest) {
+#if ADVERT_VERIFY_CACHE_SIZE > 0
+  VerifiedAdvert* lru = &_verified_adverts[0];
+  for (int i = 1; i < ADVERT_VERIFY_CACHE_SIZE; i++) {
+    if (_verified_adverts[i].last_used < lru->last_used) lru = &_verified_adverts[i];   // (unused entries have last_used = 0)
+  }
+  memcpy(lru->digest, digest, ADVERT_DIGEST_SIZE);
+  lru->last_used = ++_verified_counter;
+#endif
+}
+
+DispatcherAction Mesh::onVerifiedAdvert(Packet* pkt, const uint8_t* message, int msg_len) {
+  Identity id(message);
+  uint32_t timestamp;
+  memcpy(&timestamp, &message[PUB_KEY_SIZE], 4);
+  int app_data_len = msg_len - PUB_KEY_SIZE - 4;
+  uint8_t* app_data = &pkt->payload[PUB_KEY_SIZE + 4 + SIGNATURE_SIZE];
+
+  MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): valid advertisement received!", getLogDateTime());
+  onAdvertRecv(pkt, id, timestamp, app_data, app_data_len);
+  return routeRecvPacket(pkt);
+}
+
 DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
   if (pkt->getPayloadVer() > PAYLOAD_VER_1) {  // not supported in this firmware version
     MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): unsupported packet version", getLogDateTime());
+    countDrop(DROP_BAD_VERSION);
     return ACTION_RELEASE;
   }
 
@@ -95,11 +245,17 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         uint32_t d = getDirectRetransmitDelay(pkt);
         return ACTION_RETRANSMIT_DELAYED(0, d);  // Routed traffic is HIGHEST priority 
       }
+      countDrop(DROP_DUPLICATE);
+    } else {
+      countDrop(DROP_NOT_NEXT_HOP);
     }
     return ACTION_RELEASE;   // this node is NOT the next hop (OR this packet has already been forwarded), so discard.
   }
 
-  if (pkt->isRouteFlood() && filterRecvFloodPacket(pkt)) return ACTION_RELEASE;
+  if (pkt->isRouteFlood() && filterRecvFloodPacket(pkt)) {
+    countDrop(DROP_FLOOD_FILTER);
+    return ACTION_RELEASE;
+  }
 
   DispatcherAction action = ACTION_RELEASE;
 
@@ -110,9 +266,12 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       memcpy(&ack_crc, &pkt->payload[i], 4); i += 4;
       if (i > pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete ACK packet", getLogDateTime());
+        countDrop(DROP_INCOMPLETE);
       } else if (!_tables->hasSeen(pkt)) {
         onAckRecv(pkt, ack_crc);
         action = routeRecvPacket(pkt);
+      } else {
+        countDrop(DROP_DUPLICATE);
       }
       break;
     }
@@ -127,52 +286,50 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
       if (i + CIPHER_MAC_SIZE >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
+        countDrop(DROP_INCOMPLETE);
       } else if (!_tables->hasSeen(pkt)) {
         // NOTE: this is a 'first packet wins' impl. When receiving from multiple paths, the first to arrive wins.
         //       For flood mode, the path may not be the 'best' in terms of hops.
         // FUTURE: could send back multiple paths, using createPathReturn(), and let sender choose which to use(?)
 
         if (self_id.isHashMatch(&dest_hash)) {
-          // scan contacts DB, for all matching hashes of 'src_hash' (max 4 matches supported ATM)
-          int num = searchPeersByHash(&src_hash);
-          // for each matching contact, try to decrypt data
+          // scan contacts DB, for all matching hashes of 'src_hash', checking just the MAC of each
+          uint8_t secret[PUB_KEY_SIZE];
+          int j = findPeerByMAC(&src_hash, secret, macAndData, pkt->payload_len - i);
           bool found = false;
-          for (int j = 0; j < num; j++) {
-            uint8_t secret[PUB_KEY_SIZE];
-            getPeerSharedSecret(secret, j);
-
-            // decrypt, checking MAC is valid
+          if (j >= 0) {
+            // MAC is valid, so decrypt
             uint8_t data[MAX_PACKET_PAYLOAD];
-            int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
-            if (len > 0) {  // success!
-              if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
-                int k = 0;
-                uint8_t path_len = data[k++];
-                uint8_t* path = &data[k]; k += path_len;
-                uint8_t extra_type = data[k++] & 0x0F;   // upper 4 bits reserved for future use
-                uint8_t* extra = &data[k];
-                uint8_t extra_len = len - k;   // remainder of packet (may be padded with zeroes!)
-                if (onPeerPathRecv(pkt, j, secret, path, path_len, extra_type, extra, extra_len)) {
-                  if (pkt->isRouteFlood()) {
-                    // send a reciprocal return path to sender, but send DIRECTLY!
-                    mesh::Packet* rpath = createPathReturn(&src_hash, secret, pkt->path, pkt->path_len, 0, NULL, 0);
-                    if (rpath) sendDirect(rpath, path, path_len, 500);
-                  }
+            int len = Utils::decrypt(secret, data, &macAndData[CIPHER_MAC_SIZE], pkt->payload_len - i - CIPHER_MAC_SIZE);
+            if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
+              int k = 0;
+              uint8_t path_len = data[k++];
+              uint8_t* path = &data[k]; k += path_len;
+              uint8_t extra_type = data[k++] & 0x0F;   // upper 4 bits reserved for future use
+              uint8_t* extra = &data[k];
+              uint8_t extra_len = len - k;   // remainder of packet (may be padded with zeroes!)
+              if (onPeerPathRecv(pkt, j, secret, path, path_len, extra_type, extra, extra_len)) {
+                if (pkt->isRouteFlood()) {
+                  // send a reciprocal return path to sender, but send DIRECTLY!
+                  mesh::Packet* rpath = createPathReturn(&src_hash, secret, pkt->path, pkt->path_len, 0, NULL, 0);
+                  if (rpath) sendDirect(rpath, path, path_len, 500);
                 }
-              } else {
-                onPeerDataRecv(pkt, pkt->getPayloadType(), j, secret, data, len);
               }
-              found = true;
-              break;
+            } else {
+              onPeerDataRecv(pkt, pkt->getPayloadType(), j, secret, data, len);
             }
+            found = true;
           }
           if (found) {
             pkt->markDoNotRetransmit();  // packet was for this node, so don't retransmit
           } else {
             MESH_DEBUG_PRINTLN("%s recv matches no peers, src_hash=%02X", getLogDateTime(), (uint32_t)src_hash);
+            countDrop(DROP_NO_MAC_MATCH);
           }
         }
         action = routeRecvPacket(pkt);
+      } else {
+        countDrop(DROP_DUPLICATE);
       }
       break;
     }
@@ -184,6 +341,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
       if (i + 2 >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
+        countDrop(DROP_INCOMPLETE);
       } else if (!_tables->hasSeen(pkt)) {
         if (self_id.isHashMatch(&dest_hash)) {
           Identity sender(sender_pub_key);
@@ -197,9 +355,13 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           if (len > 0) {  // success!
             onAnonDataRecv(pkt, secret, sender, data, len);
             pkt->markDoNotRetransmit();
+          } else {
+            countDrop(DROP_NO_MAC_MATCH);
           }
         }
         action = routeRecvPacket(pkt);
+      } else {
+        countDrop(DROP_DUPLICATE);
       }
       break;
     }
@@ -211,21 +373,21 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
       if (i + 2 >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
+        countDrop(DROP_INCOMPLETE);
       } else if (!_tables->hasSeen(pkt)) {
-        // scan channels DB, for all matching hashes of 'channel_hash' (max 4 matches supported ATM)
-        GroupChannel channels[4];
-        int num = searchChannelsByHash(&channel_hash, channels, 4);
-        // for each matching channel, try to decrypt data
-        for (int j = 0; j < num; j++) {
-          // decrypt, checking MAC is valid
+        // scan channels DB, for all matching hashes of 'channel_hash', checking just the MAC of each
+        GroupChannel channel;
+        if (findChannelByMAC(&channel_hash, channel, macAndData, pkt->payload_len - i)) {
+          // MAC is valid, so decrypt
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
-          if (len > 0) {  // success!
-            onGroupDataRecv(pkt, pkt->getPayloadType(), channels[j], data, len);
-            break;
-          }
+          int len = Utils::decrypt(channel.secret, data, &macAndData[CIPHER_MAC_SIZE], pkt->payload_len - i - CIPHER_MAC_SIZE);
+          onGroupDataRecv(pkt, pkt->getPayloadType(), channel, data, len);
+        } else {
+          countDrop(DROP_NO_MAC_MATCH);   // (eg. a channel we don't have, still forwarded)
         }
         action = routeRecvPacket(pkt);
+      } else {
+        countDrop(DROP_DUPLICATE);
       }
       break;
     }
@@ -240,31 +402,66 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
       if (i > pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete advertisement packet", getLogDateTime());
+        countDrop(DROP_INCOMPLETE);
       } else if (self_id.matches(id.pub_key)) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): receiving SELF advert packet", getLogDateTime());
+        countDrop(DROP_SELF_ADVERT);
       } else if (!_tables->hasSeen(pkt)) {
         uint8_t* app_data = &pkt->payload[i];
         int app_data_len = pkt->payload_len - i;
         if (app_data_len > MAX_ADVERT_DATA_SIZE) { app_data_len = MAX_ADVERT_DATA_SIZE; }
 
         // check that signature is valid
-        bool is_ok;
-        {
-          uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
-          int msg_len = 0;
-          memcpy(&message[msg_len], id.pub_key, PUB_KEY_SIZE); msg_len += PUB_KEY_SIZE;
-          memcpy(&message[msg_len], &timestamp, 4); msg_len += 4;
-          memcpy(&message[msg_len], app_data, app_data_len); msg_len += app_data_len;
-
-          is_ok = id.verify(signature, message, msg_len);
-        }
-        if (is_ok) {
-          MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): valid advertisement received!", getLogDateTime());
-          onAdvertRecv(pkt, id, timestamp, app_data, app_data_len);
-          action = routeRecvPacket(pkt);
+        uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
+        int msg_len = 0;
+        memcpy(&message[msg_len], id.pub_key, PUB_KEY_SIZE); msg_len += PUB_KEY_SIZE;
+        memcpy(&message[msg_len], &timestamp, 4); msg_len += 4;
+        memcpy(&message[msg_len], app_data, app_data_len); msg_len += app_data_len;
+
+        uint8_t digest[ADVERT_DIGEST_SIZE];
+        Utils::sha256(digest, ADVERT_DIGEST_SIZE, message, msg_len, signature, SIGNATURE_SIZE);   // cache key: pub_key, timestamp, app_data, signature
+
+        if (isAdvertVerified(digest)) {   // same signed advert seen before, eg. a retransmit, or a repeat via any path
+          action = onVerifiedAdvert(pkt, message, msg_len);
         } else {
-          MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): received advertisement with forged signature! (app_data_len=%d)", getLogDateTime(), app_data_len);
+          bool queued = false;
+          if (_crypto) {   // hand to worker, and hold Packet until done
+            CryptoJob job;
+            job.type = CRYPTO_JOB_VERIFY_ADVERT;
+            job.packet = pkt;
+            memcpy(job.pub_key, id.pub_key, PUB_KEY_SIZE);
+            memcpy(job.signature, signature, SIGNATURE_SIZE);
+            memcpy(job.message, message, msg_len);
+            job.msg_len = msg_len;
+            memcpy(job.digest, digest, ADVERT_DIGEST_SIZE);
+            queued = _crypto->submit(job);
+          }
+#if ADVERT_BATCH_VERIFY_SIZE > 0
+          else if (_advert_batch_count < ADVERT_BATCH_VERIFY_SIZE) {   // queue for batch verify, and hold Packet until done
+            CryptoJob* job = &_advert_batch[_advert_batch_count];
+            job->type = CRYPTO_JOB_VERIFY_ADVERT;
+            job->packet = pkt;
+            memcpy(job->pub_key, id.pub_key, PUB_KEY_SIZE);
+            memcpy(job->signature, signature, SIGNATURE_SIZE);
+            memcpy(job->message, message, msg_len);
+            job->msg_len = msg_len;
+            memcpy(job->digest, digest, ADVERT_DIGEST_SIZE);
+            if (_advert_batch_count++ == 0) _advert_batch_since = _ms->getMillis();
+            queued = true;   // verified in loop()
+          }
+#endif
+          if (queued) {
+            action = ACTION_MANUAL_HOLD;   // resumed in onCryptoJobDone()
+          } else if (id.verify(signature, message, msg_len)) {
+            rememberVerifiedAdvert(digest);
+            action = onVerifiedAdvert(pkt, message, msg_len);
+          } else {
+            MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): received advertisement with forged signature! (app_data_len=%d)", getLogDateTime(), app_data_len);
+            countDrop(DROP_BAD_SIGNATURE);
+          }
         }
+      } else {
+        countDrop(DROP_DUPLICATE);
       }
       break;
     }
@@ -303,6 +500,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
     default:
       MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): unknown payload type, header: %d", getLogDateTime(), (int) pkt->header);
+      countDrop(DROP_UNKNOWN_TYPE);
       // Don't flood route unknown packet types!   action = routeRecvPacket(pkt);
       break;
   }
@@ -2,6 +2,18 @@
 
 #include <Dispatcher.h>
 
+#ifndef ADVERT_VERIFY_CACHE_SIZE
+  #define ADVERT_VERIFY_CACHE_SIZE   32   // number of recently verified adverts to remember (0 to disable)
+#endif
+#define ADVERT_DIGEST_SIZE   16
+
+#ifndef ADVERT_BATCH_VERIFY_SIZE
+  #define ADVERT_BATCH_VERIFY_SIZE   0    // > 0 to queue up to N adverts, and verify their signatures in one batch
+#endif
+#ifndef ADVERT_BATCH_MAX_WAIT
+  #define ADVERT_BATCH_MAX_WAIT    200    // millis, before a partial batch is verified anyway
+#endif
+
 namespace mesh {
 
 class GroupChannel {
@@ -10,6 +22,63 @@ public:
   uint8_t secret[PUB_KEY_SIZE];
 };
 
+/**
+ * \brief  cost of matching received datagrams to a peer/channel, by trial MAC checks
+*/
+struct TrialMatchStats {
+  uint32_t packets;          // datagrams which needed trial matching
+  uint32_t mac_checks;       // total candidates checked
+  uint32_t unmatched;        // datagrams which matched none of the candidates
+  uint16_t max_per_packet;   // most candidates checked for one datagram
+};
+
+#define CRYPTO_JOB_VERIFY_ADVERT   1   // Ed25519 verify of an advert's signature
+
+/**
+ * \brief  a unit of work for a CryptoWorker. Copied in to, and back out of, the worker's queues.
+*/
+struct CryptoJob {
+  uint8_t type;            // one of CRYPTO_JOB_*
+  bool result;             // VERIFY_ADVERT: signature is valid
+  Packet* packet;          // VERIFY_ADVERT: the Packet, held until the job completes
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t signature[SIGNATURE_SIZE];
+  uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];   // VERIFY_ADVERT: the signed message
+  uint16_t msg_len;
+  uint8_t digest[ADVERT_DIGEST_SIZE];   // VERIFY_ADVERT: for the verified adverts cache
+};
+
+/**
+ * \brief  Runs the slow crypto operations (Ed25519 advert verify) off the main loop, eg. on another core or thread.
+ *         Jobs are submitted from, and completions polled by, the main loop only.
+ *         NOTE: ECDH is not a job. Shared secrets are calculated lazily, when a packet being handled needs one right
+ *         away, and are persisted, so it's once per peer rather than once per advert.
+*/
+class CryptoWorker {
+public:
+  /**
+   * \returns  false if the job queue is full (caller should then do the work synchronously)
+  */
+  virtual bool submit(const CryptoJob& job) = 0;
+
+  /**
+   * \brief  fetch the next completed job, if any
+  */
+  virtual bool poll(CryptoJob& job) = 0;
+
+  /**
+   * \brief  performs the job, for implementations to call (on the worker's thread)
+  */
+  static void execute(CryptoJob& job);
+
+  /**
+   * \brief  performs 'count' VERIFY_ADVERT jobs with one batch verify, falling back to verifying individually
+   *         if any of them fail
+   * \param  scratch  Identity::getBatchScratchSize() bytes, allocated once by caller (NULL to allocate per call)
+  */
+  static void executeBatch(CryptoJob* jobs, int count, void* scratch = NULL);
+};
+
 /**
  * An abstraction of the data tables needed to be maintained
 */
@@ -32,6 +101,30 @@ class Mesh : public Dispatcher {
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
   DispatcherAction forwardMultipartDirect(Packet* pkt);
+  void recordTrialMatch(int num_checked, bool matched);
+  bool isAdvertVerified(const uint8_t* digest);
+  void rememberVerifiedAdvert(const uint8_t* digest);
+  DispatcherAction onVerifiedAdvert(Packet* pkt, const uint8_t* message, int msg_len);
+  void flushAdvertBatch();
+
+  CryptoWorker* _crypto;
+
+  TrialMatchStats _trial_stats;
+#if ADVERT_VERIFY_CACHE_SIZE > 0
+  struct VerifiedAdvert {
+    uint8_t digest[ADVERT_DIGEST_SIZE];   // of signed message + signature
+    uint32_t last_used;
+  };
+  VerifiedAdvert _verified_adverts[ADVERT_VERIFY_CACHE_SIZE];
+  uint32_t _verified_counter;
+#endif
+  uint32_t _advert_verify_hits, _advert_verify_misses;
+#if ADVERT_BATCH_VERIFY_SIZE > 0
+  CryptoJob _advert_batch[ADVERT_BATCH_VERIFY_SIZE];   // Packets held, awaiting verify
+  int _advert_batch_count;
+  unsigned long _advert_batch_since;
+  void* _advert_batch_scratch;   // for Identity::verifyBatch(), allocated on first use and kept (~30KB)
+#endif
 
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
@@ -151,6 +244,20 @@ protected:
    */
   virtual int searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int max_matches);
 
+  /**
+   * \brief  searchPeersByHash(), then checks just the MAC against each candidate's secret, until one is valid.
+   * \param  secret  OUT - the matching peer's shared secret
+   * \returns  index of matching peer (as per getPeerSharedSecret()), or -1 if none
+   */
+  int findPeerByMAC(const uint8_t* hash, uint8_t* secret, const uint8_t* macAndData, int len);
+
+  /**
+   * \brief  searchChannelsByHash(), then checks just the MAC against each candidate's secret, until one is valid.
+   * \param  channel  OUT - the matching channel
+   * \returns  true if a matching channel was found
+   */
+  bool findChannelByMAC(const uint8_t* hash, GroupChannel& channel, const uint8_t* macAndData, int len);
+
   /**
    * \brief  An encrypted group data packet has been received.
    *         NOTE: the same payload can be received multiple times, via different routes
@@ -165,9 +272,26 @@ protected:
   */
   virtual void onAckRecv(Packet* packet, uint32_t ack_crc) { }
 
+  /**
+   * \brief  A job submitted to the CryptoWorker has completed. (called from loop())
+   *         Sub-classes handling their own job types should pass the others on to this.
+  */
+  virtual void onCryptoJobDone(CryptoJob& job);
+
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
     : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
   {
+    memset(&_trial_stats, 0, sizeof(_trial_stats));
+    _crypto = NULL;
+  #if ADVERT_VERIFY_CACHE_SIZE > 0
+    memset(_verified_adverts, 0, sizeof(_verified_adverts));
+    _verified_counter = 0;
+  #endif
+    _advert_verify_hits = _advert_verify_misses = 0;
+  #if ADVERT_BATCH_VERIFY_SIZE > 0
+    _advert_batch_count = 0;
+    _advert_batch_scratch = NULL;
+  #endif
   }
 
   MeshTables* getTables() const { return _tables; }
@@ -180,6 +304,19 @@ public:
 
   RNG* getRNG() const { return _rng; }
   RTCClock* getRTCClock() const { return _rtc; }
+  const TrialMatchStats& getTrialMatchStats() const { return _trial_stats; }
+
+  /**
+   * \brief  optional. If set, advert signatures are verified by the worker, with the Packet held meanwhile.
+  */
+  void setCryptoWorker(CryptoWorker* worker) { _crypto = worker; }
+  CryptoWorker* getCryptoWorker() const { return _crypto; }
+
+  /**
+   * \brief  hits are adverts whose signature was already verified (eg. the same advert retransmitted, or repeated via any path), misses needed Ed25519 verify
+  */
+  uint32_t getAdvertVerifyHits() const { return _advert_verify_hits; }
+  uint32_t getAdvertVerifyMisses() const { return _advert_verify_misses; }
 
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
   Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len);
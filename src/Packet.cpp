@@ -8,6 +8,7 @@ Packet::Packet() {
   header = 0;
   path_len = 0;
   payload_len = 0;
+  _hash_valid = false;
 }
 
 int Packet::getRawLength() const {
@@ -15,14 +16,29 @@ int Packet::getRawLength() const {
 }
 
 void Packet::calculatePacketHash(uint8_t* hash) const {
-  SHA256 sha;
+  memcpy(hash, getPacketHash(), MAX_HASH_SIZE);
+}
+
+const uint8_t* Packet::getPacketHash() const {
   uint8_t t = getPayloadType();
+  uint16_t trace_path_len = t == PAYLOAD_TYPE_TRACE ? path_len : 0;
+  if (_hash_valid && _hash_type == t && _hash_payload_len == payload_len && _hash_path_len == trace_path_len) {
+    return _hash;
+  }
+
+  SHA256 sha;
   sha.update(&t, 1);
   if (t == PAYLOAD_TYPE_TRACE) {
     sha.update(&path_len, sizeof(path_len));   // CAVEAT: TRACE packets can revisit same node on return path
   }
   sha.update(payload, payload_len);
-  sha.finalize(hash, MAX_HASH_SIZE);
+  sha.finalize(_hash, MAX_HASH_SIZE);
+
+  _hash_type = t;
+  _hash_payload_len = payload_len;
+  _hash_path_len = trace_path_len;
+  _hash_valid = true;
+  return _hash;
 }
 
 uint8_t Packet::writeTo(uint8_t dest[]) const {
@@ -39,6 +55,7 @@ uint8_t Packet::writeTo(uint8_t dest[]) const {
 }
 
 bool Packet::readFrom(const uint8_t src[], uint8_t len) {
+  invalidateHash();
   uint8_t i = 0;
   header = src[i++];
   if (hasTransportCodes()) {
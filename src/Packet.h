@@ -50,12 +50,31 @@ public:
   uint8_t payload[MAX_PACKET_PAYLOAD];
   int8_t _snr;
 
+private:
+  // cached result of getPacketHash(), and the fields it was calculated from
+  mutable uint8_t _hash[MAX_HASH_SIZE];
+  mutable uint16_t _hash_payload_len, _hash_path_len;
+  mutable uint8_t _hash_type;
+  mutable bool _hash_valid;
+
+public:
   /**
    * \brief calculate the hash of payload + type
    * \param  dest_hash   destination to store the hash (must be MAX_HASH_SIZE bytes)
    */
   void calculatePacketHash(uint8_t* dest_hash) const;
 
+  /**
+   * \returns  the hash of payload + type (MAX_HASH_SIZE bytes). Calculated on first use, then cached
+   *          until type or payload_len (or path_len, for TRACE) change, or invalidateHash() is called.
+   */
+  const uint8_t* getPacketHash() const;
+
+  /**
+   * \brief  must be called if payload[] is modified in-place (without changing its length), after hash was used
+   */
+  void invalidateHash() { _hash_valid = false; }
+
   /**
    * \returns  one of ROUTE_ values
    */
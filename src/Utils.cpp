@@ -27,12 +27,98 @@ void Utils::sha256(uint8_t *hash, size_t hash_len, const uint8_t* frag1, int fra
   sha.finalize(hash, hash_len);
 }
 
-int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+/**
+ * \brief  derived key material for a shared secret
+*/
+struct CryptoKeyState {
+  uint8_t secret[PUB_KEY_SIZE];
   AES128 aes;
+  SHA256 hmac_inner, hmac_outer;   // states after hashing the (secret ^ ipad), (secret ^ opad) blocks
+  uint32_t last_used;
+  bool valid;
+  bool aes_ready;   // AES key schedule is only expanded when first needed, not for MAC-only checks
+
+  void load(const uint8_t* shared_secret) {
+    memcpy(secret, shared_secret, PUB_KEY_SIZE);
+    aes_ready = false;
+
+    uint8_t block[64];   // NOTE: PUB_KEY_SIZE is less than SHA256 block size, so no need to hash the key
+    memset(block, 0, sizeof(block));
+    memcpy(block, shared_secret, PUB_KEY_SIZE);
+    for (int i = 0; i < (int)sizeof(block); i++) block[i] ^= 0x36;
+    hmac_inner.reset();
+    hmac_inner.update(block, sizeof(block));
+    for (int i = 0; i < (int)sizeof(block); i++) block[i] ^= (0x36 ^ 0x5C);
+    hmac_outer.reset();
+    hmac_outer.update(block, sizeof(block));
+    memset(block, 0, sizeof(block));
+    valid = true;
+  }
+
+  AES128& getAES() {
+    if (!aes_ready) {
+      aes.setKey(secret, CIPHER_KEY_SIZE);
+      aes_ready = true;
+    }
+    return aes;
+  }
+
+  void calcHMAC(uint8_t* mac, const uint8_t* data, int data_len) {
+    uint8_t inner_hash[32];
+    SHA256 sha = hmac_inner;
+    sha.update(data, data_len);
+    sha.finalize(inner_hash, sizeof(inner_hash));
+
+    sha = hmac_outer;
+    sha.update(inner_hash, sizeof(inner_hash));
+    sha.finalize(mac, CIPHER_MAC_SIZE);
+  }
+};
+
+static CryptoKeyState key_cache[CRYPTO_KEY_CACHE_SIZE];
+static CryptoKeyState key_scratch;   // when cache is disabled
+static bool key_cache_enabled = true;
+static uint32_t key_cache_counter = 0, key_cache_hits = 0, key_cache_misses = 0;
+
+static CryptoKeyState* getKeyState(const uint8_t* shared_secret) {
+  if (!key_cache_enabled) {
+    key_scratch.load(shared_secret);
+    return &key_scratch;
+  }
+
+  key_cache_counter++;
+  CryptoKeyState* lru = &key_cache[0];
+  for (int i = 0; i < CRYPTO_KEY_CACHE_SIZE; i++) {
+    CryptoKeyState* k = &key_cache[i];
+    if (k->valid && memcmp(k->secret, shared_secret, PUB_KEY_SIZE) == 0) {
+      key_cache_hits++;
+      k->last_used = key_cache_counter;
+      return k;
+    }
+    if (!k->valid || (lru->valid && k->last_used < lru->last_used)) lru = k;
+  }
+  key_cache_misses++;
+  lru->load(shared_secret);
+  lru->last_used = key_cache_counter;
+  return lru;
+}
+
+void Utils::setKeyCacheEnabled(bool enable) {
+  key_cache_enabled = enable;
+  for (int i = 0; i < CRYPTO_KEY_CACHE_SIZE; i++) {
+    key_cache[i].valid = false;
+  }
+}
+
+void Utils::getKeyCacheStats(uint32_t& hits, uint32_t& misses) {
+  hits = key_cache_hits;
+  misses = key_cache_misses;
+}
+
+static int decryptBlocks(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
   const uint8_t* sp = src;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (sp - src < src_len) {
     aes.decryptBlock(dp, sp);
     dp += 16; sp += 16;
@@ -41,11 +127,9 @@ int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return sp - src;  // will always be multiple of 16
 }
 
-int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  AES128 aes;
+static int encryptBlocks(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (src_len >= 16) {
     aes.encryptBlock(dp, src);
     dp += 16; src += 16; src_len -= 16;
@@ -60,13 +144,19 @@ int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return dp - dest;  // will always be multiple of 16
 }
 
+int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  return decryptBlocks(getKeyState(shared_secret)->getAES(), dest, src, src_len);
+}
+
+int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  return encryptBlocks(getKeyState(shared_secret)->getAES(), dest, src, src_len);
+}
+
 int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  int enc_len = encrypt(shared_secret, dest + CIPHER_MAC_SIZE, src, src_len);
+  CryptoKeyState* key = getKeyState(shared_secret);
+  int enc_len = encryptBlocks(key->getAES(), dest + CIPHER_MAC_SIZE, src, src_len);
 
-  SHA256 sha;
-  sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-  sha.update(dest + CIPHER_MAC_SIZE, enc_len);
-  sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, dest, CIPHER_MAC_SIZE);
+  key->calcHMAC(dest, dest + CIPHER_MAC_SIZE, enc_len);
 
   return CIPHER_MAC_SIZE + enc_len;
 }
@@ -74,19 +164,23 @@ int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uin
 int Utils::MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
   if (src_len <= CIPHER_MAC_SIZE) return 0;  // invalid src bytes
 
+  CryptoKeyState* key = getKeyState(shared_secret);
   uint8_t hmac[CIPHER_MAC_SIZE];
-  {
-    SHA256 sha;
-    sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-    sha.update(src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
-    sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, hmac, CIPHER_MAC_SIZE);
-  }
+  key->calcHMAC(hmac, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
   if (memcmp(hmac, src, CIPHER_MAC_SIZE) == 0) {
-    return decrypt(shared_secret, dest, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
+    return decryptBlocks(key->getAES(), dest, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
   }
   return 0; // invalid HMAC
 }
 
+bool Utils::verifyMAC(const uint8_t* shared_secret, const uint8_t* src, int src_len) {
+  if (src_len <= CIPHER_MAC_SIZE) return false;  // invalid src bytes
+
+  uint8_t hmac[CIPHER_MAC_SIZE];
+  getKeyState(shared_secret)->calcHMAC(hmac, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
+  return memcmp(hmac, src, CIPHER_MAC_SIZE) == 0;
+}
+
 static const char hex_chars[] = "0123456789ABCDEF";
 
 void Utils::toHex(char* dest, const uint8_t* src, size_t len) {
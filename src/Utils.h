@@ -4,6 +4,10 @@
 #include <Stream.h>
 #include <string.h>
 
+#ifndef CRYPTO_KEY_CACHE_SIZE
+  #define CRYPTO_KEY_CACHE_SIZE   8    // number of shared secrets to keep expanded AES keys and HMAC pad states for
+#endif
+
 namespace mesh {
 
 class RNG {
@@ -54,6 +58,21 @@ public:
   */
   static int MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len);
 
+  /**
+   * \brief  checks just the MAC (in leading bytes of 'src'), without decrypting. For cheaply rejecting the candidate
+   *         secrets when trial matching a received packet.
+   * \returns  true if MAC is valid
+  */
+  static bool verifyMAC(const uint8_t* shared_secret, const uint8_t* src, int src_len);
+
+  /**
+   * \brief  The above encrypt/decrypt/MAC methods keep the AES key schedule and HMAC pad states of the most recently
+   *         used shared secrets (CRYPTO_KEY_CACHE_SIZE), so repeated (or trial) decrypts only pay for the data blocks.
+   *         Enabled by default. Disabling recalculates them on every call.
+  */
+  static void setKeyCacheEnabled(bool enable);
+  static void getKeyCacheStats(uint32_t& hits, uint32_t& misses);
+
   /**
    * \brief  converts 'src' bytes with given length to Hex representation, and null terminates.
   */
@@ -63,14 +63,12 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
 
   ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
-      break;
+  int i = contacts_index.findByPrefix(id.pub_key, PUB_KEY_SIZE);
+  if (i >= 0) {  // is from one of our contacts
+    from = &contacts[i];
+    if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+      MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+      return;
     }
   }
 
@@ -106,15 +104,16 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
 
     is_new = true;
     if (num_contacts < MAX_CONTACTS) {
-      from = &contacts[num_contacts++];
+      from = &contacts[num_contacts];
       from->id = id;
+      contacts_store.invalidate(num_contacts);
+      contacts_index.add(num_contacts++);
       from->out_path_len = -1;  // initially out_path is unknown
       from->gps_lat = 0;   // initially unknown GPS loc
       from->gps_lon = 0;
       from->sync_since = 0;
 
-      // only need to calculate the shared_secret once, for better performance
-      self_id.calcSharedSecret(from->shared_secret, id);
+      from->shared_secret_valid = false;   // calculated on first use
     } else {
       MESH_DEBUG_PRINTLN("onAdvertRecv: contacts table is full!");
       return;
@@ -136,19 +135,51 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
 
 int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
-    }
+  int end = contacts_index.bucketEnd(hash[0]);   // NOTE: assumes PATH_HASH_SIZE is 1
+  for (int pos = contacts_index.bucketStart(hash[0]); pos < end && n < MAX_SEARCH_RESULTS; pos++) {
+    matching_peer_indexes[n++] = contacts_index.contactAt(pos);  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
   }
   return n;
 }
 
+void BaseChatMesh::calcSharedSecret(int idx) {
+  ContactInfo& c = contacts[idx];
+  self_id.calcSharedSecret(c.shared_secret, c.id);
+  c.shared_secret_valid = true;
+  contacts_store.invalidate(idx);
+  onSharedSecretCalculated(c);
+}
+
+const uint8_t* BaseChatMesh::getSharedSecret(const ContactInfo& contact) {
+  if (contact.shared_secret_valid) return contact.shared_secret;
+
+  int idx = contacts_index.findByPrefix(contact.id.pub_key, PUB_KEY_SIZE);
+  if (idx >= 0) {
+    calcSharedSecret(idx);
+    return contacts[idx].shared_secret;
+  }
+  // not in table, so just calc it for this one use
+  self_id.calcSharedSecret(temp_secret, contact.id);
+  return temp_secret;
+}
+
+bool BaseChatMesh::restoreSharedSecret(const uint8_t* pub_key, const uint8_t* secret) {
+  int idx = contacts_index.findByPrefix(pub_key, PUB_KEY_SIZE);
+  if (idx < 0 || contacts[idx].shared_secret_valid) return false;
+
+  memcpy(contacts[idx].shared_secret, secret, PUB_KEY_SIZE);
+  contacts[idx].shared_secret_valid = true;
+  contacts_store.invalidate(idx);
+  return true;
+}
+
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < num_contacts) {
-    // lookup pre-calculated shared_secret
-    memcpy(dest_secret, contacts[i].shared_secret, PUB_KEY_SIZE);
+    if (!contacts[i].shared_secret_valid) calcSharedSecret(i);   // first use
+
+    // lookup pre-calculated shared_secret (via hot cache, contacts[] may be in PSRAM)
+    memcpy(dest_secret, contacts_store.getSharedSecret(i), PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
@@ -293,7 +324,7 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
 void BaseChatMesh::handleReturnPathRetry(const ContactInfo& contact, const uint8_t* path, uint8_t path_len) {
   // NOTE: simplest impl is just to re-send a reciprocal return path to sender (DIRECTLY)
   //        override this method in various firmwares, if there's a better strategy
-  mesh::Packet* rpath = createPathReturn(contact.id, contact.shared_secret, path, path_len, 0, NULL, 0);
+  mesh::Packet* rpath = createPathReturn(contact.id, getSharedSecret(contact), path, path_len, 0, NULL, 0);
   if (rpath) sendDirect(rpath, contact.out_path, contact.out_path_len, 3000);   // 3 second delay
 }
 
@@ -342,7 +373,7 @@ mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint3
     temp[len++] = attempt;  // hide attempt number at tail end of payload
   }
 
-  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.shared_secret, temp, len);
+  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, len);
 }
 
 int  BaseChatMesh::sendMessage(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char* text, uint32_t& expected_ack, uint32_t& est_timeout) {
@@ -373,7 +404,7 @@ int  BaseChatMesh::sendCommandData(const ContactInfo& recipient, uint32_t timest
   temp[4] = (attempt & 3) | (TXT_TYPE_CLI_DATA << 2);
   memcpy(&temp[5], text, text_len + 1);
 
-  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.shared_secret, temp, 5 + text_len);
+  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, 5 + text_len);
   if (pkt == NULL) return MSG_SEND_FAILED;
 
   uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -462,7 +493,7 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
       tlen = 4 + len;
     }
 
-    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, recipient.shared_secret, temp, tlen);
+    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, getSharedSecret(recipient), temp, tlen);
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -489,7 +520,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, const uint8_t* req_
     memcpy(temp, &tag, 4);   // mostly an extra blob to help make packet_hash unique
     memcpy(&temp[4], req_data, data_len);
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.shared_secret, temp, 4 + data_len);
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, 4 + data_len);
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -516,7 +547,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, uint8_t req_type, u
     memset(&temp[5], 0, 4);  // reserved (possibly for 'since' param)
     getRNG()->random(&temp[9], 4);   // random blob to help make packet-hash unique
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.shared_secret, temp, sizeof(temp));
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, sizeof(temp));
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -639,7 +670,7 @@ void BaseChatMesh::checkConnections() {
       // calc expected ACK reply
       mesh::Utils::sha256((uint8_t *)&connections[i].expected_ack, 4, data, 9, self_id.pub_key, PUB_KEY_SIZE);
 
-      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, contact->shared_secret, data, 9);
+      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, getSharedSecret(*contact), data, 9);
       if (pkt) {
         sendDirect(pkt, contact->out_path, contact->out_path_len);
       }
@@ -691,20 +722,18 @@ ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
 }
 
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
-  for (int i = 0; i < num_contacts; i++) {
-    auto c = &contacts[i];
-    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
-  }
-  return NULL;  // not found
+  int i = contacts_index.findByPrefix(pub_key, prefix_len);
+  return i >= 0 ? &contacts[i] : NULL;  // NULL if not found
 }
 
 bool BaseChatMesh::addContact(const ContactInfo& contact) {
   if (num_contacts < MAX_CONTACTS) {
-    auto dest = &contacts[num_contacts++];
+    auto dest = &contacts[num_contacts];
     *dest = contact;
+    contacts_store.invalidate(num_contacts);
+    contacts_index.add(num_contacts++);
 
-    // calc the ECDH shared secret (just once for performance)
-    self_id.calcSharedSecret(dest->shared_secret, contact.id);
+    dest->shared_secret_valid = false;   // calculated on first use, or restoreSharedSecret()
 
     return true;  // success
   }
@@ -712,18 +741,18 @@ bool BaseChatMesh::addContact(const ContactInfo& contact) {
 }
 
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
-  }
-  if (idx >= num_contacts) return false;   // not found
+  int idx = contacts_index.findByPrefix(contact.id.pub_key, PUB_KEY_SIZE);
+  if (idx < 0) return false;   // not found
 
   // remove from contacts array
+  int removed = idx;
   num_contacts--;
   while (idx < num_contacts) {
     contacts[idx] = contacts[idx + 1];
     idx++;
   }
+  contacts_index.remove(removed);
+  contacts_store.invalidateAll();   // indexes have shifted
   return true;  // Success
 }
 
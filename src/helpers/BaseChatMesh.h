@@ -8,6 +8,8 @@
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
 #include "ContactInfo.h"
+#include "ContactIndex.h"
+#include "ContactStore.h"
 
 #define MAX_SEARCH_RESULTS   8
 
@@ -58,9 +60,11 @@ class BaseChatMesh : public mesh::Mesh {
 
   friend class ContactsIterator;
 
-  ContactInfo contacts[MAX_CONTACTS];
+  ContactStore contacts_store;   // PSRAM if available
+  ContactInfo* contacts;
   int num_contacts;
-  int sort_array[MAX_CONTACTS];
+  ContactIndex contacts_index;   // by pub_key
+  int* sort_array;
   int matching_peer_indexes[MAX_SEARCH_RESULTS];
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
@@ -69,16 +73,20 @@ class BaseChatMesh : public mesh::Mesh {
 #endif
   mesh::Packet* _pendingLoopback;
   uint8_t temp_buf[MAX_TRANS_UNIT];
+  uint8_t temp_secret[PUB_KEY_SIZE];
   ConnectionInfo connections[MAX_CONNECTIONS];
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
+  void calcSharedSecret(int idx);
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
-      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
+      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables), contacts_store(MAX_CONTACTS), contacts(contacts_store.getTable()),
+        contacts_index(contacts, MAX_CONTACTS)
   { 
     num_contacts = 0;
+    sort_array = (int *) ContactStore::allocLarge(sizeof(int) * MAX_CONTACTS);
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -88,7 +96,19 @@ protected:
     memset(connections, 0, sizeof(connections));
   }
 
-  void resetContacts() { num_contacts = 0; }
+  void resetContacts() { num_contacts = 0; contacts_index.clear(); contacts_store.invalidateAll(); }
+
+  /**
+   * \returns  the ECDH shared secret with 'contact'. Is only calculated on first use, as most contacts
+   *           (from adverts) are never messaged.
+  */
+  const uint8_t* getSharedSecret(const ContactInfo& contact);
+
+  /**
+   * \brief  sets a previously calculated (and persisted) shared secret, to save calculating it again
+   * \returns false if no such contact, or it already has its secret
+  */
+  bool restoreSharedSecret(const uint8_t* pub_key, const uint8_t* secret);
 
   // 'UI' concepts, for sub-classes to implement
   virtual bool isAutoAddEnabled() const { return true; }
@@ -106,6 +126,7 @@ protected:
   virtual uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) = 0;
   virtual void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) = 0;
   virtual void handleReturnPathRetry(const ContactInfo& contact, const uint8_t* path, uint8_t path_len);
+  virtual void onSharedSecretCalculated(const ContactInfo& contact) { }   // eg. to persist it
 
   virtual void sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis=0);
   virtual void sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis=0);
@@ -2,6 +2,7 @@
 #include "CommonCLI.h"
 #include "TxtDataHelpers.h"
 #include "AdvertDataHelpers.h"
+#include "StatsFormatHelper.h"
 #include <RTClib.h>
 
 // Believe it or not, this std C function is busted on some platforms!
@@ -688,6 +689,19 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
     } else if (sender_timestamp == 0 && memcmp(command, "log", 3) == 0) {
       _callbacks->dumpLogFile();
       strcpy(reply, "   EOF");
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-drops", 11) == 0 && (command[11] == 0 || command[11] == ' ')) {
+      _callbacks->formatDropStatsReply(reply, CLI_STATS_REPLY_MAX);
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-types", 11) == 0 && (command[11] == 0 || command[11] == ' ')) {
+      _callbacks->formatPayloadTypeStatsReply(reply, CLI_STATS_REPLY_MAX);
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-loop", 10) == 0 && (command[10] == 0 || command[10] == ' ')) {
+      if (memcmp(&command[10], " reset", 6) == 0) {
+        mesh::LoopProfiler::reset();
+        strcpy(reply, "OK - loop stats reset");
+      } else if (command[10] == ' ') {
+        StatsFormatHelper::formatLoopSectionStats(reply, _atoi(&command[11]));   // by section number, see PROF_*
+      } else {
+        StatsFormatHelper::formatLoopStats(reply, CLI_STATS_REPLY_MAX);
+      }
     } else if (sender_timestamp == 0 && memcmp(command, "stats-packets", 13) == 0 && (command[13] == 0 || command[13] == ' ')) {
       _callbacks->formatPacketStatsReply(reply);
     } else if (sender_timestamp == 0 && memcmp(command, "stats-radio", 11) == 0 && (command[11] == 0 || command[11] == ' ')) {
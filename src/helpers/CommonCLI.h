@@ -8,6 +8,10 @@
 #define WITH_BRIDGE
 #endif
 
+#ifndef CLI_STATS_REPLY_MAX
+  #define CLI_STATS_REPLY_MAX   160   // max length of stats-* replies (must fit the reply buffer)
+#endif
+
 #define ADVERT_LOC_NONE       0
 #define ADVERT_LOC_SHARE      1
 #define ADVERT_LOC_PREFS      2
@@ -71,6 +75,8 @@ public:
   virtual void formatStatsReply(char *reply) = 0;
   virtual void formatRadioStatsReply(char *reply) = 0;
   virtual void formatPacketStatsReply(char *reply) = 0;
+  virtual void formatDropStatsReply(char *reply, int max_len) = 0;          // eg. StatsFormatHelper::formatDropStats()
+  virtual void formatPayloadTypeStatsReply(char *reply, int max_len) = 0;   // eg. StatsFormatHelper::formatPayloadTypeStats()
   virtual mesh::LocalIdentity& getSelfId() = 0;
   virtual void saveIdentity(const mesh::LocalIdentity& new_id) = 0;
   virtual void clearStats() = 0;
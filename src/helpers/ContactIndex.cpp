@@ -0,0 +1,73 @@
+#include "ContactIndex.h"
+
+ContactIndex::ContactIndex(const ContactInfo* contacts, int capacity) : _contacts(contacts) {
+  _sorted = new uint16_t[capacity];
+  clear();
+}
+
+void ContactIndex::clear() {
+  _num = 0;
+  memset(_bucket_start, 0, sizeof(_bucket_start));
+}
+
+int ContactIndex::lowerBound(const uint8_t* key, int len) const {
+  int lo = _bucket_start[key[0]], hi = _bucket_start[key[0] + 1];   // binary search, within bucket
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (memcmp(_contacts[_sorted[mid]].id.pub_key, key, len) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void ContactIndex::add(int idx) {
+  const uint8_t* key = _contacts[idx].id.pub_key;
+  int pos = lowerBound(key, PUB_KEY_SIZE);
+
+  memmove(&_sorted[pos + 1], &_sorted[pos], (_num - pos) * sizeof(_sorted[0]));
+  _sorted[pos] = idx;
+  _num++;
+  for (int b = key[0] + 1; b <= 256; b++) {
+    _bucket_start[b]++;
+  }
+}
+
+void ContactIndex::remove(int idx) {
+  int pos = -1;
+  for (int i = 0; i < _num; i++) {   // table indexes shift down, so need full pass anyway
+    if (_sorted[i] == idx) {
+      pos = i;
+    } else if (_sorted[i] > idx) {
+      _sorted[i]--;
+    }
+  }
+  if (pos < 0) return;   // not indexed
+
+  uint8_t first = 0;
+  for (int b = 0; b < 256; b++) {   // find bucket of removed entry
+    if (pos >= _bucket_start[b] && pos < _bucket_start[b + 1]) {
+      first = b;
+      break;
+    }
+  }
+  _num--;
+  memmove(&_sorted[pos], &_sorted[pos + 1], (_num - pos) * sizeof(_sorted[0]));
+  for (int b = first + 1; b <= 256; b++) {
+    _bucket_start[b]--;
+  }
+}
+
+int ContactIndex::findByPrefix(const uint8_t* key, int len) const {
+  if (len <= 0) return _num > 0 ? 0 : -1;   // everything matches
+
+  int best = -1;
+  for (int pos = lowerBound(key, len); pos < _num; pos++) {   // all matches are contiguous
+    int idx = _sorted[pos];
+    if (memcmp(_contacts[idx].id.pub_key, key, len) != 0) break;
+    if (best < 0 || idx < best) best = idx;
+  }
+  return best;
+}
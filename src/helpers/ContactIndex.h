@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ContactInfo.h"
+
+/**
+ * \brief  Index over a ContactInfo table, by pub_key. Keeps the table indexes sorted by pub_key, plus
+ *         the start of each first-byte bucket within that, so lookup by 1-byte hash is O(1) and by
+ *         key (or key prefix) is O(log n). Must be told of every add/remove to the table.
+*/
+class ContactIndex {
+  const ContactInfo* _contacts;
+  uint16_t* _sorted;               // indexes into _contacts[], in pub_key order
+  uint16_t _bucket_start[257];     // position in _sorted[] of first key starting with byte N
+  int _num;
+
+  int lowerBound(const uint8_t* key, int len) const;
+
+public:
+  ContactIndex(const ContactInfo* contacts, int capacity);
+
+  void clear();
+
+  /**
+   * \brief  contacts[idx] has been appended to the table (and its pub_key set)
+  */
+  void add(int idx);
+
+  /**
+   * \brief  contacts[idx] has been removed, and all the following entries shifted down by one
+  */
+  void remove(int idx);
+
+  /**
+   * \returns  lowest index in table of contact whose pub_key starts with 'key' (len bytes), or -1 if none
+  */
+  int findByPrefix(const uint8_t* key, int len) const;
+
+  /**
+   * \brief  for iterating the contacts whose pub_key starts with 'hash_byte': for (i = bucketStart(b); i < bucketEnd(b); i++)
+  */
+  int bucketStart(uint8_t hash_byte) const { return _bucket_start[hash_byte]; }
+  int bucketEnd(uint8_t hash_byte) const { return _bucket_start[hash_byte + 1]; }
+  int contactAt(int pos) const { return _sorted[pos]; }
+
+  int count() const { return _num; }
+};
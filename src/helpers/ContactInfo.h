@@ -11,7 +11,8 @@ struct ContactInfo {
   int8_t out_path_len;
   uint8_t out_path[MAX_PATH_SIZE];
   uint32_t last_advert_timestamp;   // by THEIR clock
-  uint8_t shared_secret[PUB_KEY_SIZE];
+  uint8_t shared_secret[PUB_KEY_SIZE];   // only valid if shared_secret_valid (see BaseChatMesh::getSharedSecret())
+  bool shared_secret_valid;
   uint32_t lastmod;  // by OUR clock
   int32_t gps_lat, gps_lon;    // 6 dec places
   uint32_t sync_since;
@@ -0,0 +1,70 @@
+#include "ContactStore.h"
+#include <new>
+#include <stdlib.h>
+
+ContactStore::ContactStore(int capacity) {
+  _capacity = capacity;
+  _table = (ContactInfo *) allocLarge(sizeof(ContactInfo) * capacity, &_in_psram);
+  for (int i = 0; i < capacity; i++) {
+    new (&_table[i]) ContactInfo();
+  }
+  _use_counter = _hits = _misses = 0;
+  invalidateAll();
+
+  MESH_DEBUG_PRINTLN("ContactStore: %d contacts, %d bytes in %s", capacity, (uint32_t)(sizeof(ContactInfo) * capacity),
+                     _in_psram ? "PSRAM" : "RAM");
+}
+
+void* ContactStore::allocLarge(size_t size, bool* in_psram) {
+  void* p = NULL;
+#if defined(ESP32) && defined(BOARD_HAS_PSRAM)
+  if (psramFound()) {
+    p = ps_calloc(1, size);
+  }
+#endif
+  if (in_psram) *in_psram = (p != NULL);
+  if (p == NULL) {
+    p = calloc(1, size);
+  }
+  return p;
+}
+
+const uint8_t* ContactStore::getSharedSecret(int idx) {
+  _use_counter++;
+
+  HotEntry* lru = &_hot[0];
+  for (int i = 0; i < CONTACT_HOT_CACHE_SIZE; i++) {
+    HotEntry* e = &_hot[i];
+    if (e->idx == idx) {
+      _hits++;
+      e->last_used = _use_counter;
+      return e->secret;
+    }
+    if (e->idx < 0 || (lru->idx >= 0 && e->last_used < lru->last_used)) {
+      lru = e;   // unused, or least recently used
+    }
+  }
+
+  // miss, so load into the LRU slot
+  _misses++;
+  const ContactInfo& c = _table[idx];
+  lru->idx = idx;
+  memcpy(lru->secret, c.shared_secret, PUB_KEY_SIZE);
+  lru->last_used = _use_counter;
+  return lru->secret;
+}
+
+void ContactStore::invalidate(int idx) {
+  for (int i = 0; i < CONTACT_HOT_CACHE_SIZE; i++) {
+    if (_hot[i].idx == idx) {
+      _hot[i].idx = -1;
+      break;
+    }
+  }
+}
+
+void ContactStore::invalidateAll() {
+  for (int i = 0; i < CONTACT_HOT_CACHE_SIZE; i++) {
+    _hot[i].idx = -1;
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ContactInfo.h"
+
+#ifndef CONTACT_HOT_CACHE_SIZE
+  #define CONTACT_HOT_CACHE_SIZE   16
+#endif
+
+/**
+ * \brief  Storage for BaseChatMesh's ContactInfo records. The table is allocated from PSRAM when the board
+ *         has it (BOARD_HAS_PSRAM), so MAX_CONTACTS can go well beyond what fits in internal RAM. A small LRU
+ *         cache in internal RAM holds the shared secrets of recently used contacts, so the per-packet
+ *         decrypt attempts don't need to touch PSRAM.
+ *         Records don't move when cached/evicted, so ContactInfo pointers stay valid as before.
+*/
+class ContactStore {
+  struct HotEntry {
+    int idx;         // index in table, or -1 if unused (int, as capacity may exceed 32767)
+    uint8_t secret[PUB_KEY_SIZE];
+    uint32_t last_used;
+  };
+
+  ContactInfo* _table;
+  int _capacity;
+  bool _in_psram;
+  HotEntry _hot[CONTACT_HOT_CACHE_SIZE];
+  uint32_t _use_counter;
+  uint32_t _hits, _misses;
+
+public:
+  ContactStore(int capacity);
+
+  /**
+   * \brief  allocates from PSRAM if available, otherwise from heap (zero filled)
+  */
+  static void* allocLarge(size_t size, bool* in_psram=NULL);
+
+  ContactInfo* getTable() const { return _table; }
+  int getCapacity() const { return _capacity; }
+  bool isInPSRAM() const { return _in_psram; }
+
+  /**
+   * \returns  shared_secret of table[idx], via the hot cache (promoting it to most recently used)
+  */
+  const uint8_t* getSharedSecret(int idx);
+
+  /**
+   * \brief  must be called when table[idx] is replaced, or its shared_secret changes
+  */
+  void invalidate(int idx);
+
+  /**
+   * \brief  must be called when table entries are shifted, or the table is reset
+  */
+  void invalidateAll();
+
+  uint32_t getNumCacheHits() const { return _hits; }
+  uint32_t getNumCacheMisses() const { return _misses; }
+};
@@ -0,0 +1,145 @@
+#include "HashedMeshTables.h"
+
+SeenTable::SeenTable(mesh::MillisecondClock& ms, int capacity, uint32_t max_age_millis) : _ms(&ms) {
+  uint32_t num_buckets = 1;
+  while (num_buckets < (uint32_t)capacity*2) num_buckets <<= 1;   // keep load factor <= 0.5
+
+  _entries = new Entry[capacity];
+  memset(_entries, 0, sizeof(Entry)*capacity);
+  _index = new int16_t[num_buckets];
+  memset(_index, 0xFF, sizeof(int16_t)*num_buckets);   // all -1
+  _capacity = capacity;
+  _next_idx = 0;
+  _mask = num_buckets - 1;
+  _max_age = max_age_millis;
+  resetStats();
+}
+
+uint32_t SeenTable::bucketFor(const uint8_t* key) const {
+  uint32_t h;
+  memcpy(&h, key, 4);   // keys are hashes/CRCs, so just mix a little
+  h ^= h >> 16;
+  h *= 0x45d9f3b;
+  h ^= h >> 16;
+  return h & _mask;
+}
+
+int SeenTable::find(const uint8_t* key) const {
+  uint32_t b = bucketFor(key);
+  while (_index[b] >= 0) {
+    if (memcmp(_entries[_index[b]].key, key, MAX_HASH_SIZE) == 0) return b;
+    b = (b + 1) & _mask;
+  }
+  return -1;  // not found
+}
+
+void SeenTable::unindex(int bucket) {
+  // backward-shift deletion, so that probe sequences never need tombstones
+  uint32_t i = bucket, j = bucket;
+  _index[i] = -1;
+  for (;;) {
+    j = (j + 1) & _mask;
+    if (_index[j] < 0) break;
+
+    uint32_t home = bucketFor(_entries[_index[j]].key);
+    bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);   // home is cyclically in (i, j]
+    if (!stays) {
+      _index[i] = _index[j];
+      _index[j] = -1;
+      i = j;
+    }
+  }
+}
+
+bool SeenTable::isExpired(const Entry& e, uint32_t now) const {
+  return _max_age > 0 && now - e.seen_at >= _max_age;
+}
+
+bool SeenTable::checkAndAdd(const uint8_t* key) {
+  uint32_t now = _ms->getMillis();
+
+  int b = find(key);
+  if (b >= 0) {
+    Entry& e = _entries[_index[b]];
+    if (!isExpired(e, now)) return true;
+
+    _stats.expiries++;   // too old, treat as new
+    e.used = false;
+    unindex(b);
+  }
+
+  Entry& slot = _entries[_next_idx];
+  if (slot.used) {   // replace oldest entry
+    if (isExpired(slot, now)) {
+      _stats.expiries++;
+    } else {
+      _stats.evictions++;
+    }
+    unindex(find(slot.key));
+  }
+  memcpy(slot.key, key, MAX_HASH_SIZE);
+  slot.seen_at = now;
+  slot.used = true;
+
+  b = bucketFor(key);
+  while (_index[b] >= 0) b = (b + 1) & _mask;
+  _index[b] = _next_idx;
+
+  _next_idx = (_next_idx + 1) % _capacity;   // cyclic
+  return false;
+}
+
+void SeenTable::remove(const uint8_t* key) {
+  int b = find(key);
+  if (b >= 0) {
+    _entries[_index[b]].used = false;
+    unindex(b);
+  }
+}
+
+int SeenTable::count() const {
+  int n = 0;
+  for (int i = 0; i < _capacity; i++) {
+    if (_entries[i].used) n++;
+  }
+  return n;
+}
+
+HashedMeshTables::HashedMeshTables(mesh::MillisecondClock& ms, int max_hashes, int max_acks, uint32_t max_age_millis)
+  : _hashes(ms, max_hashes, max_age_millis), _acks(ms, max_acks, max_age_millis)
+{
+  _direct_dups = _flood_dups = 0;
+}
+
+static void getTableKey(const mesh::Packet* packet, uint8_t* key) {
+  if (packet->getPayloadType() == PAYLOAD_TYPE_ACK) {
+    memset(key, 0, MAX_HASH_SIZE);
+    memcpy(key, packet->payload, 4);   // the ACK CRC
+  } else {
+    memcpy(key, packet->getPacketHash(), MAX_HASH_SIZE);   // (cached on packet)
+  }
+}
+
+bool HashedMeshTables::hasSeen(const mesh::Packet* packet) {
+  uint8_t key[MAX_HASH_SIZE];
+  getTableKey(packet, key);
+
+  SeenTable& table = packet->getPayloadType() == PAYLOAD_TYPE_ACK ? _acks : _hashes;
+  if (table.checkAndAdd(key)) {
+    if (packet->isRouteDirect()) {
+      _direct_dups++;   // keep some stats
+    } else {
+      _flood_dups++;
+    }
+    return true;
+  }
+  return false;
+}
+
+void HashedMeshTables::clear(const mesh::Packet* packet) {
+  uint8_t key[MAX_HASH_SIZE];
+  getTableKey(packet, key);
+
+  SeenTable& table = packet->getPayloadType() == PAYLOAD_TYPE_ACK ? _acks : _hashes;
+  table.remove(key);
+}
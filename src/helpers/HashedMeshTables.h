@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Mesh.h>
+
+struct SeenTableStats {
+  uint32_t evictions;   // entries pushed out by newer ones, before reaching max age (ie. table is undersized)
+  uint32_t expiries;    // entries which reached max age
+};
+
+/**
+ * \brief  Set of recently seen keys (packet hashes, or ACK CRCs). Entries are kept in a ring, in arrival order
+ *         (so when full, the oldest is replaced), with an open-addressing index (linear probing) over the ring
+ *         for O(1) lookup. An entry older than 'max_age_millis' no longer counts as seen (0 = never expires).
+*/
+class SeenTable {
+  struct Entry {
+    uint8_t key[MAX_HASH_SIZE];
+    uint32_t seen_at;
+    bool used;
+  };
+
+  mesh::MillisecondClock* _ms;
+  Entry* _entries;
+  int16_t* _index;      // entry index per bucket, or -1 if empty
+  int _capacity, _next_idx;
+  uint32_t _mask;       // num buckets - 1
+  uint32_t _max_age;
+  SeenTableStats _stats;
+
+  uint32_t bucketFor(const uint8_t* key) const;
+  int find(const uint8_t* key) const;   // returns bucket, or -1
+  void unindex(int bucket);
+  bool isExpired(const Entry& e, uint32_t now) const;
+
+public:
+  SeenTable(mesh::MillisecondClock& ms, int capacity, uint32_t max_age_millis);
+
+  /**
+   * \returns  true if key was already in table (and not expired), otherwise adds it and returns false.
+  */
+  bool checkAndAdd(const uint8_t* key);
+  void remove(const uint8_t* key);
+  int count() const;
+
+  const SeenTableStats& getStats() const { return _stats; }
+  void resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+};
+
+#ifndef HASHED_TABLES_MAX_AGE_MILLIS
+  #define HASHED_TABLES_MAX_AGE_MILLIS   (10*60*1000)
+#endif
+
+/**
+ * \brief  Alternative to SimpleMeshTables, with O(1) hasSeen(), configurable capacity and time-based expiry.
+*/
+class HashedMeshTables : public mesh::MeshTables {
+  SeenTable _hashes;
+  SeenTable _acks;
+  uint32_t _direct_dups, _flood_dups;
+
+public:
+  HashedMeshTables(mesh::MillisecondClock& ms, int max_hashes=128, int max_acks=64, uint32_t max_age_millis=HASHED_TABLES_MAX_AGE_MILLIS);
+
+  bool hasSeen(const mesh::Packet* packet) override;
+  void clear(const mesh::Packet* packet) override;
+
+  uint32_t getNumDirectDups() const { return _direct_dups; }
+  uint32_t getNumFloodDups() const { return _flood_dups; }
+  uint32_t getNumEvictions() const { return _hashes.getStats().evictions + _acks.getStats().evictions; }
+  uint32_t getNumExpiries() const { return _hashes.getStats().expiries + _acks.getStats().expiries; }
+  int getNumHashes() const { return _hashes.count(); }
+
+  void resetStats() {
+    _direct_dups = _flood_dups = 0;
+    _hashes.resetStats();
+    _acks.resetStats();
+  }
+};
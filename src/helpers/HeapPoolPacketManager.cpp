@@ -0,0 +1,170 @@
+#include "HeapPoolPacketManager.h"
+
+typedef bool (*EntryLessFn)(const TimedPacketEntry& a, const TimedPacketEntry& b);
+
+static bool earlierDue(const TimedPacketEntry& a, const TimedPacketEntry& b) {
+  int32_t diff = (int32_t)(a.scheduled_for - b.scheduled_for);   // wrap-safe
+  if (diff != 0) return diff < 0;
+  return (int32_t)(a.seq - b.seq) < 0;
+}
+
+static bool morePressing(const TimedPacketEntry& a, const TimedPacketEntry& b) {
+  if (a.priority != b.priority) return a.priority < b.priority;
+  return (int32_t)(a.seq - b.seq) < 0;
+}
+
+static void siftUp(TimedPacketEntry* heap, int i, EntryLessFn less) {
+  TimedPacketEntry e = heap[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!less(e, heap[parent])) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = e;
+}
+
+static void siftDown(TimedPacketEntry* heap, int num, int i, EntryLessFn less) {
+  TimedPacketEntry e = heap[i];
+  for (;;) {
+    int child = 2*i + 1;
+    if (child >= num) break;
+    if (child + 1 < num && less(heap[child + 1], heap[child])) child++;
+    if (!less(heap[child], e)) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = e;
+}
+
+static TimedPacketEntry removeAt(TimedPacketEntry* heap, int& num, int i, EntryLessFn less) {
+  TimedPacketEntry item = heap[i];
+  num--;
+  if (i < num) {
+    heap[i] = heap[num];   // move last into the hole, then restore heap order
+    siftDown(heap, num, i, less);
+    siftUp(heap, i, less);
+  }
+  return item;
+}
+
+TimedPacketQueue::TimedPacketQueue(int max_entries) {
+  _pending = new TimedPacketEntry[max_entries];
+  _ready = new TimedPacketEntry[max_entries];
+  _size = max_entries;
+  _num_pending = _num_ready = 0;
+  _next_seq = 0;
+}
+
+void TimedPacketQueue::promote(uint32_t now) {
+  while (_num_pending > 0 && (int32_t)(_pending[0].scheduled_for - now) <= 0) {
+    _ready[_num_ready] = removeAt(_pending, _num_pending, 0, earlierDue);
+    siftUp(_ready, _num_ready++, morePressing);
+  }
+}
+
+bool TimedPacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  if (count() == _size) {
+    MESH_DEBUG_PRINTLN("TimedPacketQueue::add(): queue is full!");
+    return false;
+  }
+  TimedPacketEntry& e = _pending[_num_pending];
+  e.packet = packet;
+  e.priority = priority;
+  e.scheduled_for = scheduled_for;
+  e.seq = _next_seq++;
+  siftUp(_pending, _num_pending++, earlierDue);
+  return true;
+}
+
+mesh::Packet* TimedPacketQueue::get(uint32_t now) {
+  promote(now);
+  if (_num_ready == 0) return NULL;   // empty, or all items are still in the future
+
+  return removeAt(_ready, _num_ready, 0, morePressing).packet;
+}
+
+// due entries still in _pending are a sub-tree at the top of the heap, so only they (and their children) are visited
+static int countDue(const TimedPacketEntry* heap, int num, int i, uint32_t now) {
+  if (i >= num || (int32_t)(heap[i].scheduled_for - now) > 0) return 0;
+  return 1 + countDue(heap, num, 2*i + 1, now) + countDue(heap, num, 2*i + 2, now);
+}
+
+int TimedPacketQueue::countBefore(uint32_t now) const {
+  return _num_ready + countDue(_pending, _num_pending, 0, now);
+}
+
+mesh::Packet* TimedPacketQueue::itemAt(int i) const {
+  if (i < _num_ready) return _ready[i].packet;
+  i -= _num_ready;
+  return i < _num_pending ? _pending[i].packet : NULL;
+}
+
+mesh::Packet* TimedPacketQueue::removeByIdx(int i) {
+  if (i < _num_ready) return removeAt(_ready, _num_ready, i, morePressing).packet;
+  i -= _num_ready;
+  if (i < _num_pending) return removeAt(_pending, _num_pending, i, earlierDue).packet;
+  return NULL;  // invalid index
+}
+
+HeapPoolPacketManager::HeapPoolPacketManager(int pool_size): pool(pool_size), send_queue(pool_size), rx_queue(pool_size) {
+}
+
+mesh::Packet* HeapPoolPacketManager::allocNew() {
+  return pool.alloc();  // returns NULL if empty
+}
+
+void HeapPoolPacketManager::free(mesh::Packet* packet) {
+  pool.free(packet);
+}
+
+void HeapPoolPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  pool.setOwner(packet, PACKET_OWNER_OUTBOUND);
+  send_queue.add(packet, priority, scheduled_for);
+}
+
+mesh::Packet* HeapPoolPacketManager::getNextOutbound(uint32_t now) {
+  auto pkt = send_queue.get(now);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
+}
+
+int HeapPoolPacketManager::getOutboundCount(uint32_t now) const {
+  return send_queue.countBefore(now);
+}
+
+int HeapPoolPacketManager::getOutboundTotal() const {
+  return send_queue.count();
+}
+
+int HeapPoolPacketManager::getFreeCount() const {
+  return pool.getFreeCount();
+}
+
+mesh::Packet* HeapPoolPacketManager::getOutboundByIdx(int i) {
+  return send_queue.itemAt(i);
+}
+mesh::Packet* HeapPoolPacketManager::removeOutboundByIdx(int i) {
+  auto pkt = send_queue.removeByIdx(i);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
+}
+
+void HeapPoolPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
+  pool.setOwner(packet, PACKET_OWNER_INBOUND);
+  rx_queue.add(packet, 0, scheduled_for);
+}
+mesh::Packet* HeapPoolPacketManager::getNextInbound(uint32_t now) {
+  auto pkt = rx_queue.get(now);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
+}
+
+void HeapPoolPacketManager::onPacketHeld(mesh::Packet* packet) {
+  pool.setOwner(packet, PACKET_OWNER_HELD);
+}
+
+bool HeapPoolPacketManager::getPoolStats(mesh::PacketPoolStats& dest) const {
+  dest = pool.getStats();
+  return true;
+}
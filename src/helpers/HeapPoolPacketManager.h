@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Dispatcher.h>
+#include "PacketPool.h"
+
+struct TimedPacketEntry {
+  mesh::Packet* packet;
+  uint32_t scheduled_for;
+  uint32_t seq;       // insertion order, to keep FIFO among equal priorities
+  uint8_t priority;
+};
+
+/**
+ * \brief  A packet queue keyed by (scheduled_for, priority). Entries wait in a min-heap ordered by
+ *         scheduled_for, and are promoted to a second min-heap ordered by (priority, seq) once they
+ *         are due. So, the "anything due?" check is O(1) when nothing is due, and add/get are O(log n).
+ *         All millis comparisons are wrap-safe (ie. survive the 49-day millis() rollover), as long as
+ *         entries are never scheduled more than ~24 days ahead.
+*/
+class TimedPacketQueue {
+  TimedPacketEntry* _pending;   // heap, by scheduled_for
+  TimedPacketEntry* _ready;     // heap, by priority then seq
+  int _size, _num_pending, _num_ready;
+  uint32_t _next_seq;
+
+  void promote(uint32_t now);
+
+public:
+  TimedPacketQueue(int max_entries);
+
+  bool add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
+  mesh::Packet* get(uint32_t now);
+  int count() const { return _num_pending + _num_ready; }
+  int countBefore(uint32_t now) const;
+
+  /**
+   * \brief  access all entries, due or not, in no particular order (indices are invalidated by add/get/remove)
+  */
+  mesh::Packet* itemAt(int i) const;
+  mesh::Packet* removeByIdx(int i);
+};
+
+/**
+ * \brief  Alternative to StaticPoolPacketManager, using TimedPacketQueue's for the outbound and delayed
+ *         inbound queues. Behaviour is the same (most important priority first, amongst packets that are due,
+ *         FIFO for equal priorities), but scales to large pools, and is safe at millis() rollover.
+*/
+class HeapPoolPacketManager : public mesh::PacketManager {
+  PacketPool pool;
+  TimedPacketQueue send_queue;
+  TimedPacketQueue rx_queue;
+
+public:
+  HeapPoolPacketManager(int pool_size);
+
+  mesh::Packet* allocNew() override;
+  void free(mesh::Packet* packet) override;
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
+  mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getOutboundCount(uint32_t now) const override;
+  int getOutboundTotal() const override;
+  int getFreeCount() const override;
+  mesh::Packet* getOutboundByIdx(int i) override;
+  mesh::Packet* removeOutboundByIdx(int i) override;
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
+  mesh::Packet* getNextInbound(uint32_t now) override;
+  void onPacketHeld(mesh::Packet* packet) override;
+  bool getPoolStats(mesh::PacketPoolStats& dest) const override;
+};
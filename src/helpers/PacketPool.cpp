@@ -0,0 +1,89 @@
+#include "PacketPool.h"
+
+PacketPool::PacketPool(int size) {
+  _packets = new mesh::Packet[size];
+  _next_free = new int16_t[size];
+  _owner = new uint8_t[size];
+  _size = size;
+
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.size = size;
+  _stats.by_owner[PACKET_OWNER_FREE] = size;
+
+  for (int i = 0; i < size; i++) {
+    _next_free[i] = i + 1 < size ? i + 1 : -1;
+    _owner[i] = PACKET_OWNER_FREE;
+#if PACKET_POOL_POISON
+    memset(&_packets[i], PACKET_POOL_POISON_BYTE, sizeof(mesh::Packet));
+#endif
+  }
+  _free_head = size > 0 ? 0 : -1;
+}
+
+int PacketPool::indexOf(const mesh::Packet* packet) const {
+  if (packet < _packets || packet >= &_packets[_size]) return -1;   // not from this pool
+
+  size_t offset = (const uint8_t *)packet - (const uint8_t *)_packets;
+  if (offset % sizeof(mesh::Packet) != 0) return -1;   // not pointing to start of a Packet
+  return offset / sizeof(mesh::Packet);
+}
+
+mesh::Packet* PacketPool::alloc() {
+  if (_free_head < 0) {
+    _stats.alloc_failures++;
+    return NULL;
+  }
+  int i = _free_head;
+  _free_head = _next_free[i];
+  _owner[i] = PACKET_OWNER_APP;
+  _stats.by_owner[PACKET_OWNER_FREE]--;
+  _stats.by_owner[PACKET_OWNER_APP]++;
+  if (++_stats.in_use > _stats.high_water) {
+    _stats.high_water = _stats.in_use;
+  }
+
+  mesh::Packet* pkt = &_packets[i];
+#if PACKET_POOL_POISON
+  const uint8_t* bytes = (const uint8_t *) pkt;
+  for (size_t j = 0; j < sizeof(mesh::Packet); j++) {
+    if (bytes[j] != PACKET_POOL_POISON_BYTE) {
+      MESH_DEBUG_PRINTLN("PacketPool::alloc(): packet #%d was modified after free()", i);
+      _stats.poison_faults++;
+      break;
+    }
+  }
+  *pkt = mesh::Packet();
+#else
+  pkt->invalidateHash();
+#endif
+  return pkt;
+}
+
+bool PacketPool::free(mesh::Packet* packet) {
+  int i = indexOf(packet);
+  if (i < 0 || _owner[i] == PACKET_OWNER_FREE) {
+    MESH_DEBUG_PRINTLN("PacketPool::free(): %s", i < 0 ? "foreign packet!" : "double free!");
+    _stats.bad_frees++;
+    return false;
+  }
+  _stats.by_owner[_owner[i]]--;
+  _stats.by_owner[PACKET_OWNER_FREE]++;
+  _stats.in_use--;
+  _owner[i] = PACKET_OWNER_FREE;
+#if PACKET_POOL_POISON
+  memset(packet, PACKET_POOL_POISON_BYTE, sizeof(mesh::Packet));
+#endif
+
+  _next_free[i] = _free_head;
+  _free_head = i;
+  return true;
+}
+
+void PacketPool::setOwner(mesh::Packet* packet, uint8_t owner) {
+  int i = indexOf(packet);
+  if (i < 0 || _owner[i] == PACKET_OWNER_FREE || owner == PACKET_OWNER_FREE) return;   // not valid
+
+  _stats.by_owner[_owner[i]]--;
+  _stats.by_owner[owner]++;
+  _owner[i] = owner;
+}
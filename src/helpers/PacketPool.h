@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Dispatcher.h>
+
+#ifndef PACKET_POOL_POISON
+  #ifdef MESH_DEBUG
+    #define PACKET_POOL_POISON  1
+  #else
+    #define PACKET_POOL_POISON  0
+  #endif
+#endif
+
+#define PACKET_POOL_POISON_BYTE   0xDB
+
+/**
+ * \brief  A fixed pool of Packets, with an index-linked free list (O(1) alloc and free). Tracks which
+ *         PACKET_OWNER_* each Packet currently belongs to, so double frees and foreign pointers are rejected
+ *         (and counted), and keeps usage counters for sizing the pool.
+ *         With PACKET_POOL_POISON (default in MESH_DEBUG builds), free Packets are filled with a poison
+ *         pattern which is verified on alloc, to catch writes after free().
+*/
+class PacketPool {
+  mesh::Packet* _packets;
+  int16_t* _next_free;
+  uint8_t* _owner;
+  int _size, _free_head;
+  mesh::PacketPoolStats _stats;
+
+  int indexOf(const mesh::Packet* packet) const;
+
+public:
+  PacketPool(int size);
+
+  mesh::Packet* alloc();
+
+  /**
+   * \returns  false if packet is not from this pool, or is already free
+  */
+  bool free(mesh::Packet* packet);
+
+  void setOwner(mesh::Packet* packet, uint8_t owner);
+
+  int getFreeCount() const { return _stats.by_owner[PACKET_OWNER_FREE]; }
+  const mesh::PacketPoolStats& getStats() const { return _stats; }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * \brief  Lock-free, fixed size ring buffer for handing items from ONE producer thread/task to ONE consumer.
+ *         Items are filled/read in place: producer calls pushSlot(), fills it, then commitPush(); consumer
+ *         calls front(), reads it, then pop().  N must be a power of two.
+*/
+template <typename T, int N>
+class SPSCRing {
+  static_assert((N & (N - 1)) == 0, "SPSCRing size must be a power of two");
+
+  T _items[N];
+  std::atomic<uint32_t> _head;   // next slot to push, only written by producer
+  std::atomic<uint32_t> _tail;   // next slot to pop, only written by consumer
+
+public:
+  SPSCRing() : _head(0), _tail(0) { }
+
+  // producer side
+  T* pushSlot() {
+    uint32_t h = _head.load(std::memory_order_relaxed);
+    if (h - _tail.load(std::memory_order_acquire) >= (uint32_t)N) return NULL;   // full
+    return &_items[h & (N - 1)];
+  }
+  void commitPush() { _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // consumer side
+  T* front() {
+    uint32_t t = _tail.load(std::memory_order_relaxed);
+    if (t == _head.load(std::memory_order_acquire)) return NULL;   // empty
+    return &_items[t & (N - 1)];
+  }
+  void pop() { _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  int count() const { return (int)(_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)); }
+};
@@ -66,48 +66,65 @@ void PacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled
   _num++;
 }
 
-StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): unused(pool_size), send_queue(pool_size), rx_queue(pool_size) {
-  // load up our unusued Packet pool
-  for (int i = 0; i < pool_size; i++) {
-    unused.add(new mesh::Packet(), 0, 0);
-  }
+StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): pool(pool_size), send_queue(pool_size), rx_queue(pool_size) {
 }
 
 mesh::Packet* StaticPoolPacketManager::allocNew() {
-  return unused.removeByIdx(0);  // just get first one (returns NULL if empty)
+  return pool.alloc();  // returns NULL if empty
 }
 
 void StaticPoolPacketManager::free(mesh::Packet* packet) {
-  unused.add(packet, 0, 0);
+  pool.free(packet);
 }
 
 void StaticPoolPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  pool.setOwner(packet, PACKET_OWNER_OUTBOUND);
   send_queue.add(packet, priority, scheduled_for);
 }
 
 mesh::Packet* StaticPoolPacketManager::getNextOutbound(uint32_t now) {
   //send_queue.sort();   // sort by scheduled_for/priority first
-  return send_queue.get(now);
+  auto pkt = send_queue.get(now);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
 }
 
 int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
   return send_queue.countBefore(now);
 }
 
+int StaticPoolPacketManager::getOutboundTotal() const {
+  return send_queue.count();
+}
+
 int StaticPoolPacketManager::getFreeCount() const {
-  return unused.count();
+  return pool.getFreeCount();
 }
 
 mesh::Packet* StaticPoolPacketManager::getOutboundByIdx(int i) {
   return send_queue.itemAt(i);
 }
 mesh::Packet* StaticPoolPacketManager::removeOutboundByIdx(int i) {
-  return send_queue.removeByIdx(i);
+  auto pkt = send_queue.removeByIdx(i);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
 }
 
 void StaticPoolPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
+  pool.setOwner(packet, PACKET_OWNER_INBOUND);
   rx_queue.add(packet, 0, scheduled_for);
 }
 mesh::Packet* StaticPoolPacketManager::getNextInbound(uint32_t now) {
-  return rx_queue.get(now);
+  auto pkt = rx_queue.get(now);
+  if (pkt) pool.setOwner(pkt, PACKET_OWNER_APP);
+  return pkt;
+}
+
+void StaticPoolPacketManager::onPacketHeld(mesh::Packet* packet) {
+  pool.setOwner(packet, PACKET_OWNER_HELD);
+}
+
+bool StaticPoolPacketManager::getPoolStats(mesh::PacketPoolStats& dest) const {
+  dest = pool.getStats();
+  return true;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Dispatcher.h>
+#include "PacketPool.h"
 
 class PacketQueue {
   mesh::Packet** _table;
@@ -19,7 +20,8 @@ public:
 };
 
 class StaticPoolPacketManager : public mesh::PacketManager {
-  PacketQueue unused, send_queue, rx_queue;
+  PacketPool pool;
+  PacketQueue send_queue, rx_queue;
 
 public:
   StaticPoolPacketManager(int pool_size);
@@ -29,9 +31,12 @@ public:
   void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
   mesh::Packet* getNextOutbound(uint32_t now) override;
   int getOutboundCount(uint32_t now) const override;
+  int getOutboundTotal() const override;
   int getFreeCount() const override;
   mesh::Packet* getOutboundByIdx(int i) override;
   mesh::Packet* removeOutboundByIdx(int i) override;
   void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
   mesh::Packet* getNextInbound(uint32_t now) override;
+  void onPacketHeld(mesh::Packet* packet) override;
+  bool getPoolStats(mesh::PacketPoolStats& dest) const override;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Mesh.h"
+#include "LoopProfiler.h"
 
 class StatsFormatHelper {
 public:
@@ -14,7 +15,7 @@ public:
       board.getBattMilliVolts(),
       ms.getMillis() / 1000,
       err_flags,
-      mgr->getOutboundCount(0xFFFFFFFF)
+      mgr->getOutboundTotal()
     );
   }
 
@@ -51,4 +52,87 @@ public:
       n_recv_direct
     );
   }
+
+  /**
+   * \brief  drop counts, indexed by DROP_*, then outbound queue depth and wait, and duty cycle budget used/left (millis, -1 = no limit).
+   *         If that won't fit 'max_len' (including the terminator), reply is {"error":"too long"} instead
+  */
+  static void formatDropStats(char* reply, int max_len, mesh::Dispatcher* dispatcher) {
+    int n = snprintf(reply, max_len, "{\"drops\":[");
+    for (int r = 0; r < DROP_NUM_REASONS && n < max_len; r++) {
+      n += snprintf(&reply[n], max_len - n, r > 0 ? ",%u" : "%u", dispatcher->getNumDropped(r));
+    }
+    if (n < max_len) {
+      const mesh::QueueStats& q = dispatcher->getQueueStats();
+      n += snprintf(&reply[n], max_len - n, "],\"q_max\":%u,\"q_wait_avg\":%u,\"q_wait_max\":%u,\"duty_used\":%u,\"duty_left\":%d}",
+        (uint32_t)q.max_depth,
+        q.num_waits ? q.total_wait / q.num_waits : 0,
+        q.max_wait,
+        dispatcher->getDutyCycleUsed(),
+        (int32_t)dispatcher->getDutyCycleRemaining()
+      );
+    }
+    if (n >= max_len) {   // truncated, don't return a partial object
+      snprintf(reply, max_len, "{\"error\":\"too long\"}");
+    }
+  }
+
+  /**
+   * \brief  RX/TX counts for each payload type seen, as "type":[rx,tx], truncated to fit 'max_len'
+  */
+  static void formatPayloadTypeStats(char* reply, int max_len, const mesh::Dispatcher* dispatcher) {
+    int n = sprintf(reply, "{");
+    for (int t = 0; t < 16; t++) {
+      uint32_t rx = dispatcher->getNumRecvByType(t);
+      uint32_t tx = dispatcher->getNumSentByType(t);
+      if (rx == 0 && tx == 0) continue;
+
+      char item[32];
+      int len = snprintf(item, sizeof(item), "%s\"%02X\":[%u,%u]", n > 1 ? "," : "", t, rx, tx);
+      if (n + len + 2 > max_len) break;   // leave room for closing brace
+      strcpy(&reply[n], item); n += len;
+    }
+    strcpy(&reply[n], "}");
+  }
+
+  /**
+   * \brief  summary of all non-empty loop profiler sections, as "name":[count,avg_us,max_us], truncated to fit 'max_len'
+  */
+  static void formatLoopStats(char* reply, int max_len) {
+    if (!mesh::LoopProfiler::isEnabled()) {
+      strcpy(reply, "{}");
+      return;
+    }
+    int n = sprintf(reply, "{");
+    char name_buf[8];
+    for (int s = 0; s < PROF_NUM_SECTIONS; s++) {
+      const mesh::LoopSectionStats* st = mesh::LoopProfiler::getStats(s);
+      if (st->count == 0) continue;
+
+      char item[48];
+      int len = snprintf(item, sizeof(item), "%s\"%s\":[%u,%u,%u]", n > 1 ? "," : "",
+          mesh::LoopProfiler::getSectionName(s, name_buf), st->count, (uint32_t)(st->total_us / st->count), st->max_us);
+      if (n + len + 2 > max_len) break;   // leave room for closing brace
+      strcpy(&reply[n], item); n += len;
+    }
+    strcpy(&reply[n], "}");
+  }
+
+  /**
+   * \brief  one loop profiler section, including its histogram (counts per bucket, see LoopProfiler::getBucketLimit())
+  */
+  static void formatLoopSectionStats(char* reply, int section) {
+    const mesh::LoopSectionStats* st = mesh::LoopProfiler::getStats(section);
+    if (st == NULL) {
+      strcpy(reply, "{}");
+      return;
+    }
+    char name_buf[8];
+    int n = sprintf(reply, "{\"%s\":[%u,%u,%u],\"hist\":[", mesh::LoopProfiler::getSectionName(section, name_buf),
+        st->count, st->count ? (uint32_t)(st->total_us / st->count) : 0, st->max_us);
+    for (int b = 0; b < PROF_NUM_BUCKETS; b++) {
+      n += sprintf(&reply[n], b > 0 ? ",%u" : "%u", (uint32_t)st->buckets[b]);
+    }
+    strcpy(&reply[n], "]}");
+  }
 };
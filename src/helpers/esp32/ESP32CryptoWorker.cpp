@@ -0,0 +1,37 @@
+#include "ESP32CryptoWorker.h"
+
+#ifdef ESP32
+
+bool ESP32CryptoWorker::begin(int core, UBaseType_t priority) {
+  _jobs = xQueueCreate(CRYPTO_WORKER_QUEUE_SIZE, sizeof(mesh::CryptoJob));
+  _done = xQueueCreate(CRYPTO_WORKER_QUEUE_SIZE, sizeof(mesh::CryptoJob));
+  if (_jobs == NULL || _done == NULL) return false;
+
+  return xTaskCreatePinnedToCore(taskLoop, "crypto", CRYPTO_WORKER_STACK_SIZE, this, priority, &_task, core) == pdPASS;
+}
+
+void ESP32CryptoWorker::taskLoop(void* arg) {
+  ESP32CryptoWorker* self = (ESP32CryptoWorker *) arg;
+  mesh::CryptoJob job;
+  for (;;) {
+    if (xQueueReceive(self->_jobs, &job, portMAX_DELAY) == pdTRUE) {
+      mesh::CryptoWorker::execute(job);
+      xQueueSend(self->_done, &job, portMAX_DELAY);   // NOTE: submit() caps in-flight jobs at QUEUE_SIZE, so _done always has room
+    }
+  }
+}
+
+bool ESP32CryptoWorker::submit(const mesh::CryptoJob& job) {
+  if (_jobs == NULL || _in_flight >= CRYPTO_WORKER_QUEUE_SIZE) return false;   // full
+  if (xQueueSend(_jobs, &job, 0) != pdTRUE) return false;
+  _in_flight++;
+  return true;
+}
+
+bool ESP32CryptoWorker::poll(mesh::CryptoJob& job) {
+  if (_done == NULL || xQueueReceive(_done, &job, 0) != pdTRUE) return false;
+  _in_flight--;
+  return true;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifdef ESP32
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#ifndef CRYPTO_WORKER_QUEUE_SIZE
+  #define CRYPTO_WORKER_QUEUE_SIZE   8
+#endif
+
+#ifndef CRYPTO_WORKER_STACK_SIZE
+  #define CRYPTO_WORKER_STACK_SIZE   6144
+#endif
+
+/**
+ * \brief  Runs Ed25519 advert verify jobs on a FreeRTOS task, by default pinned to core 0 (the Arduino
+ *         loop() runs on core 1), so the main loop isn't stalled for several ms on each new advert.
+*/
+class ESP32CryptoWorker : public mesh::CryptoWorker {
+  QueueHandle_t _jobs, _done;
+  TaskHandle_t _task;
+  int _in_flight;   // submitted, but not yet poll()'d. Main loop only
+
+  static void taskLoop(void* arg);
+
+public:
+  ESP32CryptoWorker() : _jobs(NULL), _done(NULL), _task(NULL), _in_flight(0) { }
+
+  bool begin(int core=0, UBaseType_t priority=1);
+
+  bool submit(const mesh::CryptoJob& job) override;
+  bool poll(mesh::CryptoJob& job) override;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Mesh.h>
+
+/**
+ * \brief  A MillisecondClock that only moves when told to, for deterministic simulations.
+*/
+class VirtualMillisClock : public mesh::MillisecondClock {
+  unsigned long _now;
+public:
+  VirtualMillisClock(unsigned long start=0) : _now(start) { }
+
+  unsigned long getMillis() override { return _now; }
+
+  void setMillis(unsigned long now) { _now = now; }
+  void advance(unsigned long millis) { _now += millis; }
+};
+
+/**
+ * \brief  An RTCClock which is derived from a (virtual) MillisecondClock, plus a settable epoch base.
+*/
+class VirtualRTCClock : public mesh::RTCClock {
+  mesh::MillisecondClock* _ms;
+  uint32_t _base_time;
+  unsigned long _base_millis;
+public:
+  VirtualRTCClock(mesh::MillisecondClock& ms, uint32_t base_time=1715770351) : _ms(&ms), _base_time(base_time) {
+    _base_millis = ms.getMillis();
+  }
+
+  uint32_t getCurrentTime() override { return _base_time + (_ms->getMillis() - _base_millis) / 1000; }
+  void setCurrentTime(uint32_t time) override { _base_time = time; _base_millis = _ms->getMillis(); }
+};
+
+/**
+ * \brief  A small, seedable RNG (xorshift32), so that each simulated node has its own reproducible sequence.
+ *         NOTE: NOT for cryptographic use.
+*/
+class SimRNG : public mesh::RNG {
+  uint32_t _state;
+public:
+  SimRNG(uint32_t seed=1) { begin(seed); }
+
+  void begin(uint32_t seed) {
+    _state = seed * 2654435761u;   // spread small seeds out
+    if (_state == 0) _state = 1;
+  }
+
+  uint32_t next() {
+    uint32_t x = _state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return _state = x;
+  }
+
+  void random(uint8_t* dest, size_t sz) override {
+    while (sz > 0) {
+      uint32_t r = next();
+      for (int i = 0; i < 4 && sz > 0; i++, sz--) {
+        *dest++ = (uint8_t)(r >> (i*8));
+      }
+    }
+  }
+};
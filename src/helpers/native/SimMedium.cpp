@@ -0,0 +1,157 @@
+#include "SimMedium.h"
+#include "SimRadio.h"
+
+// Approximate SNR demodulation floor per SF (same figures as RadioLibWrapper's packet score)
+static float snr_threshold[] = { -7.5, -10, -12.5, -15, -17.5, -20 };
+
+SimMedium::SimMedium(mesh::MillisecondClock& ms, int max_radios, int max_links_per_radio, int max_concurrent_tx) : _ms(&ms) {
+  _max_radios = max_radios;
+  _num_radios = 0;
+  _radios = new SimRadio*[max_radios];
+  _max_links = max_links_per_radio;
+  _links = new Link*[max_radios];
+  _num_links = new int[max_radios];
+  _stats = new SimMediumStats[max_radios];
+  for (int i = 0; i < max_radios; i++) {
+    _links[i] = new Link[max_links_per_radio];
+    _num_links[i] = 0;
+    memset(&_stats[i], 0, sizeof(_stats[i]));
+  }
+  _max_tx = max_concurrent_tx > 0 ? max_concurrent_tx : max_radios*2;
+  _tx = new Transmission[_max_tx];
+  _num_tx = 0;
+  n_tx_dropped = 0;
+  capture_db = 6.0f;
+}
+
+int SimMedium::addRadio(SimRadio& radio) {
+  if (_num_radios >= _max_radios) return -1;   // full
+
+  int idx = _num_radios++;
+  _radios[idx] = &radio;
+  radio.setMedium(this, idx);
+  return idx;
+}
+
+bool SimMedium::addLink(int from, int to, float snr, float rssi) {
+  if (from < 0 || from >= _num_radios || to < 0 || to >= _num_radios || from == to) return false;
+  if (_num_links[from] >= _max_links) return false;   // too many neighbours
+
+  Link& l = _links[from][_num_links[from]++];
+  l.to = to;
+  l.snr = snr;
+  l.rssi = rssi;
+  return true;
+}
+
+const SimMedium::Link* SimMedium::findLink(int from, int to) const {
+  const Link* lp = _links[from];
+  for (int i = 0; i < _num_links[from]; i++, lp++) {
+    if (lp->to == to) return lp;
+  }
+  return NULL;
+}
+
+void SimMedium::startTransmit(int from, const uint8_t* bytes, int len, unsigned long end) {
+  prune();
+  if (_num_tx >= _max_tx) {
+    n_tx_dropped++;   // should not happen, if max_concurrent_tx is sized properly
+    return;
+  }
+  Transmission& t = _tx[_num_tx++];
+  t.from = from;
+  memcpy(t.data, bytes, len);
+  t.len = len;
+  t.start = _ms->getMillis();
+  t.end = end;
+  t.done = false;
+}
+
+bool SimMedium::isChannelBusy(int radio_idx) const {
+  unsigned long now = _ms->getMillis();
+  for (int i = 0; i < _num_tx; i++) {
+    const Transmission& t = _tx[i];
+    if (t.done || t.from == radio_idx || (long)(now - t.start) < 0 || (long)(now - t.end) >= 0) continue;
+    if (findLink(t.from, radio_idx)) return true;
+  }
+  return false;
+}
+
+bool SimMedium::isActive() const {
+  for (int i = 0; i < _num_tx; i++) {
+    if (!_tx[i].done) return true;
+  }
+  return false;
+}
+
+bool SimMedium::wasTransmitting(int radio_idx, unsigned long start, unsigned long end) const {
+  for (int i = 0; i < _num_tx; i++) {
+    const Transmission& t = _tx[i];
+    if (t.from == radio_idx && (long)(t.start - end) < 0 && (long)(start - t.end) < 0) return true;
+  }
+  return false;
+}
+
+void SimMedium::resolve(const Transmission& t) {
+  const Link* lp = _links[t.from];
+  for (int i = 0; i < _num_links[t.from]; i++, lp++) {
+    SimRadio* rx = _radios[lp->to];
+    SimMediumStats& st = _stats[lp->to];
+    st.heard_millis += t.end - t.start;
+
+    int sf = rx->getParams().sf;
+    if (sf < 7 || sf > 12 || lp->snr < snr_threshold[sf - 7]) {
+      st.rx_weak++;
+      continue;
+    }
+    if (wasTransmitting(lp->to, t.start, t.end)) {
+      st.rx_half_duplex++;
+      continue;
+    }
+
+    bool collided = false;
+    for (int j = 0; j < _num_tx && !collided; j++) {
+      const Transmission& u = _tx[j];
+      if (&u == &t || u.from == lp->to) continue;
+      if ((long)(u.start - t.end) >= 0 || (long)(t.start - u.end) >= 0) continue;   // no overlap
+
+      const Link* interferer = findLink(u.from, lp->to);
+      if (interferer && lp->rssi - interferer->rssi < capture_db) {
+        collided = true;
+      }
+    }
+    if (collided) {
+      st.rx_collided++;
+    } else if (rx->injectRaw(t.data, t.len, lp->snr, lp->rssi)) {
+      st.rx_ok++;
+    }
+  }
+}
+
+void SimMedium::prune() {
+  // can discard finished transmissions once nothing still in progress could overlap them
+  unsigned long now = _ms->getMillis();
+  unsigned long horizon = now;
+  for (int i = 0; i < _num_tx; i++) {
+    if (!_tx[i].done && (long)(_tx[i].start - horizon) < 0) horizon = _tx[i].start;
+  }
+  int j = 0;
+  for (int i = 0; i < _num_tx; i++) {
+    if (_tx[i].done && (long)(_tx[i].end - horizon) <= 0) continue;   // discard
+    if (i != j) _tx[j] = _tx[i];
+    j++;
+  }
+  _num_tx = j;
+}
+
+void SimMedium::loop() {
+  unsigned long now = _ms->getMillis();
+  for (int i = 0; i < _num_tx; i++) {
+    Transmission& t = _tx[i];
+    if (!t.done && (long)(now - t.end) >= 0) {
+      resolve(t);
+      t.done = true;
+    }
+  }
+  prune();
+}
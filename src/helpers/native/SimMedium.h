@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Mesh.h>
+
+class SimRadio;
+
+struct SimMediumStats {
+  uint32_t rx_ok;            // frames successfully delivered to this radio
+  uint32_t rx_collided;      // frames lost to overlapping transmissions (not captured)
+  uint32_t rx_half_duplex;   // frames lost because this radio was transmitting at the time
+  uint32_t rx_weak;          // frames below this radio's sensitivity (for its SF)
+  unsigned long heard_millis;  // total air-time of all frames arriving at this radio
+};
+
+/**
+ * \brief  A shared radio channel for SimRadio's, with an explicit (one-way) link graph. Transmissions are
+ *         resolved when they end: a frame is lost at a receiver if that receiver was transmitting, or if
+ *         an overlapping transmission reaching it is within 'capture_db' of the frame's RSSI (capture effect).
+*/
+class SimMedium {
+  struct Link {
+    int to;
+    float snr, rssi;
+  };
+  struct Transmission {
+    int from;
+    uint8_t data[MAX_TRANS_UNIT];
+    uint8_t len;
+    unsigned long start, end;
+    bool done;
+  };
+
+  mesh::MillisecondClock* _ms;
+  SimRadio** _radios;
+  int _max_radios, _num_radios;
+  Link** _links;   // per radio, array of outbound links
+  int* _num_links;
+  int _max_links;
+  Transmission* _tx;
+  int _max_tx, _num_tx;
+  SimMediumStats* _stats;
+  uint32_t n_tx_dropped;
+
+  const Link* findLink(int from, int to) const;
+  bool wasTransmitting(int radio_idx, unsigned long start, unsigned long end) const;
+  void resolve(const Transmission& t);
+  void prune();
+
+public:
+  float capture_db;   // min RSSI margin for a frame to survive an overlapping transmission
+
+  SimMedium(mesh::MillisecondClock& ms, int max_radios, int max_links_per_radio=32, int max_concurrent_tx=0);
+
+  /**
+   * \returns  index of radio in this medium, or -1 if full
+  */
+  int addRadio(SimRadio& radio);
+  int getNumRadios() const { return _num_radios; }
+  SimRadio* getRadio(int idx) const { return _radios[idx]; }
+
+  /**
+   * \brief  'to' can hear 'from', with given SNR and RSSI (one-way)
+  */
+  bool addLink(int from, int to, float snr, float rssi);
+  int getNumLinks(int from) const { return _num_links[from]; }
+
+  void startTransmit(int from, const uint8_t* bytes, int len, unsigned long end);
+
+  /**
+   * \returns  true if any other transmission is currently arriving at this radio (for LBT)
+  */
+  bool isChannelBusy(int radio_idx) const;
+
+  /**
+   * \returns  true if there are any transmissions still in progress
+  */
+  bool isActive() const;
+
+  /**
+   * \brief  deliver (or drop) all transmissions which have ended by now
+  */
+  void loop();
+
+  const SimMediumStats& getStats(int radio_idx) const { return _stats[radio_idx]; }
+  uint32_t getNumTxDropped() const { return n_tx_dropped; }
+};
@@ -0,0 +1,156 @@
+#include "SimRadio.h"
+#include "SimMedium.h"
+#include <math.h>
+
+SimRadio::SimRadio(mesh::MillisecondClock& ms, const SimRadioParams& params, uint32_t seed) : _ms(&ms), _params(params) {
+  _medium = NULL;
+  _medium_idx = -1;
+  _num_links = 0;
+  _rx_head = _rx_count = 0;
+  _tx_active = _tx_delivered = false;
+  _zero_copy = true;
+  _tx_end = 0;
+  _rng_state = seed ? seed : 1;
+  _last_snr = _last_rssi = 0;
+  n_recv = n_sent = n_lost = n_overflow = 0;
+}
+
+float SimRadio::nextRandom() {   // xorshift32, so that each radio's loss pattern is reproducible
+  uint32_t x = _rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  _rng_state = x;
+  return (x >> 8) / 16777216.0f;
+}
+
+bool SimRadio::addNeighbour(SimRadio& other) {
+  if (_num_links >= SIM_RADIO_MAX_LINKS) return false;   // table is full
+  _links[_num_links++] = &other;
+  return true;
+}
+
+bool SimRadio::injectRaw(const uint8_t* bytes, int len, float snr, float rssi) {
+  if (len <= 0 || len > MAX_TRANS_UNIT) return false;
+  if (_params.loss > 0 && nextRandom() < _params.loss) {
+    n_lost++;
+    return false;
+  }
+  if (_rx_count >= SIM_RADIO_RX_QUEUE) {
+    n_overflow++;
+    return false;
+  }
+  Frame& f = _rx_queue[(_rx_head + _rx_count) % SIM_RADIO_RX_QUEUE];
+  memcpy(f.data, bytes, len);
+  f.len = len;
+  f.snr = snr;
+  f.rssi = rssi;
+  _rx_count++;
+  return true;
+}
+
+int SimRadio::recvRaw(uint8_t* bytes, int sz) {
+  if (_rx_count == 0 || _tx_active) return 0;   // half-duplex, can't receive while transmitting
+
+  Frame& f = _rx_queue[_rx_head];
+  _rx_head = (_rx_head + 1) % SIM_RADIO_RX_QUEUE;
+  _rx_count--;
+
+  int len = f.len;
+  if (len > sz) { len = sz; }
+  memcpy(bytes, f.data, len);
+  _last_snr = f.snr;
+  _last_rssi = f.rssi;
+  n_recv++;
+  return len;
+}
+
+const uint8_t* SimRadio::recvRawInPlace(int& len) {
+  if (!_zero_copy) return mesh::Radio::recvRawInPlace(len);
+
+  len = 0;
+  if (_rx_count == 0 || _tx_active) return NULL;   // half-duplex, can't receive while transmitting
+
+  Frame& f = _rx_queue[_rx_head];   // slot stays intact until next injectRaw()
+  _rx_head = (_rx_head + 1) % SIM_RADIO_RX_QUEUE;
+  _rx_count--;
+
+  _last_snr = f.snr;
+  _last_rssi = f.rssi;
+  n_recv++;
+  len = f.len;
+  return f.data;
+}
+
+uint8_t* SimRadio::getSendBuffer() {
+  if (!_zero_copy) return mesh::Radio::getSendBuffer();
+  return _tx_frame.data;
+}
+
+uint32_t SimRadio::calcAirtimeMicros(const SimRadioParams& params, int len_bytes) {
+  double t_sym = (double)(1UL << params.sf) / params.bw;   // in millis (bw is in kHz)
+  int de = t_sym > 16.0 ? 1 : 0;   // low data-rate optimise
+  double t_preamble = (params.preamble_len + 4.25) * t_sym;
+
+  double num = 8.0*len_bytes - 4.0*params.sf + 28 + 16;   // explicit header, CRC on
+  double n_payload = 8 + fmax(ceil(num / (4.0*(params.sf - 2*de))) * params.cr, 0);
+
+  return (uint32_t) ((t_preamble + n_payload * t_sym) * 1000.0);
+}
+
+uint32_t SimRadio::getEstAirtimeFor(int len_bytes) {
+  return calcAirtimeMicros(_params, len_bytes) / 1000;
+}
+
+// Approximate SNR threshold per SF for successful reception (same as RadioLibWrapper)
+static float snr_threshold[] = { -7.5, -10, -12.5, -15, -17.5, -20 };
+
+float SimRadio::packetScore(float snr, int packet_len) {
+  if (_params.sf < 7 || _params.sf > 12) return 0.0f;
+  if (snr < snr_threshold[_params.sf - 7]) return 0.0f;
+
+  float success_rate_based_on_snr = (snr - snr_threshold[_params.sf - 7]) / 10.0f;
+  float collision_penalty = 1 - (packet_len / 256.0f);
+
+  return fmaxf(0.0f, fminf(1.0f, success_rate_based_on_snr * collision_penalty));
+}
+
+bool SimRadio::startSendRaw(const uint8_t* bytes, int len) {
+  if (_tx_active || len <= 0 || len > MAX_TRANS_UNIT) return false;
+
+  if (bytes != _tx_frame.data) {   // (otherwise, was serialised in-place via getSendBuffer())
+    memcpy(_tx_frame.data, bytes, len);
+  }
+  _tx_frame.len = len;
+  _tx_active = true;
+  _tx_delivered = false;
+  _tx_end = _ms->getMillis() + getEstAirtimeFor(len);
+  if (_medium) {
+    _medium->startTransmit(_medium_idx, bytes, len, _tx_end);
+  }
+  return true;
+}
+
+bool SimRadio::isSendComplete() {
+  if (!_tx_active || (long)(_ms->getMillis() - _tx_end) < 0) return false;
+
+  if (!_tx_delivered) {
+    if (_medium == NULL) {   // (otherwise the medium does the delivery)
+      for (int i = 0; i < _num_links; i++) {   // now fully on the air, deliver to all who can hear us
+        const SimRadioParams& rx = _links[i]->getParams();
+        _links[i]->injectRaw(_tx_frame.data, _tx_frame.len, rx.snr, rx.rssi);
+      }
+    }
+    _tx_delivered = true;
+    n_sent++;
+  }
+  return true;
+}
+
+bool SimRadio::isReceiving() {
+  return _medium ? _medium->isChannelBusy(_medium_idx) : false;
+}
+
+void SimRadio::onSendFinished() {
+  _tx_active = false;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Mesh.h>
+
+class SimMedium;
+
+#define SIM_RADIO_RX_QUEUE   8   // max received frames buffered, awaiting recvRaw()
+#define SIM_RADIO_MAX_LINKS 16
+
+struct SimRadioParams {
+  float bw;            // bandwidth, in kHz
+  uint8_t sf;          // spreading factor, 7..12
+  uint8_t cr;          // coding rate denominator, 5..8 (ie. 4/5 .. 4/8)
+  uint16_t preamble_len;
+  float loss;          // probability [0..1] that a frame is lost, per receiver
+  float snr;           // SNR reported for received frames
+  float rssi;          // RSSI reported for received frames
+
+  SimRadioParams() : bw(250), sf(11), cr(5), preamble_len(16), loss(0), snr(8), rssi(-90) { }
+};
+
+/**
+ * \brief  An in-memory mesh::Radio, for host-native builds. Frames sent by one SimRadio are delivered
+ *         (after the estimated LoRa air-time has elapsed) to all radios linked with addNeighbour(), or
+ *         if attached to a SimMedium, to whichever radios the medium decides can receive it.
+ *         NOTE: all timing is from the given MillisecondClock, so can be driven by real or virtual time.
+*/
+class SimRadio : public mesh::Radio {
+  struct Frame {
+    uint8_t data[MAX_TRANS_UNIT];
+    uint8_t len;
+    float snr, rssi;
+  };
+
+  mesh::MillisecondClock* _ms;
+  SimMedium* _medium;
+  int _medium_idx;
+  SimRadioParams _params;
+  SimRadio* _links[SIM_RADIO_MAX_LINKS];
+  int _num_links;
+  Frame _rx_queue[SIM_RADIO_RX_QUEUE];
+  int _rx_head, _rx_count;
+  Frame _tx_frame;
+  bool _tx_active, _tx_delivered;
+  bool _zero_copy;
+  unsigned long _tx_end;
+  uint32_t _rng_state;
+  float _last_snr, _last_rssi;
+  uint32_t n_recv, n_sent, n_lost, n_overflow;
+
+  float nextRandom();
+
+public:
+  SimRadio(mesh::MillisecondClock& ms, const SimRadioParams& params, uint32_t seed=1);
+
+  const SimRadioParams& getParams() const { return _params; }
+  void setParams(const SimRadioParams& params) { _params = params; }
+
+  /**
+   * \brief  link this radio to 'other', so that 'other' can hear what this radio transmits (one-way)
+  */
+  bool addNeighbour(SimRadio& other);
+
+  /**
+   * \brief  called by SimMedium::addRadio()
+  */
+  void setMedium(SimMedium* medium, int idx) { _medium = medium; _medium_idx = idx; }
+  int getMediumIndex() const { return _medium_idx; }
+
+  /**
+   * \brief  if false, recvRawInPlace()/getSendBuffer() use the Radio defaults (for benchmarking). Default is true.
+  */
+  void setZeroCopy(bool enable) { _zero_copy = enable; }
+
+  /**
+   * \brief  queue a raw frame as if just received over the air. (subject to this radio's 'loss' setting)
+   * \returns  false, if frame was lost or the receive queue is full
+  */
+  bool injectRaw(const uint8_t* bytes, int len, float snr, float rssi);
+
+  /**
+   * \returns  LoRa time-on-air for a frame of 'len_bytes', in microseconds (Semtech AN1200.13 formula)
+  */
+  static uint32_t calcAirtimeMicros(const SimRadioParams& params, int len_bytes);
+
+  int recvRaw(uint8_t* bytes, int sz) override;
+  const uint8_t* recvRawInPlace(int& len) override;
+  uint8_t* getSendBuffer() override;
+  uint32_t getEstAirtimeFor(int len_bytes) override;
+  float packetScore(float snr, int packet_len) override;
+  bool startSendRaw(const uint8_t* bytes, int len) override;
+  bool isSendComplete() override;
+  void onSendFinished() override;
+  bool isInRecvMode() const override { return !_tx_active; }
+  bool isReceiving() override;
+
+  float getLastRSSI() const override { return _last_rssi; }
+  float getLastSNR() const override { return _last_snr; }
+
+  uint32_t getPacketsRecv() const { return n_recv; }
+  uint32_t getPacketsSent() const { return n_sent; }
+  uint32_t getPacketsLost() const { return n_lost; }
+  uint32_t getRecvOverflows() const { return n_overflow; }
+  void resetStats() { n_recv = n_sent = n_lost = n_overflow = 0; }
+};
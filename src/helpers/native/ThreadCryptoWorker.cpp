@@ -0,0 +1,58 @@
+#include "ThreadCryptoWorker.h"
+
+void ThreadCryptoWorker::begin() {
+  if (_running) return;
+  _running = true;
+  _thread = std::thread(&ThreadCryptoWorker::threadLoop, this);
+}
+
+void ThreadCryptoWorker::stop() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _running = false;
+  }
+  _cond.notify_all();
+  if (_thread.joinable()) _thread.join();
+}
+
+void ThreadCryptoWorker::threadLoop() {
+  std::unique_lock<std::mutex> guard(_lock);
+  while (true) {
+    _cond.wait(guard, [this] { return !_running || !_jobs.empty(); });
+    if (!_running) break;
+
+    mesh::CryptoJob job = _jobs.front();
+    _jobs.pop_front();
+
+    guard.unlock();
+    mesh::CryptoWorker::execute(job);
+    guard.lock();
+
+    _done.push_back(job);
+  }
+}
+
+int ThreadCryptoWorker::getNumInFlight() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _in_flight;
+}
+
+bool ThreadCryptoWorker::submit(const mesh::CryptoJob& job) {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_running || _in_flight >= CRYPTO_WORKER_QUEUE_SIZE) return false;   // full
+    _jobs.push_back(job);
+    _in_flight++;
+  }
+  _cond.notify_one();
+  return true;
+}
+
+bool ThreadCryptoWorker::poll(mesh::CryptoJob& job) {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_done.empty()) return false;
+  job = _done.front();
+  _done.pop_front();
+  _in_flight--;
+  return true;
+}
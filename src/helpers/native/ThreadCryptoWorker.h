@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Mesh.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifndef CRYPTO_WORKER_QUEUE_SIZE
+  #define CRYPTO_WORKER_QUEUE_SIZE   8
+#endif
+
+/**
+ * \brief  Host-native equivalent of ESP32CryptoWorker: runs the jobs on a std::thread.
+*/
+class ThreadCryptoWorker : public mesh::CryptoWorker {
+  std::thread _thread;
+  std::mutex _lock;
+  std::condition_variable _cond;
+  std::deque<mesh::CryptoJob> _jobs, _done;
+  int _in_flight;   // submitted, but not yet poll()'d
+  bool _running;
+
+  void threadLoop();
+
+public:
+  ThreadCryptoWorker() : _in_flight(0), _running(false) { }
+  ~ThreadCryptoWorker() { stop(); }
+
+  void begin();
+  void stop();
+
+  /**
+   * \returns  number of jobs submitted, but not yet poll()'d
+  */
+  int getNumInFlight();
+
+  bool submit(const mesh::CryptoJob& job) override;
+  bool poll(mesh::CryptoJob& job) override;
+};
@@ -13,6 +13,10 @@
 
 static volatile uint8_t state = STATE_IDLE;
 
+#if defined(ESP32) && RADIO_TASK_ENABLED
+static TaskHandle_t radio_task = NULL;
+#endif
+
 // this function is called when a complete packet
 // is transmitted by the module
 static 
@@ -22,8 +26,82 @@ static
 void setFlag(void) {
   // we sent a packet, set the flag
   state |= STATE_INT_READY;
+
+#if defined(ESP32) && RADIO_TASK_ENABLED
+  if (radio_task) {   // wake the radio task
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(radio_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+#endif
+}
+
+#if defined(ESP32) && RADIO_TASK_ENABLED
+
+void RadioLibWrapper::lock() {
+  if (_lock) xSemaphoreTake(_lock, portMAX_DELAY);
+}
+void RadioLibWrapper::unlock() {
+  if (_lock) xSemaphoreGive(_lock);
 }
 
+bool RadioLibWrapper::startRadioTask(int core) {
+  if (_task) return true;   // already running
+
+  _lock = xSemaphoreCreateMutex();
+  if (_lock == NULL) return false;
+  if (xTaskCreatePinnedToCore(taskLoop, "radio", RADIO_TASK_STACK_SIZE, this, RADIO_TASK_PRIORITY, &_task, core) != pdPASS) {
+    vSemaphoreDelete(_lock);
+    _lock = NULL;
+    return false;
+  }
+  radio_task = _task;
+  if (state & STATE_INT_READY) xTaskNotifyGive(_task);   // already pending
+  return true;
+}
+
+bool RadioLibWrapper::isRadioTaskRunning() const { return _task != NULL; }
+uint32_t RadioLibWrapper::getRxOverflows() const { return n_rx_overflow; }
+
+void RadioLibWrapper::taskLoop(void* arg) {
+  RadioLibWrapper* self = (RadioLibWrapper *) arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // woken by setFlag()
+
+    self->lock();
+    self->drainRx();
+    self->unlock();
+  }
+}
+
+// NOTE: called with lock held
+void RadioLibWrapper::drainRx() {
+  if ((state & STATE_INT_READY) == 0 || (state & ~STATE_INT_READY) != STATE_RX) return;   // TX complete is left for isSendComplete()
+
+  RxFrame* frame = _rx_ring.pushSlot();
+  if (frame) {
+    // NOTE: don't touch _last_rssi etc here, main loop may be between recvRaw() and getLastSNR()
+    int len = readPacket(frame->data, sizeof(frame->data), frame->rssi, frame->snr);
+    if (len > 0) {
+      frame->len = len;
+      _rx_ring.commitPush();
+    }
+  } else {
+    n_rx_overflow++;   // main loop isn't keeping up, drop it
+  }
+  startRecv();
+}
+
+#else
+
+void RadioLibWrapper::lock() { }
+void RadioLibWrapper::unlock() { }
+bool RadioLibWrapper::startRadioTask(int core) { return false; }
+bool RadioLibWrapper::isRadioTaskRunning() const { return false; }
+uint32_t RadioLibWrapper::getRxOverflows() const { return 0; }
+
+#endif
+
 void RadioLibWrapper::begin() {
   _radio->setPacketReceivedAction(setFlag);  // this is also SentComplete interrupt
   state = STATE_IDLE;
@@ -41,8 +119,10 @@ void RadioLibWrapper::begin() {
 }
 
 void RadioLibWrapper::idle() {
+  lock();
   _radio->standby();
   state = STATE_IDLE;   // need another startReceive()
+  unlock();
 }
 
 void RadioLibWrapper::triggerNoiseFloorCalibrate(int threshold) {
@@ -54,16 +134,19 @@ void RadioLibWrapper::triggerNoiseFloorCalibrate(int threshold) {
 }
 
 void RadioLibWrapper::resetAGC() {
+  lock();
   // make sure we're not mid-receive of packet!
-  if ((state & STATE_INT_READY) != 0 || isReceivingPacket()) return;
-
-  // NOTE: according to higher powers, just issuing RadioLib's startReceive() will reset the AGC.
-  //      revisit this if a better impl is discovered.
-  state = STATE_IDLE;   // trigger a startReceive()
+  if ((state & STATE_INT_READY) == 0 && !isReceivingPacket()) {
+    // NOTE: according to higher powers, just issuing RadioLib's startReceive() will reset the AGC.
+    //      revisit this if a better impl is discovered.
+    state = STATE_IDLE;   // trigger a startReceive()
+  }
+  unlock();
 }
 
 void RadioLibWrapper::loop() {
   if (state == STATE_RX && _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES) {
+    lock();
     if (!isReceivingPacket()) {
       int rssi = getCurrentRSSI();
       if (rssi < _noise_floor + SAMPLING_THRESHOLD) {  // only consider samples below current floor + sampling THRESHOLD
@@ -71,6 +154,7 @@ void RadioLibWrapper::loop() {
         _floor_sample_sum += rssi;
       }
     }
+    unlock();
   } else if (_num_floor_samples >= NUM_NOISE_FLOOR_SAMPLES && _floor_sample_sum != 0) {
     _noise_floor = _floor_sample_sum / NUM_NOISE_FLOOR_SAMPLES;
     if (_noise_floor < -120) {
@@ -95,31 +179,55 @@ bool RadioLibWrapper::isInRecvMode() const {
   return (state & ~STATE_INT_READY) == STATE_RX;
 }
 
+// NOTE: only call when STATE_INT_READY in RX
+int RadioLibWrapper::readPacket(uint8_t* bytes, int sz, float& rssi, float& snr) {
+  int len = _radio->getPacketLength();
+  if (len > 0) {
+    if (len > sz) { len = sz; }
+    int err = _radio->readData(bytes, len);
+    if (err != RADIOLIB_ERR_NONE) {
+      MESH_DEBUG_PRINTLN("RadioLibWrapper: error: readData(%d)", err);
+      len = 0;
+    } else {
+    //  Serial.print("  readData() -> "); Serial.println(len);
+      rssi = readPacketRSSI();
+      snr = readPacketSNR();
+    }
+  }
+  state = STATE_IDLE;   // need another startReceive()
+  return len;
+}
+
 int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
+#if defined(ESP32) && RADIO_TASK_ENABLED
+  if (_task) {
+    int len = 0;
+    RxFrame* frame = _rx_ring.front();
+    if (frame) {   // already read out by the radio task
+      len = frame->len > sz ? sz : frame->len;
+      memcpy(bytes, frame->data, len);
+      _last_rssi = frame->rssi;
+      _last_snr = frame->snr;
+      _rx_ring.pop();
+      n_recv++;
+    }
+    if (state == STATE_IDLE) {   // eg. after TX, or resetAGC()  (NOTE: a pending RX interrupt is left for the task)
+      lock();
+      if (state == STATE_IDLE) startRecv();
+      unlock();
+    }
+    return len;
+  }
+#endif
+
   int len = 0;
   if (state & STATE_INT_READY) {
-    len = _radio->getPacketLength();
-    if (len > 0) {
-      if (len > sz) { len = sz; }
-      int err = _radio->readData(bytes, len);
-      if (err != RADIOLIB_ERR_NONE) {
-        MESH_DEBUG_PRINTLN("RadioLibWrapper: error: readData(%d)", err);
-        len = 0;
-      } else {
-      //  Serial.print("  readData() -> "); Serial.println(len);
-        n_recv++;
-      }
-    }
-    state = STATE_IDLE;   // need another startReceive()
+    len = readPacket(bytes, sz, _last_rssi, _last_snr);
+    if (len > 0) n_recv++;
   }
 
   if (state != STATE_RX) {
-    int err = _radio->startReceive();
-    if (err == RADIOLIB_ERR_NONE) {
-      state = STATE_RX;
-    } else {
-      MESH_DEBUG_PRINTLN("RadioLibWrapper: error: startReceive(%d)", err);
-    }
+    startRecv();
   }
   return len;
 }
@@ -130,11 +238,14 @@ uint32_t RadioLibWrapper::getEstAirtimeFor(int len_bytes) {
 
 bool RadioLibWrapper::startSendRaw(const uint8_t* bytes, int len) {
   _board->onBeforeTransmit();
+  lock();
   int err = _radio->startTransmit((uint8_t *) bytes, len);
   if (err == RADIOLIB_ERR_NONE) {
     state = STATE_TX_WAIT;
+    unlock();
     return true;
   }
+  unlock();
   MESH_DEBUG_PRINTLN("RadioLibWrapper: error: startTransmit(%d)", err);
   idle();   // trigger another startRecv()
   return false;
@@ -150,9 +261,11 @@ bool RadioLibWrapper::isSendComplete() {
 }
 
 void RadioLibWrapper::onSendFinished() {
+  lock();
   _radio->finishTransmit();
-  _board->onAfterTransmit();
   state = STATE_IDLE;
+  unlock();
+  _board->onAfterTransmit();
 }
 
 bool RadioLibWrapper::isChannelActive() {
@@ -161,13 +274,6 @@ bool RadioLibWrapper::isChannelActive() {
           : getCurrentRSSI() > _noise_floor + _threshold;
 }
 
-float RadioLibWrapper::getLastRSSI() const {
-  return _radio->getRSSI();
-}
-float RadioLibWrapper::getLastSNR() const {
-  return _radio->getSNR();
-}
-
 // Approximate SNR threshold per SF for successful reception (based on Semtech datasheets)
 static float snr_threshold[] = {
     -7.5,  // SF7 needs at least -7.5 dB SNR
@@ -3,22 +3,83 @@
 #include <Mesh.h>
 #include <RadioLib.h>
 
+#if defined(ESP32) && RADIO_TASK_ENABLED
+  #include <helpers/SPSCRing.h>
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/semphr.h>
+  #include <freertos/task.h>
+
+  #ifndef RADIO_TASK_RX_RING_SIZE
+    #define RADIO_TASK_RX_RING_SIZE   8    // must be power of two
+  #endif
+  #ifndef RADIO_TASK_PRIORITY
+    #define RADIO_TASK_PRIORITY      (configMAX_PRIORITIES - 2)
+  #endif
+  #ifndef RADIO_TASK_STACK_SIZE
+    #define RADIO_TASK_STACK_SIZE     3072
+  #endif
+#endif
+
 class RadioLibWrapper : public mesh::Radio {
 protected:
   PhysicalLayer* _radio;
   mesh::MainBoard* _board;
-  uint32_t n_recv, n_sent;
+  uint32_t n_recv, n_sent;      // main loop only
   int16_t _noise_floor, _threshold;
   uint16_t _num_floor_samples;
   int32_t _floor_sample_sum;
+  float _last_rssi, _last_snr;   // of last packet returned by recvRaw()
+
+#if defined(ESP32) && RADIO_TASK_ENABLED
+  struct RxFrame {
+    uint8_t data[MAX_TRANS_UNIT];
+    uint8_t len;
+    float rssi, snr;
+  };
+  SPSCRing<RxFrame, RADIO_TASK_RX_RING_SIZE> _rx_ring;   // radio task -> main loop
+  SemaphoreHandle_t _lock;    // serialises access to the radio (SPI), between main loop and radio task
+  TaskHandle_t _task;
+  uint32_t n_rx_overflow;
+
+  static void taskLoop(void* arg);
+  void drainRx();
+#endif
 
   void idle();
   void startRecv();
+  int readPacket(uint8_t* bytes, int sz, float& rssi, float& snr);
   float packetScoreInt(float snr, int sf, int packet_len);
   virtual bool isReceivingPacket() =0;
+  virtual float readPacketRSSI() { return _radio->getRSSI(); }   // of packet just received
+  virtual float readPacketSNR() { return _radio->getSNR(); }
 
 public:
-  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) { n_recv = n_sent = 0; }
+  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) {
+    n_recv = n_sent = 0;
+    _last_rssi = _last_snr = 0;
+  #if defined(ESP32) && RADIO_TASK_ENABLED
+    _lock = NULL;
+    _task = NULL;
+    n_rx_overflow = 0;
+  #endif
+  }
+
+  /**
+   * \brief  must be held by anything else accessing the radio directly (eg. radio_set_params()), if the
+   *         radio task has been started. Otherwise these are no-ops.
+  */
+  void lock();
+  void unlock();
+
+  /**
+   * \brief  RADIO_TASK_ENABLED builds only: received packets are then read out of the radio by a dedicated
+   *         task, woken by the DIO1 interrupt, instead of when loop() next polls recvRaw(). RX is restarted
+   *         straight away, and frames are queued for recvRaw() in a lock-free ring.
+   * \returns  false if not supported, or task couldn't be created
+  */
+  bool startRadioTask(int core=1);
+  bool isRadioTaskRunning() const;
+  uint32_t getRxOverflows() const;
 
   void begin() override;
   virtual void powerOff() { _radio->sleep(); }
@@ -31,9 +92,10 @@ public:
   bool isChannelActive();
 
   bool isReceiving() override { 
-    if (isReceivingPacket()) return true;
-
-    return isChannelActive();
+    lock();
+    bool recv = isReceivingPacket() || isChannelActive();
+    unlock();
+    return recv;
   }
 
   virtual float getCurrentRSSI() =0;
@@ -48,8 +110,8 @@ public:
   uint32_t getPacketsSent() const { return n_sent; }
   void resetStats() { n_recv = n_sent = 0; }
 
-  virtual float getLastRSSI() const override;
-  virtual float getLastSNR() const override;
+  float getLastRSSI() const override { return _last_rssi; }
+  float getLastSNR() const override { return _last_snr; }
 
   float packetScore(float snr, int packet_len) override { return packetScoreInt(snr, 10, packet_len); }  // assume sf=10
 };
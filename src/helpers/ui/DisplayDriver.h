@@ -18,6 +18,7 @@ public:
   virtual void turnOff() = 0;
   virtual void clear() = 0;
   virtual void startFrame(Color bkg = DARK) = 0;
+  virtual void startPartialFrame() { }   // start a frame without clearing, to redraw just some regions over the last one
   virtual void setTextSize(int sz) = 0;
   virtual void setColor(Color c) = 0;
   virtual void setCursor(int x, int y) = 0;
@@ -27,6 +28,8 @@ public:
   virtual void drawRect(int x, int y, int w, int h) = 0;
   virtual void drawXbm(int x, int y, const uint8_t* bits, int w, int h) = 0;
   virtual uint16_t getTextWidth(const char* str) = 0;
+  virtual void setClipRect(int x, int y, int w, int h) { }   // restrict drawing to a region (optional)
+  virtual void clearClipRect() { }
   virtual void drawTextCentered(int mid_x, int y, const char* str) {   // helper method (override to optimise)
     int w = getTextWidth(str);
     setCursor(mid_x - w/2, y);
@@ -84,12 +87,25 @@ public:
       ellipsis = "...";   // fixed-width fonts: no space
     }
     
-    int ellipsis_width = getTextWidth(ellipsis);
-    int str_len = strlen(temp_str);
-    
-    while (str_len > 0 && getTextWidth(temp_str) > max_width - ellipsis_width) {
-      temp_str[--str_len] = 0;
+    int avail = max_width - getTextWidth(ellipsis);
+
+    // prefix width only grows with length, so binary search for longest prefix that fits
+    // (rather than measuring again after chopping each char)
+    int lo = 0, hi = len - 1;   // whole string already known not to fit
+    while (lo < hi) {
+      int mid = (lo + hi + 1) / 2;
+      char c = temp_str[mid];
+      temp_str[mid] = 0;
+      bool fits = getTextWidth(temp_str) <= avail;
+      temp_str[mid] = c;
+      if (fits) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
     }
+    if (lo > (int)sizeof(temp_str) - 5) lo = sizeof(temp_str) - 5;   // room for ellipsis
+    temp_str[lo] = 0;
     strcat(temp_str, ellipsis);
     
     setCursor(x, y);
@@ -1,4 +1,213 @@
 #include "M5CardputerDisplay.h"
 
-// Implementation file for M5CardputerDisplay
-// Most functionality is inline in the header for efficiency
+bool M5CardputerDisplay::begin() {
+  _isOn = true;
+  M5.Display.setRotation(1);  // Landscape orientation
+  M5.Display.fillScreen(TFT_BLACK);
+  M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
+  M5.Display.setTextSize(1);
+
+#if DISPLAY_SPRITE_BUFFER
+  // prefer internal (DMA capable) RAM, so pushSprite() can use DMA. ~64KB
+  _canvas.setColorDepth(16);
+  _canvas.setPsram(false);
+  bool ok = _canvas.createSprite(SCREEN_WIDTH, SCREEN_HEIGHT) != NULL;
+  if (!ok && psramFound()) {
+    _canvas.setPsram(true);
+    ok = _canvas.createSprite(SCREEN_WIDTH, SCREEN_HEIGHT) != NULL;
+  }
+  if (ok) {
+    _gfx = &_canvas;
+    _canvas.fillScreen(TFT_BLACK);
+    _canvas.setTextColor(TFT_WHITE, TFT_BLACK);
+    _canvas.setTextSize(1);
+    _panel_stale = true;
+  } else {
+    Serial.println("M5Cardputer Display: not enough RAM for sprite, drawing direct to panel");
+  }
+#endif
+  Serial.println("M5Cardputer Display initialized");
+  return true;
+}
+
+uint16_t M5CardputerDisplay::toRGB(Color c) const {
+  switch(c) {
+    case DARK:   return _dark_color;
+    case LIGHT:  return _light_color;
+    case RED:    return TFT_RED;
+    case GREEN:  return TFT_GREEN;
+    case BLUE:   return TFT_BLUE;
+    case YELLOW: return TFT_YELLOW;
+    case ORANGE: return TFT_ORANGE;
+    default:     return _light_color;
+  }
+}
+
+void M5CardputerDisplay::startFrame(Color bkg) {
+  if (!_isOn) return;
+  _frame_start = micros();
+
+  // Clear screen at start of each frame (just the sprite, if buffered)
+  _gfx->fillScreen(toRGB(bkg));
+  markDirty(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+  cursor_x = 0;
+  cursor_y = 0;
+}
+
+void M5CardputerDisplay::startPartialFrame() {
+  if (!_isOn) return;
+  _frame_start = micros();
+  _frame_stats.partial_frames++;
+  cursor_x = 0;
+  cursor_y = 0;
+}
+
+void M5CardputerDisplay::endFrame() {
+  if (!_isOn) return;
+#if DISPLAY_SPRITE_BUFFER
+  if (isBuffered()) flush();
+#endif
+  uint32_t t = micros() - _frame_start;
+  _frame_stats.frames++;
+  _frame_stats.last_us = t;
+  _frame_stats.total_us += t;
+  if (t > _frame_stats.max_us) _frame_stats.max_us = t;
+}
+
+void M5CardputerDisplay::print(const char* str) {
+  if (!_isOn) return;
+  int x0 = _gfx->getCursorX();
+  int y0 = _gfx->getCursorY();
+  _gfx->print(str);
+  int x1 = _gfx->getCursorX();
+  int y1 = _gfx->getCursorY();
+
+  int h = CHAR_HEIGHT * text_size;
+  if (y1 == y0) {
+    markDirty(x0, y0, x1 - x0, h);
+  } else {   // wrapped, or had newline(s)
+    markDirty(0, y0, SCREEN_WIDTH, y1 - y0 + h);
+  }
+}
+
+void M5CardputerDisplay::drawTextEllipsized(int x, int y, int max_width, const char* str) {
+  // fixed width font, so cut point follows directly from the widths
+  int char_w = CHAR_WIDTH * text_size;
+  int max_chars = max_width / char_w;
+  int len = strlen(str);
+
+  char temp_str[256];
+  if (len > max_chars) {
+    len = max_chars > 3 ? max_chars - 3 : 0;
+    if (len > (int)sizeof(temp_str) - 4) len = sizeof(temp_str) - 4;
+    memcpy(temp_str, str, len);
+    strcpy(&temp_str[len], "...");
+  } else {
+    if (len > (int)sizeof(temp_str) - 1) len = sizeof(temp_str) - 1;
+    memcpy(temp_str, str, len);
+    temp_str[len] = 0;
+  }
+  setCursor(x, y);
+  print(temp_str);
+}
+
+#if DISPLAY_SPRITE_BUFFER
+
+void M5CardputerDisplay::markDirty(int x, int y, int w, int h) {
+  if (!isBuffered()) return;
+
+  // clip to screen
+  int x1 = x + w, y1 = y + h;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (x1 > SCREEN_WIDTH) x1 = SCREEN_WIDTH;
+  if (y1 > SCREEN_HEIGHT) y1 = SCREEN_HEIGHT;
+  if (x >= x1 || y >= y1) return;
+
+  int best = -1;
+  int best_growth = 0x7FFFFFFF;
+  for (int i = 0; i < _num_dirty; i++) {
+    Rect& r = _dirty[i];
+    if (x >= r.x0 && y >= r.y0 && x1 <= r.x1 && y1 <= r.y1) return;   // already covered
+
+    // area added, if merged with r
+    int ux0 = min((int)r.x0, x), uy0 = min((int)r.y0, y), ux1 = max((int)r.x1, x1), uy1 = max((int)r.y1, y1);
+    int growth = (ux1 - ux0) * (uy1 - uy0) - (r.x1 - r.x0) * (r.y1 - r.y0);
+    bool overlaps = x < r.x1 && r.x0 < x1 && y < r.y1 && r.y0 < y1;
+    if (overlaps) growth = 0;   // always merge overlapping
+    if (growth < best_growth) {
+      best = i;
+      best_growth = growth;
+    }
+  }
+  if (best >= 0 && (best_growth == 0 || _num_dirty == DISPLAY_MAX_DIRTY_RECTS)) {
+    Rect& r = _dirty[best];
+    if (x < r.x0) r.x0 = x;
+    if (y < r.y0) r.y0 = y;
+    if (x1 > r.x1) r.x1 = x1;
+    if (y1 > r.y1) r.y1 = y1;
+  } else {
+    Rect& r = _dirty[_num_dirty++];
+    r.x0 = x; r.y0 = y; r.x1 = x1; r.y1 = y1;
+  }
+}
+
+#define ROW_UNCHECKED   0
+#define ROW_SAME        1
+#define ROW_CHANGED     2
+
+void M5CardputerDisplay::flush() {
+  if (_panel_stale) {
+    _dirty[0].x0 = _dirty[0].y0 = 0;
+    _dirty[0].x1 = SCREEN_WIDTH;
+    _dirty[0].y1 = SCREEN_HEIGHT;
+    _num_dirty = 1;
+  }
+  _frame_stats.last_pixels = 0;
+  if (_num_dirty == 0) return;
+
+  // UITask redraws whole screens, but usually only a few rows actually change. So, of the dirty rows,
+  // compare a hash of each with the hash of what was last pushed, and just push the ones that differ.
+  uint8_t state[SCREEN_HEIGHT];
+  memset(state, ROW_UNCHECKED, sizeof(state));
+  const uint32_t* buf = (const uint32_t*) _canvas.getBuffer();
+  const int words_per_row = SCREEN_WIDTH / 2;   // 16 bit pixels
+
+  for (int i = 0; i < _num_dirty; i++) {
+    for (int y = _dirty[i].y0; y < _dirty[i].y1; y++) {
+      if (state[y] != ROW_UNCHECKED) continue;
+
+      const uint32_t* p = &buf[y * words_per_row];
+      uint32_t h = 2166136261u;   // FNV-1a, by word
+      for (int k = 0; k < words_per_row; k++) {
+        h = (h ^ p[k]) * 16777619u;
+      }
+      state[y] = (_panel_stale || h != _row_hash[y]) ? ROW_CHANGED : ROW_SAME;
+      _row_hash[y] = h;
+    }
+  }
+
+  M5.Display.startWrite();
+  for (int i = 0; i < _num_dirty; i++) {
+    const Rect& r = _dirty[i];
+    int y = r.y0;
+    while (y < r.y1) {
+      if (state[y] != ROW_CHANGED) { y++; continue; }
+
+      int run_start = y;
+      while (y < r.y1 && state[y] == ROW_CHANGED) y++;
+
+      // pushSprite() is clipped to the changed region, and uses DMA if sprite is in DMA capable RAM
+      M5.Display.setClipRect(r.x0, run_start, r.x1 - r.x0, y - run_start);
+      _canvas.pushSprite(&M5.Display, 0, 0);
+      _frame_stats.last_pixels += (r.x1 - r.x0) * (y - run_start);
+    }
+  }
+  M5.Display.clearClipRect();
+  M5.Display.endWrite();
+
+  _num_dirty = 0;
+  _panel_stale = false;
+}
+
+#endif
@@ -14,8 +14,26 @@
 #define TFT_ORANGE 0xFD20
 #endif
 
+#ifndef DISPLAY_SPRITE_BUFFER
+  #define DISPLAY_SPRITE_BUFFER   1    // draw into an off-screen sprite, push just the changed regions in endFrame()
+#endif
+
+#ifndef DISPLAY_MAX_DIRTY_RECTS
+  #define DISPLAY_MAX_DIRTY_RECTS   8
+#endif
+
+struct DisplayFrameStats {
+  uint32_t frames;
+  uint32_t partial_frames;    // of 'frames', those started with startPartialFrame()
+  uint32_t last_us, max_us;   // startFrame() .. end of endFrame() flush
+  uint64_t total_us;
+  uint32_t last_pixels;       // pixels pushed to panel, by last frame (buffered mode only)
+};
+
 class M5CardputerDisplay : public DisplayDriver {
 private:
+  struct Rect { int16_t x0, y0, x1, y1; };   // x1, y1 exclusive
+
   bool _isOn = false;
   uint16_t cursor_x = 0;
   uint16_t cursor_y = 0;
@@ -28,28 +46,48 @@ private:
   static const uint8_t CHAR_WIDTH = 6;
   static const uint8_t CHAR_HEIGHT = 8;
 
+  lgfx::LovyanGFX* _gfx = &M5.Display;   // sprite if buffered, otherwise the panel
+#if DISPLAY_SPRITE_BUFFER
+  M5Canvas _canvas;
+  Rect _dirty[DISPLAY_MAX_DIRTY_RECTS];
+  int _num_dirty = 0;
+  uint32_t _row_hash[SCREEN_HEIGHT];   // of each sprite row, as last pushed to panel
+  bool _panel_stale = true;            // panel doesn't match _row_hash[], push everything on next flush
+
+  void markDirty(int x, int y, int w, int h);
+  void flush();
+#else
+  void markDirty(int x, int y, int w, int h) { }
+#endif
+  uint32_t _frame_start = 0;
+  DisplayFrameStats _frame_stats = { 0 };
+
+  uint16_t toRGB(Color c) const;
+
 public:
   M5CardputerDisplay() : DisplayDriver(SCREEN_WIDTH, SCREEN_HEIGHT) {}
 
-  bool begin() {
-    _isOn = true;
-    M5.Display.setRotation(1);  // Landscape orientation
-    M5.Display.fillScreen(TFT_BLACK);
-    M5.Display.setTextColor(TFT_WHITE, TFT_BLACK);
-    M5.Display.setTextSize(1);
-    Serial.println("M5Cardputer Display initialized");
-    return true;
-  }
+  bool begin();
+
+  /**
+   * \returns  true if drawing to an off-screen sprite (ie. DISPLAY_SPRITE_BUFFER, and sprite could be allocated)
+  */
+  bool isBuffered() const { return _gfx != &M5.Display; }
+
+  const DisplayFrameStats& getFrameStats() const { return _frame_stats; }
 
   bool isOn() override { return _isOn; }
-  
+
   void turnOn() override {
     if (!_isOn) {
       M5.Display.wakeup();
       _isOn = true;
+#if DISPLAY_SPRITE_BUFFER
+      _panel_stale = true;   // push whole sprite on next frame
+#endif
     }
   }
-  
+
   void turnOff() override {
     if (_isOn) {
       M5.Display.sleep();
@@ -57,33 +95,18 @@ public:
     }
   }
 
-  void startFrame(Color bkg = DARK) override {
-    if (!_isOn) return;
-    // Clear screen at start of each frame
-    uint16_t bgColor;
-    switch(bkg) {
-      case DARK:   bgColor = _dark_color; break;
-      case LIGHT:  bgColor = _light_color; break;
-      case RED:    bgColor = TFT_RED; break;
-      case GREEN:  bgColor = TFT_GREEN; break;
-      case BLUE:   bgColor = TFT_BLUE; break;
-      case YELLOW: bgColor = TFT_YELLOW; break;
-      case ORANGE: bgColor = TFT_ORANGE; break;
-      default:     bgColor = _dark_color; break;
-    }
-    M5.Display.fillScreen(bgColor);
-    cursor_x = 0;
-    cursor_y = 0;
-  }
+  void startFrame(Color bkg = DARK) override;
 
-  void endFrame() override {
-    if (!_isOn) return;
-    // No buffering, changes are immediate
-  }
+  /**
+   * \brief  begins a frame without clearing, for redrawing just some regions over the previous frame
+  */
+  void startPartialFrame() override;
+  void endFrame() override;
 
   void clear() override {
     if (!_isOn) return;
-    M5.Display.fillScreen(TFT_BLACK);
+    _gfx->fillScreen(TFT_BLACK);
+    markDirty(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
     cursor_x = 0;
     cursor_y = 0;
   }
@@ -91,50 +114,54 @@ public:
   void setCursor(int x, int y) override {
     cursor_x = x;
     cursor_y = y;
-    M5.Display.setCursor(x, y);
+    _gfx->setCursor(x, y);
   }
 
   void setTextSize(int sz) override {
     text_size = sz;
-    M5.Display.setTextSize(sz);
+    _gfx->setTextSize(sz);
   }
 
   void setColor(Color c) override {
-    switch(c) {
-      case DARK:   _color = _dark_color; break;
-      case LIGHT:  _color = _light_color; break;
-      case RED:    _color = TFT_RED; break;
-      case GREEN:  _color = TFT_GREEN; break;
-      case BLUE:   _color = TFT_BLUE; break;
-      case YELLOW: _color = TFT_YELLOW; break;
-      case ORANGE: _color = TFT_ORANGE; break;
-      default:     _color = _light_color; break;
-    }
-    M5.Display.setTextColor(_color, _dark_color);
+    _color = toRGB(c);
+    _gfx->setTextColor(_color, _dark_color);
   }
-  
+
+  /**
+   * \brief  text color outside the theme palette (RGB565), drawn with transparent background
+  */
+  void setTextColorRGB(uint16_t rgb565) {
+    _gfx->setTextColor(rgb565);
+  }
+
   // Methods to customize theme colors
   void setLightColor(uint16_t color) {
     _light_color = color;
   }
-  
+
   void setDarkColor(uint16_t color) {
     _dark_color = color;
   }
 
-  void print(const char* str) override {
-    if (!_isOn) return;
-    M5.Display.print(str);
-  }
+  void print(const char* str) override;
 
   void drawRect(int x, int y, int w, int h) override {
     if (!_isOn) return;
-    M5.Display.drawRect(x, y, w, h, _color);
+    _gfx->drawRect(x, y, w, h, _color);
+    markDirty(x, y, w, h);
   }
 
   void fillRect(int x, int y, int w, int h) override {
+    fillRectRGB(x, y, w, h, _color);
+  }
+
+  /**
+   * \brief  fill with color outside the theme palette (RGB565)
+  */
+  void fillRectRGB(int x, int y, int w, int h, uint16_t rgb565) {
     if (!_isOn) return;
-    M5.Display.fillRect(x, y, w, h, _color);
+    _gfx->fillRect(x, y, w, h, rgb565);
+    markDirty(x, y, w, h);
   }
 
   void drawXbm(int x, int y, const uint8_t* bits, int w, int h) override {
@@ -145,16 +172,27 @@ public:
         int byte_idx = (yy * ((w + 7) / 8)) + (xx / 8);
         int bit_idx = xx % 8;
         if (bits[byte_idx] & (1 << bit_idx)) {
-          M5.Display.drawPixel(x + xx, y + yy, _color);
+          _gfx->drawPixel(x + xx, y + yy, _color);
         }
       }
     }
+    markDirty(x, y, w, h);
+  }
+
+  void setClipRect(int x, int y, int w, int h) override {
+    _gfx->setClipRect(x, y, w, h);
+  }
+
+  void clearClipRect() override {
+    _gfx->clearClipRect();
   }
 
   uint16_t getTextWidth(const char* str) override {
     return strlen(str) * CHAR_WIDTH * text_size;
   }
 
+  void drawTextEllipsized(int x, int y, int max_width, const char* str) override;
+
 };
 
 // Helper inline for text drawing
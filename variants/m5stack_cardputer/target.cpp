@@ -251,15 +251,19 @@ uint32_t radio_get_rng_seed() {
 }
 
 void radio_set_params(float freq, float bw, uint8_t sf, uint8_t cr) {
+  radio_driver.lock();   // in case radio task is running
   radio.setFrequency(freq);
   radio.setSpreadingFactor(sf);
   radio.setBandwidth(bw);
   radio.setCodingRate(cr);
+  radio_driver.unlock();
 }
 
 void radio_set_tx_power(uint8_t dbm) {
   Serial.printf("[LoRa] Setting TX power to %d dBm\n", dbm);
+  radio_driver.lock();
   int16_t result = radio.setOutputPower(dbm);
+  radio_driver.unlock();
   if (result == 0) {
     Serial.printf("[LoRa] TX power set successfully to %d dBm\n", dbm);
   } else {